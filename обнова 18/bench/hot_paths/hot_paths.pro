@@ -0,0 +1,43 @@
+QT -= gui
+QT += network sql
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = hot_paths
+
+INCLUDEPATH += $$PWD/../../server
+
+# Весь сервер, кроме main.cpp: замеряются те же функции, что работают в нём
+SOURCES += \
+    ../../server/BoardBlob.cpp \
+    ../../server/ConnectionPool.cpp \
+    ../../server/DatabaseManager.cpp \
+    ../../server/FleetValidator.cpp \
+    ../../server/FrameReader.cpp \
+    ../../server/func2serv.cpp \
+    ../../server/GameBoard.cpp \
+    ../../server/GameSession.cpp \
+    ../../server/Logger.cpp \
+    ../../server/LoopWatchdog.cpp \
+    ../../server/Matchmaker.cpp \
+    ../../server/Metrics.cpp \
+    ../../server/mytcpserver.cpp \
+    ../../server/OutboundLimits.cpp \
+    ../../server/PersistenceWorker.cpp \
+    ../../server/PlayerRegistry.cpp \
+    ../../server/Request.cpp \
+    ../../server/SchemaMigrator.cpp \
+    ../../server/ServerWorker.cpp \
+    ../../server/TimerWheel.cpp \
+    ../../server/Tracer.cpp \
+    ../../server/WireProtocol.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../server/DatabaseManager.h \
+    ../../server/Logger.h \
+    ../../server/LoopWatchdog.h \
+    ../../server/mytcpserver.h \
+    ../../server/PersistenceWorker.h \
+    ../../server/ServerWorker.h
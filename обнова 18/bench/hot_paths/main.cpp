@@ -0,0 +1,378 @@
+// Микробенчмарки горячих путей протокола и игровой логики.
+// Каждый замер выполняет операцию сериями: размер серии подбирается так, чтобы серия шла около 1 мс,
+// а время на операцию - это время серии, делённое на её размер. Если операция меняет состояние
+// (ход в партии, строка в Move), перед серией состояние пересоздаётся вне замера.
+// Результат - JSON с медианой и p99 по сериям: файлы двух сборок можно сравнить построчно.
+// Замеры сессии выполняются в потоке воркера, которому она принадлежит, как и на сервере;
+// в одном процессе замеряется одна БД, поэтому файл и память сравниваются двумя запусками (--database).
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+#include "BoardBlob.h"
+#include "DatabaseManager.h"
+#include "FleetValidator.h"
+#include "FrameReader.h"
+#include "GameSession.h"
+#include "Logger.h"
+#include "Request.h"
+#include "ServerWorker.h"
+#include "WireProtocol.h"
+#include "func2serv.h"
+#include "mytcpserver.h"
+
+static const qint64 TargetBatchNs = 1000000;
+static const int MinSamples = 10;
+static const int MaxSamples = 100000;
+// Ходы за одну партию: порядок клеток ниже не успевает потопить флот, поэтому партия не заканчивается
+static const int MovesPerGame = 24;
+
+static volatile quint64 sink = 0; // Результаты операций, чтобы компилятор их не выбросил
+
+// Клетка i-го выстрела: шаг 37 взаимно прост со 100, выстрелы разбросаны по полю
+static int shotCell(int index)
+{
+    return index * 37 % Bitboard::CellCount;
+}
+
+// Правильный флот 1x4, 2x3, 3x2, 4x1
+static const QVector<ShipPlacement> &fleet()
+{
+    static const QVector<ShipPlacement> ships = {
+        {0, 0, 4, true},
+        {0, 2, 3, true}, {5, 2, 3, true},
+        {0, 4, 2, true}, {4, 4, 2, true}, {8, 4, 2, false},
+        {0, 7, 1, true}, {2, 7, 1, true}, {4, 7, 1, true}, {6, 7, 1, true}
+    };
+    return ships;
+}
+
+struct Case
+{
+    const char *name;
+    int batchLimit; // Сколько операций подряд выдерживает состояние; 0 - без ограничения
+    std::function<void()> reset; // Перед каждой серией, не замеряется
+    std::function<void(int)> op; // Аргумент - номер операции в серии
+    ServerWorker *worker; // Если задан, замер идёт в потоке этого воркера
+};
+
+struct Result
+{
+    int batch = 0;
+    int samples = 0;
+    double medianNs = 0;
+    double p99Ns = 0;
+    double minNs = 0;
+    double meanNs = 0;
+};
+
+static qint64 timeBatch(const Case &benchCase, int batch)
+{
+    if (benchCase.reset) {
+        benchCase.reset();
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < batch; ++i) {
+        benchCase.op(i);
+    }
+    return timer.nsecsElapsed();
+}
+
+static Result measure(const Case &benchCase, qint64 minTimeNs)
+{
+    Result result;
+    int batch = 1;
+    for (;;) {
+        qint64 elapsed = timeBatch(benchCase, batch);
+        bool limited = benchCase.batchLimit > 0 && batch >= benchCase.batchLimit;
+        if (elapsed >= TargetBatchNs || limited) {
+            break;
+        }
+        batch *= 2;
+        if (benchCase.batchLimit > 0) {
+            batch = qMin(batch, benchCase.batchLimit);
+        }
+    }
+
+    QVector<double> samples;
+    QElapsedTimer total;
+    total.start();
+    while (samples.size() < MinSamples || (total.nsecsElapsed() < minTimeNs && samples.size() < MaxSamples)) {
+        samples.append(double(timeBatch(benchCase, batch)) / batch);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    result.batch = batch;
+    result.samples = samples.size();
+    result.medianNs = samples.at(samples.size() / 2);
+    result.p99Ns = samples.at(samples.size() * 99 / 100);
+    result.minNs = samples.first();
+    double sum = 0;
+    for (double sample : std::as_const(samples)) {
+        sum += sample;
+    }
+    result.meanNs = sum / samples.size();
+    return result;
+}
+
+// Партия двух игроков в сессии сервера; пересоздаётся перед каждой серией ходов
+struct MoveFixture
+{
+    MyTcpServer *server = nullptr;
+    PlayerId players[2] = {NoPlayer, NoPlayer};
+    QString names[2];
+    GameSession *session = nullptr;
+    int shots[2] = {0, 0};
+    QByteArray jsonMoves[2][MovesPerGame]; // make_move каждого игрока в порядке выстрелов
+
+    // Только из потока воркера сессии
+    void reset()
+    {
+        if (session) {
+            server->endSession(session);
+        }
+        int gameId = DatabaseManager::getInstance()->createGame(players[0], players[1]);
+        session = server->createSession(gameId, players[0], players[1]);
+        for (PlayerId player : players) {
+            for (const ShipPlacement &ship : fleet()) {
+                session->getBoard(player)->placeShip(ship);
+            }
+            session->setReady(player);
+        }
+        session->setCurrentTurn(players[0]);
+        shots[0] = shots[1] = 0;
+        for (int index = 0; index < 2; ++index) {
+            for (int shot = 0; shot < MovesPerGame; ++shot) {
+                jsonMoves[index][shot] = QString("{\"type\":\"make_move\",\"nickname\":\"%1\",\"game_id\":%2,\"x\":%3,\"y\":%4}")
+                                             .arg(names[index]).arg(gameId)
+                                             .arg(shotCell(shot) % Bitboard::Size).arg(shotCell(shot) / Bitboard::Size)
+                                             .toUtf8();
+            }
+        }
+    }
+
+    int shooter() const { return session->getCurrentTurn() == players[0] ? 0 : 1; }
+
+    Request nextMove(bool binaryReplies)
+    {
+        int index = shooter();
+        int cell = shotCell(shots[index]++);
+        Request request;
+        request.type = Request::MakeMove;
+        request.typeName = "make_move";
+        request.fields = Request::NicknameField | Request::GameIdField | Request::XField | Request::YField;
+        request.nickname = names[index];
+        request.playerId = players[index];
+        request.gameId = session->getGameId();
+        request.x = cell % Bitboard::Size;
+        request.y = cell / Bitboard::Size;
+        request.binaryReplies = binaryReplies;
+        return request;
+    }
+};
+
+// Партия для DatabaseManager::checkMove: флот соперника записан в Ship, выстрелы - в Move
+struct CheckMoveFixture
+{
+    PlayerId players[2] = {NoPlayer, NoPlayer};
+    int gameId = -1;
+
+    void reset()
+    {
+        DatabaseManager *db = DatabaseManager::getInstance();
+        gameId = db->createGame(players[0], players[1]);
+        db->saveFleet(gameId, players[1], fleet());
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption databaseOption("database", "Database for DB benchmarks: file (temporary file), memory, or a path.",
+                                      "kind", "file");
+    QCommandLineOption minTimeOption("min-time", "Minimum time spent measuring each benchmark.", "ms", "500");
+    QCommandLineOption filterOption("filter", "Run only benchmarks whose name contains this text.", "text");
+    QCommandLineOption outputOption("output", "JSON results file (default: stdout).", "path");
+    parser.addOption(databaseOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(filterOption);
+    parser.addOption(outputOption);
+    parser.process(a);
+
+    // Отладочные сообщения замеряемых путей не пишутся, остаются только предупреждения
+    Logger::setLevel(Logger::Warning);
+
+    QTemporaryDir tempDir;
+    QString database = parser.value(databaseOption);
+    QString databaseName = database == "file" ? tempDir.filePath("hot_paths.sqlite")
+                         : database == "memory" ? QString("file:hot_paths?mode=memory&cache=shared")
+                         : database;
+    DatabaseManager::setDatabaseName(databaseName);
+    DatabaseManager *db = DatabaseManager::getInstance();
+
+    QDateTime startedAt = QDateTime::currentDateTimeUtc();
+    QJsonArray results;
+    QTextStream progress(stderr);
+    {
+        // Один воркер: все сессии замера в одном потоке. Порт 33333 серверу замера не нужен
+        MyTcpServer server(1);
+        server.close();
+        ServerWorker *worker = server.getSessionWorker(0);
+
+        MoveFixture moves;
+        moves.server = &server;
+        CheckMoveFixture checks;
+        for (int index = 0; index < 2; ++index) {
+            moves.names[index] = QString("bench_player%1").arg(index + 1);
+            moves.players[index] = db->internPlayer(moves.names[index]);
+            checks.players[index] = moves.players[index];
+        }
+
+        QByteArray jsonMove = R"({"type":"make_move","nickname":"bench_player1","game_id":42,"x":3,"y":7})";
+        QByteArray binaryMove = WireProtocol::encodeMakeMove(42, 3, 7).mid(FrameReader::BinaryHeaderSize);
+        QByteArray serverStream;
+        for (int i = 0; i < 16; ++i) {
+            serverStream += R"({"type":"move_result","status":"miss","x":4,"y":5,"message":"Opponent made a move","current_turn":"bench_player1"})";
+            serverStream += '\n';
+        }
+        QByteArray binaryStream;
+        for (int i = 0; i < 16; ++i) {
+            binaryStream += WireProtocol::encodeShot(WireProtocol::OpponentMoveMessage, 4, 5, BoardBlob::shotCode("miss"), true);
+        }
+        Bitboard fleetCells;
+        for (const ShipPlacement &ship : fleet()) {
+            fleetCells |= FleetValidator::shipMask(ship.x, ship.y, ship.size, ship.isHorizontal);
+        }
+        if (FleetValidator::validate(FleetValidator::shipsFromMask(fleetCells)) != FleetValidator::Ok) {
+            progress << "Benchmark fleet is invalid\n";
+            return 1;
+        }
+
+        const QVector<Case> cases = {
+            {"request_decode_json", 0, nullptr, [&](int) {
+                 Request request;
+                 QString error;
+                 sink += Request::decode(jsonMove, request, error) ? request.x : 0;
+             }, nullptr},
+            {"request_decode_binary", 0, nullptr, [&](int) {
+                 Request request;
+                 QString error;
+                 sink += Request::decodeBinary(binaryMove, request, error) ? request.x : 0;
+             }, nullptr},
+            {"create_json_response", 0, nullptr, [&](int) {
+                 sink += createJsonResponse("make_move", "hit", "Move processed").size();
+             }, nullptr},
+            // Путь JSON-хода на сервере: разбор, parse() -> handleMakeMove, ответ и сообщение сопернику
+            {"parse_make_move_json", MovesPerGame, [&]() { moves.reset(); }, [&](int) {
+                 int index = moves.shooter();
+                 Request request;
+                 QString error;
+                 Request::decode(moves.jsonMoves[index][moves.shots[index]++], request, error);
+                 request.playerId = moves.players[index];
+                 sink += parse(request, &server).size();
+             }, worker},
+            {"handle_make_move_binary", MovesPerGame, [&]() { moves.reset(); }, [&](int) {
+                 sink += handleMakeMove(moves.nextMove(true), &server).size();
+             }, worker},
+            {"db_check_move", Bitboard::CellCount, [&]() { checks.reset(); }, [&](int i) {
+                 int cell = shotCell(i);
+                 sink += db->checkMove(checks.gameId, checks.players[0], cell % Bitboard::Size, cell / Bitboard::Size).size();
+             }, nullptr},
+            // Проверка расстановки из GameWindow::readyToFight: маска клеток -> корабли -> валидатор
+            {"fleet_validate", 0, nullptr, [&](int) {
+                 sink += FleetValidator::validate(FleetValidator::shipsFromMask(fleetCells));
+             }, nullptr},
+            // Разбор входящих данных как в NetworkClient::onReadyRead (16 сообщений на итерацию)
+            {"client_decode_json_x16", 0, nullptr, [&](int) {
+                 FrameReader reader;
+                 reader.append(serverStream);
+                 QByteArrayView frame;
+                 FrameReader::FrameKind kind;
+                 while (reader.nextFrame(frame, kind)) {
+                     QJsonObject json = QJsonDocument::fromJson(frame.toByteArray()).object();
+                     sink += json["x"].toInt() + json["type"].toString().size() + json["current_turn"].toString().size();
+                 }
+             }, nullptr},
+            {"client_decode_binary_x16", 0, nullptr, [&](int) {
+                 FrameReader reader;
+                 reader.append(binaryStream);
+                 QByteArrayView frame;
+                 FrameReader::FrameKind kind;
+                 while (reader.nextFrame(frame, kind)) {
+                     WireProtocol::Shot shot;
+                     sink += WireProtocol::decodeShot(frame, shot) ? shot.x : 0;
+                 }
+             }, nullptr},
+        };
+
+        qint64 minTimeNs = parser.value(minTimeOption).toLongLong() * 1000000;
+        QString filter = parser.value(filterOption);
+        progress << "benchmark\tbatch\tmedian_ns\tp99_ns\n";
+        for (const Case &benchCase : cases) {
+            if (!filter.isEmpty() && !QString(benchCase.name).contains(filter)) {
+                continue;
+            }
+            Result result;
+            if (benchCase.worker) {
+                QMetaObject::invokeMethod(benchCase.worker, [&]() { result = measure(benchCase, minTimeNs); },
+                                          Qt::BlockingQueuedConnection);
+            } else {
+                result = measure(benchCase, minTimeNs);
+            }
+            progress << benchCase.name << "\t" << result.batch << "\t" << result.medianNs << "\t" << result.p99Ns << "\n";
+            progress.flush();
+
+            QJsonObject entry;
+            entry["name"] = benchCase.name;
+            entry["batch"] = result.batch;
+            entry["samples"] = result.samples;
+            entry["iterations"] = qint64(result.batch) * result.samples;
+            entry["median_ns"] = result.medianNs;
+            entry["p99_ns"] = result.p99Ns;
+            entry["min_ns"] = result.minNs;
+            entry["mean_ns"] = result.meanNs;
+            results.append(entry);
+        }
+
+        if (moves.session) {
+            QMetaObject::invokeMethod(worker, [&]() { server.endSession(moves.session); }, Qt::BlockingQueuedConnection);
+        }
+    }
+    db->shutdown();
+
+    QJsonObject root;
+    root["suite"] = "hot_paths";
+    root["qt_version"] = qVersion();
+#ifdef QT_NO_DEBUG
+    root["build"] = "release";
+#else
+    root["build"] = "debug";
+#endif
+    root["database"] = database;
+    root["started_at"] = startedAt.toString(Qt::ISODate);
+    root["benchmarks"] = results;
+    QByteArray json = QJsonDocument(root).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) == -1) {
+            progress << "Failed to write " << file.fileName() << "\n";
+            return 1;
+        }
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
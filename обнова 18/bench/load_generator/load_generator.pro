@@ -0,0 +1,23 @@
+QT -= gui
+QT += network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = load_generator
+
+INCLUDEPATH += $$PWD/../../server
+
+SOURCES += \
+    ../../server/BoardBlob.cpp \
+    ../../server/FleetValidator.cpp \
+    ../../server/FrameReader.cpp \
+    ../../server/WireProtocol.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../server/Bitboard.h \
+    ../../server/BoardBlob.h \
+    ../../server/FleetValidator.h \
+    ../../server/FrameReader.h \
+    ../../server/WireProtocol.h
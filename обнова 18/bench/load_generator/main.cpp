@@ -0,0 +1,502 @@
+// Генератор нагрузки: N ботов подключаются к серверу на 127.0.0.1 и играют так же, как NetworkClient
+// в режиме JSON: register -> login -> start_game -> place_fleet -> ready_to_battle -> make_move ... -> game_over
+// и снова start_game, пока не выйдет время. Флот каждой партии случайный и правильный, ход делается
+// в свою очередь с заданной частотой. В конце печатаются перцентили задержки подключения, входа и хода,
+// пропускная способность и число ошибок (--json дублирует отчёт в файл).
+// Все боты работают в одном потоке на неблокирующих сокетах; для тысяч соединений нужен ulimit -n с запасом.
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "FleetValidator.h"
+#include "FrameReader.h"
+
+static const int ProgressIntervalMs = 5000;
+
+struct Config
+{
+    quint16 port = 33333;
+    QString prefix;
+    QString password;
+    double moveRate = 1; // Ходов в секунду на бота, 0 - сразу
+};
+
+// Задержки в микросекундах
+struct Latency
+{
+    std::vector<qint64> samples;
+
+    void add(qint64 nanoseconds) { samples.push_back(nanoseconds / 1000); }
+
+    // Перцентиль в миллисекундах; samples к этому моменту отсортированы
+    double percentile(int perMille) const
+    {
+        if (samples.empty()) {
+            return 0;
+        }
+        size_t index = qMin(samples.size() - 1, samples.size() * size_t(perMille) / 1000);
+        return samples[index] / 1000.0;
+    }
+
+    QJsonObject toJson()
+    {
+        std::sort(samples.begin(), samples.end());
+        QJsonObject json;
+        json["count"] = qint64(samples.size());
+        json["p50_ms"] = percentile(500);
+        json["p99_ms"] = percentile(990);
+        json["p999_ms"] = percentile(999);
+        json["max_ms"] = samples.empty() ? 0.0 : samples.back() / 1000.0;
+        return json;
+    }
+};
+
+struct Stats
+{
+    Latency connect;
+    Latency login;
+    Latency move;
+    qint64 messagesSent = 0;
+    qint64 messagesReceived = 0;
+    qint64 bytesSent = 0;
+    qint64 bytesReceived = 0;
+    qint64 gamesStarted = 0; // Каждый из двух ботов партии считает её отдельно
+    qint64 gamesFinished = 0;
+    qint64 gamesAbandoned = 0; // Соперник отключился и не вернулся; считает только оставшийся бот
+    qint64 connectErrors = 0;
+    qint64 disconnects = 0; // Сервер закрыл соединение до конца прогона
+    qint64 serverErrors = 0; // Ответы со status "error" и сообщения type "error"
+    int connected = 0;
+    int inGame = 0;
+};
+
+// Случайный правильный флот: корабли от большего к меньшему ставятся в случайные свободные места
+static QVector<ShipPlacement> randomFleet()
+{
+    QRandomGenerator *random = QRandomGenerator::global();
+    for (;;) {
+        QVector<ShipPlacement> ships;
+        Bitboard occupied;
+        bool placed = true;
+        for (int size = FleetValidator::MaxShipSize; size >= 1 && placed; --size) {
+            for (int count = 0; count < FleetValidator::requiredCount(size) && placed; ++count) {
+                placed = false;
+                for (int attempt = 0; attempt < 100 && !placed; ++attempt) {
+                    ShipPlacement ship;
+                    ship.x = random->bounded(Bitboard::Size);
+                    ship.y = random->bounded(Bitboard::Size);
+                    ship.size = size;
+                    ship.isHorizontal = random->bounded(2) == 1;
+                    if (FleetValidator::canPlace(occupied, ship) == FleetValidator::Ok) {
+                        occupied |= FleetValidator::shipMask(ship.x, ship.y, ship.size, ship.isHorizontal);
+                        ships.append(ship);
+                        placed = true;
+                    }
+                }
+            }
+        }
+        // Изредка мелким кораблям не хватает места - тогда расстановка начинается заново
+        if (placed && FleetValidator::validate(ships) == FleetValidator::Ok) {
+            return ships;
+        }
+    }
+}
+
+// Один игрок: своё соединение и свой разбор потока сообщений
+class Bot
+{
+public:
+    Bot(int index, const Config &config, Stats &stats, const QElapsedTimer &clock, QObject *parent)
+        : config(config), stats(stats), clock(clock), socket(new QTcpSocket(parent)), moveTimer(new QTimer(parent))
+    {
+        nickname = QString("%1%2").arg(config.prefix).arg(index);
+        moveTimer->setSingleShot(true);
+        QObject::connect(moveTimer, &QTimer::timeout, socket, [this]() { sendMove(); });
+        QObject::connect(socket, &QTcpSocket::connected, socket, [this]() { onConnected(); });
+        QObject::connect(socket, &QTcpSocket::readyRead, socket, [this]() { onReadyRead(); });
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, [this]() { onDisconnected(); });
+        QObject::connect(socket, &QTcpSocket::errorOccurred, socket, [this](QAbstractSocket::SocketError) {
+            if (!wasConnected) {
+                ++this->stats.connectErrors;
+            }
+        });
+    }
+
+    void start()
+    {
+        connectStartedNs = clock.nsecsElapsed();
+        socket->connectToHost(QHostAddress::LocalHost, config.port);
+    }
+
+    void stop()
+    {
+        stopping = true;
+        moveTimer->stop();
+        if (socket->state() != QAbstractSocket::UnconnectedState) {
+            socket->disconnectFromHost();
+        }
+    }
+
+private:
+    void send(const QJsonObject &json)
+    {
+        QByteArray data = QJsonDocument(json).toJson(QJsonDocument::Compact) + "\r\n";
+        socket->write(data);
+        ++stats.messagesSent;
+        stats.bytesSent += data.size();
+    }
+
+    void onConnected()
+    {
+        wasConnected = true;
+        ++stats.connected;
+        stats.connect.add(clock.nsecsElapsed() - connectStartedNs);
+        // Новый бот регистрируется; если никнейм уже есть с прошлого прогона, сервер ответит ошибкой и бот просто войдёт
+        QJsonObject json;
+        json["type"] = "register";
+        json["nickname"] = nickname;
+        json["email"] = nickname + "@load.test";
+        json["password"] = config.password;
+        send(json);
+    }
+
+    void onDisconnected()
+    {
+        if (wasConnected) {
+            --stats.connected;
+        }
+        if (gameId != -1) {
+            --stats.inGame;
+            gameId = -1;
+        }
+        moveTimer->stop();
+        if (!stopping) {
+            ++stats.disconnects;
+        }
+    }
+
+    void onReadyRead()
+    {
+        QByteArray data = socket->readAll();
+        stats.bytesReceived += data.size();
+        reader.append(data);
+        QByteArrayView frame;
+        FrameReader::FrameKind kind;
+        while (reader.nextFrame(frame, kind)) {
+            ++stats.messagesReceived;
+            QJsonDocument doc = QJsonDocument::fromJson(frame.toByteArray());
+            if (doc.isObject()) {
+                handle(doc.object());
+            } else {
+                ++stats.serverErrors;
+            }
+        }
+        if (reader.hasError()) {
+            ++stats.serverErrors;
+            socket->abort();
+        }
+    }
+
+    void handle(const QJsonObject &json)
+    {
+        QString type = json["type"].toString();
+        bool success = json["status"].toString() != "error" && type != "error";
+
+        if (type == "register") {
+            // Ошибка регистрации - обычно никнейм с прошлого прогона; вход покажет, так ли это
+            login();
+        } else if (type == "login") {
+            if (!success) {
+                ++stats.serverErrors;
+                socket->disconnectFromHost();
+                return;
+            }
+            stats.login.add(clock.nsecsElapsed() - loginSentNs);
+            requestGame();
+        } else if (type == "start_game") {
+            if (!success) {
+                ++stats.serverErrors;
+            }
+        } else if (type == "game_ready") {
+            gameId = json["game_id"].toInt();
+            ++stats.gamesStarted;
+            ++stats.inGame;
+            placeFleet();
+        } else if (type == "place_fleet") {
+            if (!success) {
+                ++stats.serverErrors;
+                return;
+            }
+            QJsonObject ready;
+            ready["type"] = "ready_to_battle";
+            ready["nickname"] = nickname;
+            ready["game_id"] = gameId;
+            send(ready);
+        } else if (type == "ready_to_battle") {
+            if (!success) {
+                ++stats.serverErrors;
+            }
+        } else if (type == "game_start" || type == "move_result" || type == "turn_timeout") {
+            updateTurn(json["current_turn"].toString());
+        } else if (type == "make_move") {
+            moveInFlight = false;
+            stats.move.add(clock.nsecsElapsed() - moveSentNs);
+            updateTurn(json["current_turn"].toString());
+        } else if (type == "game_over" || type == "gameover") {
+            // Прежние версии сервера сообщали об ушедшем сопернике типом "gameover" со status вместо reason
+            bool abandoned = json["reason"].toString() == "opponent_disconnected" ||
+                             json["status"].toString() == "opponent_disconnected";
+            finishGame(abandoned);
+        } else if (type == "error") {
+            ++stats.serverErrors;
+            // Ошибочный ход не должен остановить партию: пробуем следующую клетку
+            if (moveInFlight) {
+                moveInFlight = false;
+                updateTurn(currentTurn);
+            }
+        }
+    }
+
+    void login()
+    {
+        QJsonObject json;
+        json["type"] = "login";
+        json["nickname"] = nickname;
+        json["password"] = config.password;
+        loginSentNs = clock.nsecsElapsed();
+        send(json);
+    }
+
+    void requestGame()
+    {
+        if (stopping) {
+            return;
+        }
+        QJsonObject json;
+        json["type"] = "start_game";
+        json["nickname"] = nickname;
+        send(json);
+    }
+
+    void placeFleet()
+    {
+        QJsonArray ships;
+        for (const ShipPlacement &ship : randomFleet()) {
+            QJsonObject shipJson;
+            shipJson["x"] = ship.x;
+            shipJson["y"] = ship.y;
+            shipJson["size"] = ship.size;
+            shipJson["is_horizontal"] = ship.isHorizontal;
+            ships.append(shipJson);
+        }
+        QJsonObject json;
+        json["type"] = "place_fleet";
+        json["nickname"] = nickname;
+        json["game_id"] = gameId;
+        json["ships"] = ships;
+        send(json);
+
+        // Клетки поля соперника в случайном порядке: каждая обстреливается один раз
+        targets.clear();
+        for (int cell = 0; cell < Bitboard::CellCount; ++cell) {
+            targets.append(cell);
+        }
+        std::shuffle(targets.begin(), targets.end(), *QRandomGenerator::global());
+    }
+
+    void updateTurn(const QString &turn)
+    {
+        currentTurn = turn;
+        if (currentTurn != nickname || moveInFlight || stopping || gameId == -1) {
+            return;
+        }
+        int delayMs = config.moveRate > 0 ? int(1000 / config.moveRate) : 0;
+        moveTimer->start(delayMs);
+    }
+
+    void sendMove()
+    {
+        if (targets.isEmpty() || gameId == -1 || stopping) {
+            return;
+        }
+        int cell = targets.takeLast();
+        QJsonObject json;
+        json["type"] = "make_move";
+        json["nickname"] = nickname;
+        json["game_id"] = gameId;
+        json["x"] = cell % Bitboard::Size;
+        json["y"] = cell / Bitboard::Size;
+        moveInFlight = true;
+        moveSentNs = clock.nsecsElapsed();
+        send(json);
+    }
+
+    void finishGame(bool abandoned)
+    {
+        moveTimer->stop();
+        moveInFlight = false;
+        if (gameId != -1) {
+            --stats.inGame;
+            ++(abandoned ? stats.gamesAbandoned : stats.gamesFinished);
+            gameId = -1;
+        }
+        requestGame();
+    }
+
+    const Config &config;
+    Stats &stats;
+    const QElapsedTimer &clock;
+    QTcpSocket *socket;
+    QTimer *moveTimer;
+    FrameReader reader;
+    QString nickname;
+    QString currentTurn;
+    QVector<int> targets;
+    int gameId = -1;
+    bool wasConnected = false;
+    bool moveInFlight = false;
+    bool stopping = false;
+    qint64 connectStartedNs = 0;
+    qint64 loginSentNs = 0;
+    qint64 moveSentNs = 0;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption clientsOption("clients", "Number of simulated players.", "count", "100");
+    QCommandLineOption durationOption("duration", "Test length; bots disconnect when it ends.", "seconds", "60");
+    QCommandLineOption moveRateOption("move-rate", "Moves per second each bot makes on its turn; 0 moves at once.", "rate", "1");
+    QCommandLineOption rampOption("ramp-rate", "New connections opened per second.", "count", "200");
+    QCommandLineOption portOption("port", "Server port on 127.0.0.1.", "port", "33333");
+    QCommandLineOption prefixOption("prefix", "Nickname prefix; bots are <prefix>0, <prefix>1, ...", "text", "loadbot");
+    QCommandLineOption jsonOption("json", "Also write the report as JSON to this file.", "path");
+    parser.addOption(clientsOption);
+    parser.addOption(durationOption);
+    parser.addOption(moveRateOption);
+    parser.addOption(rampOption);
+    parser.addOption(portOption);
+    parser.addOption(prefixOption);
+    parser.addOption(jsonOption);
+    parser.process(a);
+
+    Config config;
+    config.port = quint16(parser.value(portOption).toUInt());
+    config.prefix = parser.value(prefixOption);
+    config.password = "load-test";
+    config.moveRate = qMax(0.0, parser.value(moveRateOption).toDouble());
+    int clients = qMax(1, parser.value(clientsOption).toInt());
+    int durationMs = qMax(1, parser.value(durationOption).toInt()) * 1000;
+    int rampRate = qMax(1, parser.value(rampOption).toInt());
+
+    Stats stats;
+    QElapsedTimer clock;
+    clock.start();
+    std::vector<std::unique_ptr<Bot>> bots;
+    bots.reserve(clients);
+    for (int index = 0; index < clients; ++index) {
+        bots.push_back(std::make_unique<Bot>(index, config, stats, clock, &a));
+    }
+
+    // Подключения открываются пачками каждые 10 мс, чтобы не упереться в очередь accept сервера
+    QTimer rampTimer;
+    int started = 0;
+    int perTick = qMax(1, rampRate / 100);
+    QObject::connect(&rampTimer, &QTimer::timeout, [&]() {
+        for (int i = 0; i < perTick && started < clients; ++i) {
+            bots[started++]->start();
+        }
+        if (started == clients) {
+            rampTimer.stop();
+        }
+    });
+    rampTimer.start(10);
+
+    QTextStream err(stderr);
+    qint64 lastMoves = 0;
+    QTimer progressTimer;
+    QObject::connect(&progressTimer, &QTimer::timeout, [&]() {
+        qint64 moves = qint64(stats.move.samples.size());
+        err << QString("%1 s: connected %2, in game %3, moves/s %4, errors %5\n")
+                   .arg(clock.elapsed() / 1000).arg(stats.connected).arg(stats.inGame)
+                   .arg(double(moves - lastMoves) * 1000 / ProgressIntervalMs)
+                   .arg(stats.connectErrors + stats.disconnects + stats.serverErrors);
+        err.flush();
+        lastMoves = moves;
+    });
+    progressTimer.start(ProgressIntervalMs);
+
+    qint64 measuredMs = 0;
+    QTimer::singleShot(durationMs, &a, [&]() {
+        measuredMs = clock.elapsed();
+        progressTimer.stop();
+        rampTimer.stop();
+        for (const std::unique_ptr<Bot> &bot : bots) {
+            bot->stop();
+        }
+        // Даём соединениям закрыться, прежде чем завершать цикл событий
+        QTimer::singleShot(500, &a, &QCoreApplication::quit);
+    });
+    a.exec();
+
+    double seconds = measuredMs / 1000.0;
+    QJsonObject report;
+    report["clients"] = clients;
+    report["duration_s"] = seconds;
+    report["move_rate"] = config.moveRate;
+    report["connect"] = stats.connect.toJson();
+    report["login"] = stats.login.toJson();
+    report["move"] = stats.move.toJson();
+    report["moves_per_s"] = stats.move.samples.size() / seconds;
+    report["messages_sent_per_s"] = stats.messagesSent / seconds;
+    report["messages_received_per_s"] = stats.messagesReceived / seconds;
+    report["bytes_sent"] = stats.bytesSent;
+    report["bytes_received"] = stats.bytesReceived;
+    report["games_started"] = stats.gamesStarted / 2;
+    report["games_finished"] = stats.gamesFinished / 2;
+    report["games_abandoned"] = stats.gamesAbandoned;
+    QJsonObject errors;
+    errors["connect"] = stats.connectErrors;
+    errors["disconnects"] = stats.disconnects;
+    errors["server"] = stats.serverErrors;
+    report["errors"] = errors;
+
+    QTextStream out(stdout);
+    out << QString("clients %1, %2 s, %3 moves/s per bot on turn\n").arg(clients).arg(seconds).arg(config.moveRate);
+    out << "latency\tcount\tp50_ms\tp99_ms\tp999_ms\tmax_ms\n";
+    for (const char *name : {"connect", "login", "move"}) {
+        QJsonObject latency = report[name].toObject();
+        out << name << "\t" << latency["count"].toInteger() << "\t" << latency["p50_ms"].toDouble() << "\t"
+            << latency["p99_ms"].toDouble() << "\t" << latency["p999_ms"].toDouble() << "\t" << latency["max_ms"].toDouble() << "\n";
+    }
+    out << "throughput: " << report["moves_per_s"].toDouble() << " moves/s, "
+        << report["messages_sent_per_s"].toDouble() << " msg/s sent, "
+        << report["messages_received_per_s"].toDouble() << " msg/s received\n";
+    out << "games: " << report["games_started"].toInteger() << " started, " << report["games_finished"].toInteger() << " finished, "
+        << report["games_abandoned"].toInteger() << " abandoned by a disconnected opponent\n";
+    out << "errors: " << stats.connectErrors << " connect, " << stats.disconnects << " disconnects, "
+        << stats.serverErrors << " server\n";
+    out.flush();
+
+    if (parser.isSet(jsonOption)) {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(QJsonDocument(report).toJson()) == -1) {
+            err << "Failed to write " << file.fileName() << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+// Замер задержки проверки хода при росте таблицы Move.
+// Таблица наполняется синтетическими партиями до 1e3, 1e4, ... строк; на каждом размере
+// выполняются те же запросы, что и в DatabaseManager::checkMove: "уже стреляли",
+// выборка кораблей соперника и подсчёт попаданий. С индексами схемы версии 2 время хода
+// не должно зависеть от размера таблицы; --schema-version 1 показывает поведение без индексов.
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVariant>
+#include <QVector>
+#include <algorithm>
+#include "SchemaMigrator.h"
+
+static const int MovesPerGame = 200; // По 100 выстрелов на игрока
+static const int ShipsPerPlayer = 10;
+static bool playerIds = false; // Схема версии 4+: игрок хранится числом player_id
+
+// Столбец игрока и его значение в текущей схеме
+static QString playerColumn()
+{
+    return playerIds ? "player_id" : "player";
+}
+
+static QVariant playerKey(int index)
+{
+    return playerIds ? QVariant(index + 1) : QVariant(QString("player%1").arg(index));
+}
+
+// Дописывает в БД партии, пока в Move не станет targetRows строк
+static bool growTables(QSqlDatabase &db, qint64 &rows, qint64 targetRows)
+{
+    QSqlQuery moveQuery(db);
+    moveQuery.prepare(QString("INSERT INTO Move (game_id, %1, x, y, result) VALUES (:game_id, :player, :x, :y, :result)").arg(playerColumn()));
+    QSqlQuery shipQuery(db);
+    shipQuery.prepare(QString("INSERT INTO Ship (game_id, %1, x, y, size, is_horizontal) VALUES (:game_id, :player, :x, :y, :size, :is_horizontal)").arg(playerColumn()));
+
+    while (rows < targetRows) {
+        db.transaction();
+        qint64 batchEnd = qMin(targetRows, rows + 100000);
+        for (; rows < batchEnd; ++rows) {
+            int gameId = int(rows / MovesPerGame) + 1;
+            int shot = int(rows % MovesPerGame);
+            QVariant player = playerKey(shot % 2);
+            if (shot < 2) {
+                for (int ship = 0; ship < ShipsPerPlayer; ++ship) {
+                    shipQuery.bindValue(":game_id", gameId);
+                    shipQuery.bindValue(":player", player);
+                    shipQuery.bindValue(":x", ship);
+                    shipQuery.bindValue(":y", ship % 7);
+                    shipQuery.bindValue(":size", 1 + ship % 4);
+                    shipQuery.bindValue(":is_horizontal", 0);
+                    shipQuery.exec();
+                }
+            }
+            int cell = shot / 2;
+            moveQuery.bindValue(":game_id", gameId);
+            moveQuery.bindValue(":player", player);
+            moveQuery.bindValue(":x", cell % 10);
+            moveQuery.bindValue(":y", cell / 10);
+            moveQuery.bindValue(":result", cell % 5 == 0 ? "hit" : "miss");
+            if (!moveQuery.exec()) {
+                qWarning() << "Insert failed:" << moveQuery.lastError().text();
+                db.rollback();
+                return false;
+            }
+        }
+        db.commit();
+    }
+    return true;
+}
+
+// Одна проверка хода: те же запросы, что выполняет checkMove
+static qint64 measureMove(QSqlQuery &shotQuery, QSqlQuery &shipQuery, QSqlQuery &hitQuery, int gameId)
+{
+    QRandomGenerator *random = QRandomGenerator::global();
+    int x = random->bounded(10);
+    int y = random->bounded(10);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    shotQuery.bindValue(":game_id", gameId);
+    shotQuery.bindValue(":player", playerKey(0));
+    shotQuery.bindValue(":x", x);
+    shotQuery.bindValue(":y", y);
+    shotQuery.exec();
+    shotQuery.next();
+    shotQuery.finish();
+
+    shipQuery.bindValue(":game_id", gameId);
+    shipQuery.bindValue(":player", playerKey(1));
+    shipQuery.exec();
+    while (shipQuery.next()) {
+    }
+    shipQuery.finish();
+
+    hitQuery.bindValue(":game_id", gameId);
+    hitQuery.bindValue(":player", playerKey(0));
+    hitQuery.bindValue(":x", x);
+    hitQuery.exec();
+    hitQuery.next();
+    hitQuery.finish();
+
+    return timer.nsecsElapsed();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption maxRowsOption("max-rows", "Largest Move table size to measure.", "rows", "10000000");
+    QCommandLineOption samplesOption("samples", "Moves measured at each table size.", "count", "2000");
+    QCommandLineOption schemaOption("schema-version", "Schema version to migrate to (1 = no indexes).", "version",
+                                    QString::number(SchemaMigrator::latestVersion()));
+    QCommandLineOption databaseOption("database", "Database file (default: temporary file).", "path");
+    parser.addOption(maxRowsOption);
+    parser.addOption(samplesOption);
+    parser.addOption(schemaOption);
+    parser.addOption(databaseOption);
+    parser.process(a);
+
+    QTemporaryDir tempDir;
+    QString databaseName = parser.isSet(databaseOption) ? parser.value(databaseOption) : tempDir.filePath("bench.sqlite");
+
+    QTextStream out(stdout);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "bench");
+        db.setDatabaseName(databaseName);
+        if (!db.open()) {
+            qWarning() << "Failed to open" << databaseName << ":" << db.lastError().text();
+            return 1;
+        }
+        QSqlQuery pragma(db);
+        pragma.exec("PRAGMA journal_mode=WAL");
+        pragma.exec("PRAGMA synchronous=NORMAL");
+        if (!SchemaMigrator::migrate(db, parser.value(schemaOption).toInt())) {
+            return 1;
+        }
+        playerIds = SchemaMigrator::currentVersion(db) >= 4;
+        if (playerIds) {
+            pragma.exec("INSERT OR IGNORE INTO Player (player_id, nickname) VALUES (1, 'player0'), (2, 'player1')");
+        }
+
+        QSqlQuery shotQuery(db);
+        shotQuery.prepare(QString("SELECT result FROM Move WHERE game_id = :game_id AND %1 = :player AND x = :x AND y = :y").arg(playerColumn()));
+        QSqlQuery shipQuery(db);
+        shipQuery.prepare(QString("SELECT ship_id, x, y, size, is_horizontal FROM Ship WHERE game_id = :game_id AND %1 = :player").arg(playerColumn()));
+        QSqlQuery hitQuery(db);
+        hitQuery.prepare(QString("SELECT COUNT(*) FROM Move WHERE game_id = :game_id AND %1 = :player AND result IN ('hit', 'sunk') AND x = :x").arg(playerColumn()));
+
+        out << "schema version " << SchemaMigrator::currentVersion(db) << "\n";
+        out << "rows\tmedian_us\tp99_us\n";
+
+        qint64 maxRows = parser.value(maxRowsOption).toLongLong();
+        int samples = qMax(1, parser.value(samplesOption).toInt());
+        qint64 rows = 0;
+        for (qint64 size = 1000; size <= maxRows; size *= 10) {
+            if (!growTables(db, rows, size)) {
+                return 1;
+            }
+
+            QVector<qint64> timings;
+            timings.reserve(samples);
+            int games = int(rows / MovesPerGame);
+            for (int i = 0; i < samples; ++i) {
+                timings.append(measureMove(shotQuery, shipQuery, hitQuery, QRandomGenerator::global()->bounded(games) + 1));
+            }
+            std::sort(timings.begin(), timings.end());
+            out << size << "\t" << timings.at(samples / 2) / 1000.0 << "\t" << timings.at(samples * 99 / 100) / 1000.0 << "\n";
+            out.flush();
+        }
+    }
+    QSqlDatabase::removeDatabase("bench");
+    return 0;
+}
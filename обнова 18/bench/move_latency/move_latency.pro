@@ -0,0 +1,22 @@
+QT -= gui
+QT += sql
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = move_latency
+
+INCLUDEPATH += $$PWD/../../server
+
+SOURCES += \
+    ../../server/BoardBlob.cpp \
+    ../../server/FleetValidator.cpp \
+    ../../server/Logger.cpp \
+    ../../server/Metrics.cpp \
+    ../../server/SchemaMigrator.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../server/BoardBlob.h \
+    ../../server/Logger.h \
+    ../../server/SchemaMigrator.h
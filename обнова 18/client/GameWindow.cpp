@@ -1,9 +1,9 @@
 #include "GameWindow.h"
 #include "ui_GameWindow.h"
 #include <QMessageBox>
-#include <algorithm>
 #include "WindowManager.h"
 #include "NetworkClient.h"
+#include "FleetValidator.h"
 
 GameWindow::GameWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -40,6 +40,9 @@ GameWindow::GameWindow(QWidget *parent) :
     connect(&NetworkClient::instance(), &NetworkClient::updateUIEnabled, this, &GameWindow::updateEnemyFieldEnabled);
     connect(&NetworkClient::instance(), &NetworkClient::ownMoveResult, this, &GameWindow::onOwnMoveResult);
     connect(&NetworkClient::instance(), &NetworkClient::gameOver, this, &GameWindow::onGameOver);
+    connect(&NetworkClient::instance(), &NetworkClient::opponentStatusChanged, this, [this](const QString &message) {
+        ui->statusLabel->setText(message);
+    });
 }
 
 void GameWindow::setupPlayerField()
@@ -100,100 +103,37 @@ void GameWindow::handleCellClick()
             QMessageBox::warning(this, "Ошибка", "Игра не началась!");
             return;
         }
-        QJsonObject json;
-        json["type"] = "make_move";
-        json["nickname"] = NetworkClient::instance().getCurrentNickname();
-        json["game_id"] = gameId;
-        json["x"] = col;
-        json["y"] = row;
-        NetworkClient::instance().sendMessage(QJsonDocument(json).toJson());
-        qDebug() << "Sent make_move request: x=" << col << ", y=" << row;
+        NetworkClient::instance().sendMove(gameId, col, row);
     }
 }
 
 void GameWindow::readyToFight()
 {
-    QVector<int> placedShips(4, 0);
-    QVector<QVector<bool>> visited(10, QVector<bool>(10, false));
-
-    // Проверка корректности кораблей
+    // Проверка расстановки общим с сервером валидатором на масках клеток
+    Bitboard cells;
     for (int row = 0; row < 10; ++row) {
         for (int col = 0; col < 10; ++col) {
-            if (playerField[row][col] == Ship && !visited[row][col]) {
-                int length = 1;
-                bool horizontal = false;
-
-                if (col < 9 && playerField[row][col+1] == Ship) {
-                    horizontal = true;
-                    for (int c = col+1; c < 10 && playerField[row][c] == Ship; ++c) {
-                        length++;
-                    }
-                } else if (row < 9 && playerField[row+1][col] == Ship) {
-                    for (int r = row+1; r < 10 && playerField[r][col] == Ship; ++r) {
-                        length++;
-                    }
-                }
-
-                if (length > 4) {
-                    QMessageBox::warning(this, "Ошибка", "Слишком длинный корабль!");
-                    return;
-                }
-
-                if (horizontal) {
-                    for (int c = col; c < col+length; ++c) visited[row][c] = true;
-                } else {
-                    for (int r = row; r < row+length; ++r) visited[r][col] = true;
-                }
-
-                if (length == 1) placedShips[0]++;
-                else if (length == 2) placedShips[1]++;
-                else if (length == 3) placedShips[2]++;
-                else if (length == 4) placedShips[3]++;
+            if (playerField[row][col] == Ship) {
+                cells.set(Bitboard::index(col, row));
             }
         }
     }
+    QVector<ShipPlacement> placements = FleetValidator::shipsFromMask(cells);
 
-    if (placedShips[3] != 1 || placedShips[2] != 2 ||
-        placedShips[1] != 3 || placedShips[0] != 4) {
+    switch (FleetValidator::validate(placements)) {
+    case FleetValidator::Ok:
+        break;
+    case FleetValidator::InvalidShip:
+        QMessageBox::warning(this, "Ошибка", "Слишком длинный корабль!");
+        return;
+    case FleetValidator::WrongComposition:
         QMessageBox::warning(this, "Ошибка", "Неправильное количество кораблей!\nТребуется: 1x4, 2x3, 3x2, 4x1");
         return;
-    }
-
-    // Проверка расстояния между кораблями
-    for (int row = 0; row < 10; ++row) {
-        for (int col = 0; col < 10; ++col) {
-            if (playerField[row][col] == Ship) {
-                for (int r = std::max(0, row-1); r <= std::min(9, row+1); ++r) {
-                    for (int c = std::max(0, col-1); c <= std::min(9, col+1); ++c) {
-                        if (playerField[r][c] == Ship && (r != row || c != col)) {
-                            bool sameShip = false;
-                            if (r == row) {
-                                int minC = std::min(c, col);
-                                int maxC = std::max(c, col);
-                                sameShip = true;
-                                for (int i = minC; i <= maxC; ++i) {
-                                    if (playerField[row][i] != Ship) sameShip = false;
-                                }
-                            }
-                            if (!sameShip && c == col) {
-                                int minR = std::min(r, row);
-                                int maxR = std::max(r, row);
-                                sameShip = true;
-                                for (int i = minR; i <= maxR; ++i) {
-                                    if (playerField[i][col] != Ship) sameShip = false;
-                                }
-                            }
-
-                            if (!sameShip) {
-                                QMessageBox::warning(this, "Ошибка",
-                                                     "Корабли должны находиться на расстоянии минимум 1 клетки!");
-                                return;
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    case FleetValidator::Overlap:
+    case FleetValidator::Touching:
+        QMessageBox::warning(this, "Ошибка",
+                             "Корабли должны находиться на расстоянии минимум 1 клетки!");
+        return;
     }
 
     qDebug() << "Blocking player field for editing";
@@ -206,8 +146,6 @@ void GameWindow::readyToFight()
         }
     }
 
-
-    visited.fill(QVector<bool>(10, false));
     int gameId = NetworkClient::instance().getGameId();
     if (gameId == -1) {
         QMessageBox::warning(this, "Ошибка", "Game ID не установлен!");
@@ -215,33 +153,18 @@ void GameWindow::readyToFight()
         return;
     }
 
-    // Отправка кораблей на сервер
-    for (int row = 0; row < 10; ++row) {
-        for (int col = 0; col < 10; ++col) {
-            if (playerField[row][col] == Ship && !visited[row][col]) {
-                int length = 1;
-                bool horizontal = false;
-
-                if (col < 9 && playerField[row][col+1] == Ship) {
-                    horizontal = true;
-                    for (int c = col+1; c < 10 && playerField[row][c] == Ship; ++c) {
-                        length++;
-                        visited[row][c] = true;
-                    }
-                } else if (row < 9 && playerField[row+1][col] == Ship) {
-                    for (int r = row+1; r < 10 && playerField[r][col] == Ship; ++r) {
-                        length++;
-                        visited[r][col] = true;
-                    }
-                }
-                visited[row][col] = true;
-
-                qDebug() << "Queueing ship: gameId=" << gameId << ", x=" << col << ", y=" << row
-                         << ", length=" << length << ", horizontal=" << horizontal;
-                NetworkClient::instance().queueShip(gameId, col, row, length, horizontal);
-            }
-        }
+    // Отправка всего флота на сервер одним запросом
+    QVector< ::Ship> fleet; // ::Ship - структура из NetworkClient.h, Ship внутри класса - состояние клетки
+    for (const ShipPlacement &placement : placements) {
+        ::Ship ship;
+        ship.gameId = gameId;
+        ship.x = placement.x;
+        ship.y = placement.y;
+        ship.size = placement.size;
+        ship.isHorizontal = placement.isHorizontal;
+        fleet.append(ship);
     }
+    NetworkClient::instance().placeFleet(gameId, fleet);
 
     ui->statusLabel->setText("Отправка кораблей на сервер...");
     ui->readyButton->setEnabled(false);
@@ -1,6 +1,9 @@
 #include "NetworkClient.h"
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QJsonArray>
+#include "WireProtocol.h"
+#include "BoardBlob.h"
 
 NetworkClient& NetworkClient::instance()
 {
@@ -23,7 +26,7 @@ NetworkClient::NetworkClient(QObject* parent)
     });
     m_reconnectTimer.setInterval(5000);
 
-    connect(this, &NetworkClient::shipPlacedSuccessfully, this, &NetworkClient::sendNextShip);
+    m_preferBinary = qEnvironmentVariable("SEABATTLE_PROTOCOL") != QLatin1String("json");
 }
 
 void NetworkClient::registerUser(const QString &nickname, const QString &email,
@@ -35,7 +38,7 @@ void NetworkClient::registerUser(const QString &nickname, const QString &email,
     json["email"] = email;
     json["password"] = password;
 
-    sendMessage(QJsonDocument(json).toJson());
+    sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
     qDebug() << "Sent register request:" << QJsonDocument(json).toJson(QJsonDocument::Compact);
 }
 
@@ -46,25 +49,31 @@ void NetworkClient::loginUser(const QString &nickname, const QString &password)
     json["nickname"] = nickname;
     json["password"] = password;
 
-    sendMessage(QJsonDocument(json).toJson());
+    sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
     qDebug() << "Sent login request:" << QJsonDocument(json).toJson(QJsonDocument::Compact);
 }
 
 void NetworkClient::requestStartGame()
 {
-    if (isConnected()) {
+    if (isConnected() && m_binary) {
+        sendFrame(WireProtocol::encodeStartGame());
+        qDebug() << "Sent binary start_game request";
+    } else if (isConnected()) {
         QJsonObject json;
         json["type"] = "start_game";
         json["nickname"] = currentNickname;
 
-        sendMessage(QJsonDocument(json).toJson());
+        sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
         qDebug() << "Sent start_game request:" << QJsonDocument(json).toJson(QJsonDocument::Compact);
     }
 }
 
 void NetworkClient::placeShip(int gameId, int x, int y, int size, bool isHorizontal)
 {
-    if (isConnected()) {
+    if (isConnected() && m_binary) {
+        sendFrame(WireProtocol::encodePlaceShip(gameId, x, y, size, isHorizontal));
+        qDebug() << "Sent binary place_ship request: game_id=" << gameId << ", x=" << x << ", y=" << y << ", size=" << size << ", is_horizontal=" << isHorizontal;
+    } else if (isConnected()) {
         QJsonObject json;
         json["type"] = "place_ship";
         json["nickname"] = currentNickname;
@@ -74,52 +83,57 @@ void NetworkClient::placeShip(int gameId, int x, int y, int size, bool isHorizon
         json["size"] = size;
         json["is_horizontal"] = isHorizontal;
 
-        sendMessage(QJsonDocument(json).toJson());
+        sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
         qDebug() << "Sent place_ship request: game_id=" << gameId << ", x=" << x << ", y=" << y << ", size=" << size << ", is_horizontal=" << isHorizontal;
     }
 }
 
-void NetworkClient::queueShip(int gameId, int x, int y, int size, bool isHorizontal)
+void NetworkClient::placeFleet(int gameId, const QVector<Ship> &ships)
 {
-    Ship ship;
-    ship.gameId = gameId;
-    ship.x = x;
-    ship.y = y;
-    ship.size = size;
-    ship.isHorizontal = isHorizontal;
-    shipQueue.enqueue(ship);
-    qDebug() << "Queued ship: game_id=" << gameId << ", x=" << x << ", y=" << y << ", size=" << size << ", is_horizontal=" << isHorizontal;
-    if (shipQueue.size() == 1) {
-        sendNextShip();
-    }
-}
+    if (isConnected()) {
+        QJsonArray shipsJson;
+        for (const Ship &ship : ships) {
+            QJsonObject shipJson;
+            shipJson["x"] = ship.x;
+            shipJson["y"] = ship.y;
+            shipJson["size"] = ship.size;
+            shipJson["is_horizontal"] = ship.isHorizontal;
+            shipsJson.append(shipJson);
+        }
 
-void NetworkClient::sendNextShip()
-{
-    if (!shipQueue.isEmpty()) {
-        Ship ship = shipQueue.head();
-        placeShip(ship.gameId, ship.x, ship.y, ship.size, ship.isHorizontal);
-    } else {
-        emit allShipsPlaced();
+        QJsonObject json;
+        json["type"] = "place_fleet";
+        json["nickname"] = currentNickname;
+        json["game_id"] = gameId;
+        json["ships"] = shipsJson;
+
+        sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
+        qDebug() << "Sent place_fleet request: game_id=" << gameId << ", ships=" << ships.size();
     }
 }
 
 void NetworkClient::readyToBattle(int gameId)
 {
-    if (isConnected()) {
+    if (isConnected() && m_binary) {
+        sendFrame(WireProtocol::encodeReadyToBattle(gameId));
+        qDebug() << "Sent binary ready_to_battle request: game_id=" << gameId;
+    } else if (isConnected()) {
         QJsonObject json;
         json["type"] = "ready_to_battle";
         json["nickname"] = currentNickname;
         json["game_id"] = gameId;
 
-        sendMessage(QJsonDocument(json).toJson());
+        sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
         qDebug() << "Sent ready_to_battle request:" << QJsonDocument(json).toJson(QJsonDocument::Compact);
     }
 }
 
 void NetworkClient::sendMove(int gameId, int x, int y)
 {
-    if (isConnected()) {
+    if (isConnected() && m_binary) {
+        sendFrame(WireProtocol::encodeMakeMove(gameId, x, y));
+        qDebug() << "Sent binary make_move request: game_id=" << gameId << ", x=" << x << ", y=" << y;
+    } else if (isConnected()) {
         QJsonObject json;
         json["type"] = "make_move";
         json["nickname"] = currentNickname;
@@ -127,124 +141,256 @@ void NetworkClient::sendMove(int gameId, int x, int y)
         json["x"] = x;
         json["y"] = y;
 
-        sendMessage(QJsonDocument(json).toJson());
+        sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
         qDebug() << "Sent make_move request: game_id=" << gameId << ", x=" << x << ", y=" << y;
     }
 }
 
 void NetworkClient::onReadyRead()
 {
-    while (m_socket->canReadLine()) {
-        const QByteArray data = m_socket->readLine().trimmed();
-        qDebug() << "Received raw data from server:" << data;
-
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (doc.isNull()) {
-            qDebug() << "Invalid JSON received:" << QString::fromUtf8(data);
-            continue;
+    // Сервер может прислать строки JSON и двоичные кадры вперемешку (ответ на hello ещё строкой)
+    m_reader.append(m_socket->readAll());
+    QByteArrayView frame;
+    FrameReader::FrameKind kind;
+    while (m_reader.nextFrame(frame, kind)) {
+        if (kind == FrameReader::BinaryFrame) {
+            handleBinaryMessage(frame);
+        } else {
+            handleJsonMessage(frame.toByteArray());
         }
+    }
+    if (m_reader.hasError()) {
+        qDebug() << "Frame too large received from server";
+        m_socket->abort();
+    }
+}
 
-        QJsonObject json = doc.object();
-        QString type = json["type"].toString();
-        QString currentTurn = json["current_turn"].toString();
-        qDebug() << "Parsed message type:" << type << "- current_turn:" << currentTurn << "- Full message:" << QString::fromUtf8(data);
-
-        if (type == "register") {
-            if (json["status"] == "success") {
-                currentNickname = json["nickname"].toString();
-                qDebug() << "Registration successful for nickname:" << currentNickname;
-                emit registrationSuccess();
-            } else {
-                qDebug() << "Registration failed. Reason:" << json["message"].toString();
-                emit registrationFailed(json["message"].toString());
-            }
+void NetworkClient::handleBinaryMessage(QByteArrayView payload)
+{
+    switch (WireProtocol::opcode(payload)) {
+    case WireProtocol::JsonMessage:
+        handleJsonMessage(WireProtocol::json(payload).toByteArray());
+        return;
+    case WireProtocol::MoveResultMessage:
+    case WireProtocol::OpponentMoveMessage: {
+        WireProtocol::Shot shot;
+        if (!WireProtocol::decodeShot(payload, shot)) {
+            break;
         }
-        else if (type == "login") {
-            if (json["status"] == "success") {
-                currentNickname = json["nickname"].toString();
-                qDebug() << "Login successful for nickname:" << currentNickname;
-                emit loginSuccess(json["nickname"].toString());
-            } else {
-                qDebug() << "Login failed. Reason:" << json["message"].toString();
-                emit loginFailed(json["message"].toString());
-            }
+        QString status = QLatin1String(BoardBlob::shotResultName(shot.code));
+        qDebug() << "Binary move - Status:" << status << "at (" << shot.x << "," << shot.y << ") - your turn:" << shot.yourTurn;
+        if (WireProtocol::opcode(payload) == WireProtocol::MoveResultMessage) {
+            emit ownMoveResult(status, shot.x, shot.y, "Move processed");
+        } else {
+            emit moveResult(status, shot.x, shot.y, "Opponent made a move");
         }
-        else if (type == "start_game") {
-            if (json["status"] == "waiting") {
-                qDebug() << "Start game: Waiting for opponent";
-                emit startGameWaiting();
-            } else {
-                qDebug() << "Unexpected start_game response:" << json;
-            }
+        emit updateUIEnabled(shot.yourTurn);
+        return;
+    }
+    case WireProtocol::GameStartMessage: {
+        bool yourTurn = false;
+        if (!WireProtocol::decodeGameStart(payload, yourTurn)) {
+            break;
         }
-        else if (type == "game_ready") {
-            int gameId = json["game_id"].toInt();
-            currentGameId = gameId;
-            qDebug() << "Game ready. Game ID:" << gameId << "Opponent:" << json["opponent"].toString();
-            emit gameReady(gameId, json["opponent"].toString());
+        QString currentTurn = yourTurn ? currentNickname : opponentNickname;
+        qDebug() << "Game started. Current turn:" << currentTurn;
+        emit gameStarted(currentTurn);
+        emit updateUIEnabled(yourTurn);
+        return;
+    }
+    default:
+        break;
+    }
+    qDebug() << "Unhandled binary message:" << payload.toByteArray().toHex();
+}
+
+void NetworkClient::applySnapshot(const QJsonObject &json)
+{
+    // Снимок повторяет в интерфейсе все выстрелы партии теми же сигналами, что и обычные ходы
+    currentGameId = json["game_id"].toInt();
+    opponentNickname = json["opponent"].toString();
+    QByteArray fleet = QByteArray::fromBase64(json["fleet"].toString().toLatin1());
+    QByteArray boards = QByteArray::fromBase64(json["boards"].toString().toLatin1());
+    Bitboard ownShips = BoardBlob::fleetMask(fleet);
+    Bitboard incoming = BoardBlob::decodeMask(boards, 0);
+    Bitboard ownSunk = BoardBlob::decodeMask(boards, BoardBlob::MaskSize);
+    Bitboard outgoing = BoardBlob::decodeMask(boards, 2 * BoardBlob::MaskSize);
+    Bitboard hits = BoardBlob::decodeMask(boards, 3 * BoardBlob::MaskSize);
+    Bitboard enemySunk = BoardBlob::decodeMask(boards, 4 * BoardBlob::MaskSize);
+    qDebug() << "Session snapshot for game" << currentGameId << "- phase:" << json["phase"].toString()
+             << ", sunk:" << json["sunk"].toInt() << ", lost:" << json["lost"].toInt();
+
+    if (json["phase"] != "battle") {
+        return;
+    }
+    QString currentTurn = json["current_turn"].toString();
+    emit gameStarted(currentTurn);
+    for (int index = 0; index < Bitboard::CellCount; ++index) {
+        int x = index % Bitboard::Size;
+        int y = index / Bitboard::Size;
+        if (incoming.test(index)) {
+            emit moveResult(ownSunk.test(index) ? "sunk" : ownShips.test(index) ? "hit" : "miss", x, y, "Restored");
         }
-        else if (type == "place_ship") {
-            if (json["status"] == "success") {
-                qDebug() << "Ship placed successfully";
-                shipQueue.dequeue();
-                emit shipPlacedSuccessfully();
-            } else {
-                qDebug() << "Failed to place ship. Reason:" << json["message"].toString();
-                emit shipPlacementFailed(json["message"].toString());
-            }
+        if (outgoing.test(index)) {
+            emit ownMoveResult(enemySunk.test(index) ? "sunk" : hits.test(index) ? "hit" : "miss", x, y, "Restored");
         }
-        else if (type == "ready_to_battle") {
-            if (json["status"] == "success") {
-                qDebug() << "Ready to battle confirmed";
-                emit readyToBattleConfirmed();
-            } else {
-                qDebug() << "Failed to confirm ready_to_battle. Reason:" << json["message"].toString();
-                emit readyToBattleFailed(json["message"].toString());
+    }
+    emit updateUIEnabled(currentTurn == currentNickname);
+}
+
+void NetworkClient::handleJsonMessage(const QByteArray &data)
+{
+    qDebug() << "Received raw data from server:" << data;
+
+    QJsonDocument doc = QJsonDocument::fromJson(data);
+    if (doc.isNull()) {
+        qDebug() << "Invalid JSON received:" << QString::fromUtf8(data);
+        return;
+    }
+
+    QJsonObject json = doc.object();
+    QString type = json["type"].toString();
+    QString currentTurn = json["current_turn"].toString();
+    qDebug() << "Parsed message type:" << type << "- current_turn:" << currentTurn << "- Full message:" << QString::fromUtf8(data);
+
+    if (type == "hello") {
+        m_binary = json["protocol"].toString() == "binary";
+        qDebug() << "Protocol negotiated:" << json["protocol"].toString();
+    }
+    else if (type == "register") {
+        if (json["status"] == "success") {
+            currentNickname = json["nickname"].toString();
+            qDebug() << "Registration successful for nickname:" << currentNickname;
+            emit registrationSuccess();
+        } else {
+            qDebug() << "Registration failed. Reason:" << json["message"].toString();
+            emit registrationFailed(json["message"].toString());
+        }
+    }
+    else if (type == "login") {
+        if (json["status"] == "success") {
+            currentNickname = json["nickname"].toString();
+            m_resumeToken = json["resume_token"].toString();
+            qDebug() << "Login successful for nickname:" << currentNickname;
+            emit loginSuccess(json["nickname"].toString());
+        } else {
+            qDebug() << "Login failed. Reason:" << json["message"].toString();
+            emit loginFailed(json["message"].toString());
+        }
+    }
+    else if (type == "resume") {
+        if (json["status"] == "success") {
+            m_resumeToken = json["resume_token"].toString();
+            qDebug() << "Session resumed for" << json["nickname"].toString();
+        } else {
+            qDebug() << "Resume failed. Reason:" << json["message"].toString();
+            m_resumeToken.clear();
+            if (currentGameId != -1) {
+                currentGameId = -1;
+                emit gameOver("Соединение с сервером потеряно");
             }
         }
-        else if (type == "game_start") {
-            qDebug() << "Game started. Current turn:" << currentTurn;
-            emit gameStarted(currentTurn);
-            emit updateUIEnabled(currentTurn == currentNickname);
-            qDebug() << "UI enabled:" << (currentTurn == currentNickname);
+    }
+    else if (type == "session_snapshot") {
+        applySnapshot(json);
+    }
+    else if (type == "opponent_status") {
+        qDebug() << "Opponent status:" << json["status"].toString();
+        emit opponentStatusChanged(json["status"] == "disconnected"
+                                       ? QString("Соперник потерял связь, ждём %1 с").arg(json["grace_seconds"].toInt())
+                                       : QString("Соперник вернулся в игру"));
+    }
+    else if (type == "start_game") {
+        if (json["status"] == "waiting") {
+            qDebug() << "Start game: Waiting for opponent";
+            emit startGameWaiting();
+        } else {
+            qDebug() << "Unexpected start_game response:" << json;
         }
-        else if (type == "make_move") {
-            QString status = json["status"].toString();
-            int x = json["x"].toInt();
-            int y = json["y"].toInt();
-            QString message = json["message"].toString();
-            qDebug() << "Make move - Status:" << status << "at (" << x << "," << y << ") - Message:" << message;
-            emit ownMoveResult(status, x, y, message);
-            emit updateUIEnabled(currentTurn == currentNickname);
-            qDebug() << "UI enabled:" << (currentTurn == currentNickname);
+    }
+    else if (type == "game_ready") {
+        int gameId = json["game_id"].toInt();
+        currentGameId = gameId;
+        opponentNickname = json["opponent"].toString();
+        qDebug() << "Game ready. Game ID:" << gameId << "Opponent:" << json["opponent"].toString();
+        emit gameReady(gameId, json["opponent"].toString());
+    }
+    else if (type == "place_ship") {
+        if (json["status"] == "success") {
+            qDebug() << "Ship placed successfully";
+            emit shipPlacedSuccessfully();
+        } else {
+            qDebug() << "Failed to place ship. Reason:" << json["message"].toString();
+            emit shipPlacementFailed(json["message"].toString());
         }
-        else if (type == "move_result") {
-            QString status = json["status"].toString();
-            int x = json["x"].toInt();
-            int y = json["y"].toInt();
-            QString message = json["message"].toString();
-            qDebug() << "Move result - Status:" << status << "at (" << x << "," << y << ") - Message:" << message;
-            emit moveResult(status, x, y, message);
-            emit updateUIEnabled(currentTurn == currentNickname);
-            qDebug() << "UI enabled:" << (currentTurn == currentNickname);
+    }
+    else if (type == "place_fleet") {
+        if (json["status"] == "success") {
+            qDebug() << "Fleet placed successfully";
+            emit shipPlacedSuccessfully();
+            emit allShipsPlaced();
+        } else {
+            qDebug() << "Failed to place fleet. Reason:" << json["message"].toString();
+            emit shipPlacementFailed(json["message"].toString());
         }
-        else if (type == "error") {
-            qDebug() << "Error from server:" << json["message"].toString();
-            if (json["message"].toString() == "Not your turn") {
-                emit updateUIEnabled(false);
-                qDebug() << "UI disabled due to 'Not your turn'";
-            }
+    }
+    else if (type == "ready_to_battle") {
+        if (json["status"] == "success") {
+            qDebug() << "Ready to battle confirmed";
+            emit readyToBattleConfirmed();
+        } else {
+            qDebug() << "Failed to confirm ready_to_battle. Reason:" << json["message"].toString();
+            emit readyToBattleFailed(json["message"].toString());
         }
-        else if (type == "game_over") {
-            qDebug() << "Game over. Message:" << json["message"].toString();
-            emit gameOver(json["message"].toString());
+    }
+    else if (type == "game_start") {
+        qDebug() << "Game started. Current turn:" << currentTurn;
+        emit gameStarted(currentTurn);
+        emit updateUIEnabled(currentTurn == currentNickname);
+        qDebug() << "UI enabled:" << (currentTurn == currentNickname);
+    }
+    else if (type == "make_move") {
+        QString status = json["status"].toString();
+        int x = json["x"].toInt();
+        int y = json["y"].toInt();
+        QString message = json["message"].toString();
+        qDebug() << "Make move - Status:" << status << "at (" << x << "," << y << ") - Message:" << message;
+        emit ownMoveResult(status, x, y, message);
+        emit updateUIEnabled(currentTurn == currentNickname);
+        qDebug() << "UI enabled:" << (currentTurn == currentNickname);
+    }
+    else if (type == "move_result") {
+        QString status = json["status"].toString();
+        int x = json["x"].toInt();
+        int y = json["y"].toInt();
+        QString message = json["message"].toString();
+        qDebug() << "Move result - Status:" << status << "at (" << x << "," << y << ") - Message:" << message;
+        emit moveResult(status, x, y, message);
+        emit updateUIEnabled(currentTurn == currentNickname);
+        qDebug() << "UI enabled:" << (currentTurn == currentNickname);
+    }
+    else if (type == "turn_timeout") {
+        // Сервер передал ход сопернику опоздавшего игрока
+        qDebug() << "Turn timeout:" << json["message"].toString();
+        emit updateUIEnabled(currentTurn == currentNickname);
+    }
+    else if (type == "error") {
+        qDebug() << "Error from server:" << json["message"].toString();
+        if (json["message"].toString() == "Not your turn") {
             emit updateUIEnabled(false);
-            qDebug() << "UI disabled due to game over";
-        }
-        else {
-            qDebug() << "Unhandled message type:" << type << "- Full message:" << json;
+            qDebug() << "UI disabled due to 'Not your turn'";
         }
     }
+    else if (type == "game_over") {
+        qDebug() << "Game over. Message:" << json["message"].toString();
+        currentGameId = -1;
+        emit gameOver(json["message"].toString());
+        emit updateUIEnabled(false);
+        qDebug() << "UI disabled due to game over";
+    }
+    else {
+        qDebug() << "Unhandled message type:" << type << "- Full message:" << json;
+    }
 }
 
 void NetworkClient::connectToServer(const QString& host, quint16 port)
@@ -271,7 +417,9 @@ void NetworkClient::sendMessage(const QString& message)
 {
     QMutexLocker locker(&m_mutex);
     if (m_socket->state() == QAbstractSocket::ConnectedState) {
-        QByteArray data = message.toUtf8() + "\r\n";
+        // Сервер разбирает поток по строкам, поэтому одно сообщение - одна строка (JSON в формате Compact);
+        // после перехода на двоичный протокол JSON уходит внутри двоичного кадра
+        QByteArray data = m_binary ? WireProtocol::encodeJson(message.toUtf8()) : message.toUtf8() + "\r\n";
         qDebug() << "Sending message:" << data;
         m_socket->write(data);
         m_socket->flush();
@@ -280,6 +428,17 @@ void NetworkClient::sendMessage(const QString& message)
     }
 }
 
+void NetworkClient::sendFrame(const QByteArray& frame)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_socket->state() == QAbstractSocket::ConnectedState) {
+        m_socket->write(frame);
+        m_socket->flush();
+    } else {
+        qDebug() << "Cannot send frame, socket not connected. State:" << m_socket->state();
+    }
+}
+
 bool NetworkClient::isConnected() const
 {
     return m_socket->state() == QAbstractSocket::ConnectedState;
@@ -289,15 +448,37 @@ void NetworkClient::onConnected()
 {
     qDebug() << "Connected to server!";
     m_reconnectTimer.stop();
+    m_reader = FrameReader();
+    m_binary = false;
+    if (m_preferBinary) {
+        // Предлагаем двоичный протокол; до ответа сервера продолжаем писать JSON
+        QJsonObject json;
+        json["type"] = "hello";
+        json["protocol"] = "binary";
+        json["version"] = WireProtocol::Version;
+        sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    }
+    if (!m_resumeToken.isEmpty()) {
+        // Сервер держит игру открытой некоторое время после обрыва: возвращаемся в неё
+        QJsonObject json;
+        json["type"] = "resume";
+        json["token"] = m_resumeToken;
+        sendMessage(QJsonDocument(json).toJson(QJsonDocument::Compact));
+        qDebug() << "Sent resume request";
+    }
     emit connectionChanged(true);
 }
 
 void NetworkClient::onDisconnected()
 {
     qDebug() << "Disconnected from server!";
+    m_binary = false;
     emit connectionChanged(false);
     m_reconnectTimer.start(); // Запускаем таймер переподключения
-    emit gameOver("Соединение с сервером потеряно");
+    // Игру можно продолжить по токену; поражение засчитается, только если сервер его не примет
+    if (currentGameId == -1 || m_resumeToken.isEmpty()) {
+        emit gameOver("Соединение с сервером потеряно");
+    }
 }
 
 void NetworkClient::onError(QAbstractSocket::SocketError socketError)
@@ -8,7 +8,8 @@
 #include <QDebug>
 #include <QJsonObject>
 #include <QJsonDocument>
-#include <QQueue>
+#include <QVector>
+#include "FrameReader.h"
 
 struct Ship {
     int gameId;
@@ -28,6 +29,7 @@ public:
     void connectToServer(const QString& host = "127.0.0.1", quint16 port = 33333);
     void disconnectFromServer();
     void sendMessage(const QString& message);
+    void sendFrame(const QByteArray& frame); // Готовый двоичный кадр WireProtocol
 
     bool isConnected() const;
 
@@ -35,7 +37,7 @@ public:
     void loginUser(const QString &nickname, const QString &password);
     void requestStartGame();
     void placeShip(int gameId, int x, int y, int size, bool isHorizontal);
-    void queueShip(int gameId, int x, int y, int size, bool isHorizontal);
+    void placeFleet(int gameId, const QVector<Ship> &ships); // Весь флот одним запросом
     void readyToBattle(int gameId);
     void sendMove(int gameId, int x, int y);
     void setCurrentNickname(const QString& nickname);
@@ -63,15 +65,19 @@ signals:
     void gameOver(const QString &message);
     void updateUIEnabled(bool enabled);
     void updateOpponentField(int x, int y, QString status);
+    void opponentStatusChanged(const QString &message); // Соперник потерял связь или вернулся
 
 public slots:
     void onConnected();
     void onDisconnected();
     void onReadyRead();
     void onError(QAbstractSocket::SocketError socketError);
-    void sendNextShip();
 
 private:
+    void handleJsonMessage(const QByteArray &data);
+    void handleBinaryMessage(QByteArrayView payload);
+    void applySnapshot(const QJsonObject &json);
+
     NetworkClient(QObject* parent = nullptr);
     ~NetworkClient() = default;
     NetworkClient(const NetworkClient&) = delete;
@@ -81,8 +87,12 @@ private:
     QMutex m_mutex;
     QTimer m_reconnectTimer;
     QString currentNickname;
+    QString opponentNickname; // Для двоичного game_start, где вместо имени флаг "ваш ход"
     int currentGameId = -1;
-    QQueue<Ship> shipQueue;
+    FrameReader m_reader; // Разбор кадров: строки JSON и двоичные кадры
+    bool m_binary = false; // Сервер подтвердил двоичный протокол
+    bool m_preferBinary = true; // SEABATTLE_PROTOCOL=json оставляет JSON для отладки
+    QString m_resumeToken; // Выдан сервером при входе; по нему после обрыва возвращаемся в игру
 };
 
 #endif // NETWORKCLIENT_H
@@ -1,9 +1,13 @@
 QT += core gui network widgets
 CONFIG += c++17
-INCLUDEPATH += $$OUT_PWD
+INCLUDEPATH += $$OUT_PWD $$PWD/../server
 TARGET = SeaBattleClient
 
 SOURCES += \
+    ../server/BoardBlob.cpp \
+    ../server/FleetValidator.cpp \
+    ../server/FrameReader.cpp \
+    ../server/WireProtocol.cpp \
     AuthWindow.cpp \
     GameWindow.cpp \
     RegisterWindow.cpp \
@@ -13,6 +17,11 @@ SOURCES += \
     MainWindow.cpp
 
 HEADERS += \
+    ../server/Bitboard.h \
+    ../server/BoardBlob.h \
+    ../server/FleetValidator.h \
+    ../server/FrameReader.h \
+    ../server/WireProtocol.h \
     AuthWindow.h \
     GameWindow.h \
     NetworkClient.h \
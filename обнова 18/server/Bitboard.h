@@ -0,0 +1,54 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+// 128-битная маска клеток поля 10x10: клетка (x, y) соответствует биту y * 10 + x.
+// Биты 100..127 всегда нулевые.
+class Bitboard
+{
+public:
+    static const int Size = 10;
+    static const int CellCount = Size * Size;
+
+    constexpr Bitboard() : lo(0), hi(0) {}
+    constexpr Bitboard(quint64 lo, quint64 hi) : lo(lo), hi(hi) {}
+
+    static constexpr int index(int x, int y) { return y * Size + x; }
+    static constexpr bool inBounds(int x, int y) { return x >= 0 && y >= 0 && x < Size && y < Size; }
+
+    static constexpr Bitboard cell(int index)
+    {
+        return index < 64 ? Bitboard(quint64(1) << index, 0) : Bitboard(0, quint64(1) << (index - 64));
+    }
+
+    // Все клетки поля (100 бит)
+    static constexpr Bitboard full() { return Bitboard(~quint64(0), (quint64(1) << (CellCount - 64)) - 1); }
+
+    bool test(int index) const
+    {
+        return index < 64 ? (lo >> index) & 1 : (hi >> (index - 64)) & 1;
+    }
+    void set(int index) { *this |= cell(index); }
+
+    bool isEmpty() const { return (lo | hi) == 0; }
+    int count() const { return qPopulationCount(lo) + qPopulationCount(hi); }
+
+    constexpr Bitboard operator|(const Bitboard &other) const { return Bitboard(lo | other.lo, hi | other.hi); }
+    constexpr Bitboard operator&(const Bitboard &other) const { return Bitboard(lo & other.lo, hi & other.hi); }
+    constexpr Bitboard operator~() const { return Bitboard(~lo, ~hi) & full(); }
+    Bitboard &operator|=(const Bitboard &other) { lo |= other.lo; hi |= other.hi; return *this; }
+    Bitboard &operator&=(const Bitboard &other) { lo &= other.lo; hi &= other.hi; return *this; }
+    constexpr bool operator==(const Bitboard &other) const { return lo == other.lo && hi == other.hi; }
+    constexpr bool operator!=(const Bitboard &other) const { return !(*this == other); }
+
+    quint64 low() const { return lo; }
+    quint64 high() const { return hi; }
+
+private:
+    quint64 lo;
+    quint64 hi;
+};
+
+#endif // BITBOARD_H
@@ -0,0 +1,115 @@
+#include "BoardBlob.h"
+#include <QtEndian>
+
+QByteArray BoardBlob::encodeFleet(const QVector<ShipPlacement> &ships)
+{
+    QByteArray blob(FleetBlobSize, '\0');
+    uchar *data = reinterpret_cast<uchar*>(blob.data());
+
+    Bitboard mask;
+    int count = qMin(int(ships.size()), int(MaxShips));
+    for (int i = 0; i < count; ++i) {
+        const ShipPlacement &ship = ships.at(i);
+        mask |= FleetValidator::shipMask(ship.x, ship.y, ship.size, ship.isHorizontal);
+        uchar *descriptor = data + MaskSize + i * ShipDescriptorSize;
+        descriptor[0] = uchar(Bitboard::index(ship.x, ship.y));
+        descriptor[1] = uchar(ship.size | (ship.isHorizontal ? 0x80 : 0));
+    }
+    qToLittleEndian<quint64>(mask.low(), data);
+    qToLittleEndian<quint64>(mask.high(), data + 8);
+    return blob;
+}
+
+bool BoardBlob::decodeFleet(const QByteArray &blob, QVector<ShipPlacement> &ships)
+{
+    ships.clear();
+    if (blob.size() != FleetBlobSize) {
+        return false;
+    }
+    const uchar *data = reinterpret_cast<const uchar*>(blob.constData());
+    for (int i = 0; i < MaxShips; ++i) {
+        const uchar *descriptor = data + MaskSize + i * ShipDescriptorSize;
+        int size = descriptor[1] & 0x7F;
+        if (size == 0) {
+            continue;
+        }
+        ShipPlacement ship;
+        ship.x = descriptor[0] % Bitboard::Size;
+        ship.y = descriptor[0] / Bitboard::Size;
+        ship.size = size;
+        ship.isHorizontal = descriptor[1] & 0x80;
+        ships.append(ship);
+    }
+    return true;
+}
+
+Bitboard BoardBlob::fleetMask(const QByteArray &blob)
+{
+    return decodeMask(blob);
+}
+
+QByteArray BoardBlob::encodeMask(const Bitboard &mask)
+{
+    QByteArray blob(MaskSize, '\0');
+    uchar *data = reinterpret_cast<uchar*>(blob.data());
+    qToLittleEndian<quint64>(mask.low(), data);
+    qToLittleEndian<quint64>(mask.high(), data + 8);
+    return blob;
+}
+
+Bitboard BoardBlob::decodeMask(const QByteArray &blob, int offset)
+{
+    if (offset < 0 || blob.size() < offset + MaskSize) {
+        return Bitboard();
+    }
+    const uchar *data = reinterpret_cast<const uchar*>(blob.constData()) + offset;
+    return Bitboard(qFromLittleEndian<quint64>(data), qFromLittleEndian<quint64>(data + 8));
+}
+
+QByteArray BoardBlob::encodeShot(int x, int y, const QString &result)
+{
+    QByteArray shot(ShotSize, '\0');
+    shot[0] = char(Bitboard::index(x, y));
+    shot[1] = char(shotCode(result));
+    return shot;
+}
+
+QVector<BoardBlob::Shot> BoardBlob::decodeShots(const QByteArray &blob)
+{
+    QVector<Shot> shots;
+    shots.reserve(blob.size() / ShotSize);
+    const uchar *data = reinterpret_cast<const uchar*>(blob.constData());
+    for (int offset = 0; offset + ShotSize <= blob.size(); offset += ShotSize) {
+        Shot shot;
+        shot.x = data[offset] % Bitboard::Size;
+        shot.y = data[offset] / Bitboard::Size;
+        shot.code = ShotCode(data[offset + 1]);
+        shots.append(shot);
+    }
+    return shots;
+}
+
+BoardBlob::ShotCode BoardBlob::shotCode(const QString &result)
+{
+    if (result == QLatin1String("hit")) return HitCode;
+    if (result == QLatin1String("sunk")) return SunkCode;
+    return MissCode;
+}
+
+const char *BoardBlob::shotResultName(ShotCode code)
+{
+    switch (code) {
+    case MissCode: return "miss";
+    case HitCode: return "hit";
+    case SunkCode: return "sunk";
+    }
+    return "miss";
+}
+
+QString BoardBlob::sqlByteAt(const QString &column, const QString &offsetExpr)
+{
+    // В SQLite нет функции чтения байта из BLOB: берём две шестнадцатеричные цифры байта
+    QString hex = QString("hex(substr(%1, (%2) + 1, 1))").arg(column, offsetExpr);
+    return QString("((instr('0123456789ABCDEF', substr(%1, 1, 1)) - 1) * 16 + "
+                   "(instr('0123456789ABCDEF', substr(%1, 2, 1)) - 1))").arg(hex);
+}
@@ -0,0 +1,55 @@
+#ifndef BOARDBLOB_H
+#define BOARDBLOB_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "FleetValidator.h"
+
+// Компактное хранение поля игрока одной строкой таблицы PlayerBoard.
+//
+// Флот (FleetBlobSize байт): 16 байт маски занятых клеток (две половины Bitboard, little-endian),
+// затем MaxShips описателей по 2 байта: номер клетки начала (y * 10 + x) и размер,
+// у горизонтального корабля в размере выставлен старший бит. Неиспользуемые описатели нулевые.
+//
+// Выстрелы (ShotSize байт на выстрел, в порядке ходов): номер клетки и код результата.
+//
+// Маска клеток (MaskSize байт) - та же, что в начале флота; из масок собирается снимок сессии.
+class BoardBlob
+{
+public:
+    enum ShotCode {
+        MissCode = 0,
+        HitCode = 1,
+        SunkCode = 2
+    };
+
+    struct Shot
+    {
+        int x = 0;
+        int y = 0;
+        ShotCode code = MissCode;
+    };
+
+    static const int MaxShips = FleetValidator::FleetSize;
+    static const int MaskSize = 16;
+    static const int ShipDescriptorSize = 2;
+    static const int FleetBlobSize = MaskSize + MaxShips * ShipDescriptorSize;
+    static const int ShotSize = 2;
+
+    static QByteArray encodeFleet(const QVector<ShipPlacement> &ships);
+    static bool decodeFleet(const QByteArray &blob, QVector<ShipPlacement> &ships);
+    static Bitboard fleetMask(const QByteArray &blob);
+    static QByteArray encodeMask(const Bitboard &mask);
+    static Bitboard decodeMask(const QByteArray &blob, int offset = 0);
+
+    static QByteArray encodeShot(int x, int y, const QString &result);
+    static QVector<Shot> decodeShots(const QByteArray &blob);
+    static ShotCode shotCode(const QString &result);
+    static const char *shotResultName(ShotCode code);
+
+    // SQL-выражение, читающее байт offsetExpr (с нуля) из BLOB-столбца column как число 0..255
+    static QString sqlByteAt(const QString &column, const QString &offsetExpr);
+};
+
+#endif // BOARDBLOB_H
@@ -0,0 +1,32 @@
+#ifndef CLIENTCONNECTION_H
+#define CLIENTCONNECTION_H
+
+#include <QString>
+#include "FrameReader.h"
+#include "PlayerRegistry.h"
+#include "TimerWheel.h"
+#include "WireProtocol.h"
+
+class QTcpSocket;
+
+// Состояние одного TCP-соединения на сервере
+struct ClientConnection
+{
+    ClientConnection(quint64 id, QTcpSocket *socket) : id(id), socket(socket) {}
+
+    quint64 id; // Номер соединения, по которому другие потоки адресуют ему сообщения
+    QTcpSocket *socket;
+    QString nickname; // Игрок, вошедший через это соединение
+    PlayerId playerId = NoPlayer; // Его ID, полученный при входе
+    FrameReader reader; // Буфер приёма и разбор кадров
+    FrameReader::FrameKind framing = FrameReader::LineFrame; // Вид кадров, которым отвечаем клиенту
+    WireProtocol::Protocol protocol = WireProtocol::JsonProtocol; // Согласован сообщением hello
+    QByteArray outbox; // Уже оформленные кадры, ждущие записи в сокет в конце итерации цикла событий
+    QByteArray latestState; // Последнее сообщение класса LatestState, отложенное до разгрузки соединения
+    bool congested = false; // Неотправленных данных больше верхней границы, ещё не опустились ниже нижней
+    bool closing = false; // Соединение отключается как медленное, новые сообщения не принимаются
+    qint64 lastActivity = 0; // Время колеса таймеров воркера, когда от клиента последний раз пришли данные
+    TimerWheel::TimerId idleTimer = 0; // Проверка простоя, 0 - не запланирована
+};
+
+#endif // CLIENTCONNECTION_H
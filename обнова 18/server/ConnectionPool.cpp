@@ -0,0 +1,120 @@
+#include "ConnectionPool.h"
+#include "Logger.h"
+#include <QSqlError>
+#include <QThread>
+
+ConnectionPool::ConnectionPool(const QString &databaseName) : databaseName(databaseName)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    releaseThreadConnection();
+    QMutexLocker locker(&mutex);
+    if (!connectionNames.isEmpty()) {
+        LOG_DEBUG("DB connections were not released by their threads: %1", connectionNames);
+    }
+}
+
+ConnectionPool::ThreadConnection::~ThreadConnection()
+{
+    // Запросы должны быть удалены раньше соединения
+    qDeleteAll(statements);
+    statements.clear();
+    {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
+QString ConnectionPool::connectOptions(const QString &databaseName)
+{
+    // Тайм-аут ожидания блокировки 1 сек
+    QString options = "QSQLITE_BUSY_TIMEOUT=1000";
+    if (databaseName.startsWith("file:")) {
+        options += ";QSQLITE_OPEN_URI";
+    }
+    return options;
+}
+
+QString ConnectionPool::threadConnectionName()
+{
+    return QString("db-%1").arg(quintptr(QThread::currentThreadId()));
+}
+
+ConnectionPool::ThreadConnection *ConnectionPool::threadConnection()
+{
+    if (connections.hasLocalData()) {
+        return connections.localData();
+    }
+
+    ThreadConnection *connection = new ThreadConnection;
+    connection->name = threadConnectionName();
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection->name);
+    db.setDatabaseName(databaseName);
+    db.setConnectOptions(connectOptions(databaseName));
+    if (!db.open()) {
+        LOG_WARNING("Error opening DB connection %1: %2", connection->name, db.lastError().text());
+    } else {
+        // WAL: чтение (вход, история) не блокирует запись ходов и наоборот
+        QSqlQuery pragma(db);
+        if (!pragma.exec("PRAGMA journal_mode=WAL")) {
+            LOG_WARNING("Failed to enable WAL: %1", pragma.lastError().text());
+        }
+        pragma.exec("PRAGMA synchronous=NORMAL");
+    }
+    connections.setLocalData(connection);
+
+    QMutexLocker locker(&mutex);
+    connectionNames.append(connection->name);
+    LOG_DEBUG("Opened DB connection %1 - connections: %2", connection->name, connectionNames.size());
+    return connection;
+}
+
+QSqlDatabase ConnectionPool::database()
+{
+    return QSqlDatabase::database(threadConnection()->name, false);
+}
+
+QSqlQuery &ConnectionPool::statement(const QString &sql)
+{
+    ThreadConnection *connection = threadConnection();
+    CachedStatement *statement = connection->statements.value(sql, nullptr);
+    if (statement && statement->prepared) {
+        statementHits.fetch_add(1, std::memory_order_relaxed);
+        statement->query.finish(); // Сбрасываем результат прошлого выполнения, запрос остаётся подготовленным
+        return statement->query;
+    }
+
+    if (!statement) {
+        statement = new CachedStatement(QSqlDatabase::database(connection->name, false));
+        statement->query.setForwardOnly(true);
+        connection->statements.insert(sql, statement);
+    }
+    statementCompiles.fetch_add(1, std::memory_order_relaxed);
+    statement->prepared = statement->query.prepare(sql);
+    if (!statement->prepared) {
+        LOG_WARNING("Failed to prepare statement: %1 - %2", sql, statement->query.lastError().text());
+    }
+    return statement->query;
+}
+
+void ConnectionPool::releaseThreadConnection()
+{
+    if (!connections.hasLocalData()) {
+        return;
+    }
+    QString name = connections.localData()->name;
+    connections.setLocalData(nullptr); // Удаляет запросы и закрывает соединение
+
+    QMutexLocker locker(&mutex);
+    connectionNames.removeAll(name);
+    LOG_DEBUG("Closed DB connection %1 - connections: %2", name, connectionNames.size());
+}
+
+int ConnectionPool::getConnectionCount() const
+{
+    QMutexLocker locker(&mutex);
+    return connectionNames.size();
+}
@@ -0,0 +1,65 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <QThreadStorage>
+#include <atomic>
+
+// Пул соединений с SQLite: у каждого потока своё именованное соединение к одному файлу БД.
+// Qt не разрешает использовать соединение вне потока, который его создал, поэтому соединение
+// открывается при первом обращении из потока и закрывается этим же потоком перед завершением.
+// Вместе с соединением поток хранит кэш подготовленных запросов.
+class ConnectionPool
+{
+public:
+    explicit ConnectionPool(const QString &databaseName);
+    ~ConnectionPool();
+
+    QSqlDatabase database(); // Соединение текущего потока
+    // Подготовленный запрос соединения текущего потока: компилируется один раз, дальше только перепривязка значений
+    QSqlQuery &statement(const QString &sql);
+    void releaseThreadConnection(); // Закрывает соединение текущего потока
+    QString getDatabaseName() const { return databaseName; }
+    // Параметры открытия соединения; имя вида "file:...?mode=memory&cache=shared" открывается как URI
+    static QString connectOptions(const QString &databaseName);
+    int getConnectionCount() const;
+
+    // Статистика кэша запросов по всем потокам
+    qint64 getStatementHits() const { return statementHits.load(std::memory_order_relaxed); }
+    qint64 getStatementCompiles() const { return statementCompiles.load(std::memory_order_relaxed); }
+
+private:
+    struct CachedStatement
+    {
+        explicit CachedStatement(const QSqlDatabase &db) : query(db) {}
+
+        QSqlQuery query;
+        bool prepared = false;
+    };
+
+    // Соединение потока и его подготовленные запросы
+    struct ThreadConnection
+    {
+        ~ThreadConnection();
+
+        QString name;
+        QHash<QString, CachedStatement*> statements; // Текст запроса -> Подготовленный запрос
+    };
+
+    ThreadConnection *threadConnection();
+    static QString threadConnectionName();
+
+    QString databaseName;
+    QThreadStorage<ThreadConnection*> connections; // Удаляется и при завершении потока
+    mutable QMutex mutex; // Защищает только список имён соединений
+    QStringList connectionNames;
+    std::atomic<qint64> statementHits{0};
+    std::atomic<qint64> statementCompiles{0};
+};
+
+#endif // CONNECTIONPOOL_H
@@ -1,97 +1,61 @@
 #include "DatabaseManager.h"
+#include "PersistenceWorker.h"
+#include "GameBoard.h"
+#include "SchemaMigrator.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include "LoopWatchdog.h"
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QDebug>
-#include <QMutex>
 #include <QSqlRecord>
 
+// Вызов БД виден и в трассе запроса, и сторожу цикла событий, если заблокирует поток
+#define DB_CALL(name) \
+    TRACE_SPAN("db." name); \
+    LoopWatchdog::Activity activity("db." name)
+
 DatabaseManager* DatabaseManager::instance = nullptr;
-QMutex mutex;
 
-DatabaseManager::DatabaseManager()
+DatabaseManager::DatabaseManager() : pool(databaseName()), persistence(nullptr)
 {
     if (!QSqlDatabase::drivers().contains("QSQLITE")) {
-        qDebug() << "Error: SQLite driver not available!";
+        LOG_ERROR("SQLite driver not available!");
     } else {
-        qDebug() << "SQLite driver is available.";
+        LOG_INFO("SQLite driver is available.");
     }
 
-    db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("server_db.sqlite");
-    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=1000"); // Устанавливаем тайм-аут 1 сек
-    qDebug() << "Attempting to open database at:" << db.databaseName();
+    LOG_INFO("Attempting to open database at: %1", pool.getDatabaseName());
+    QSqlDatabase db = pool.database();
 
-    if (!db.open()) {
-        qDebug() << "Error opening DB:" << db.lastError().text();
+    if (!db.isOpen()) {
+        LOG_ERROR("Error opening DB: %1", db.lastError().text());
     } else {
-        qDebug() << "Database connected successfully!";
-        QSqlQuery query(db);
-
-        bool success = query.exec("CREATE TABLE IF NOT EXISTS User ("
-                                  "nickname TEXT PRIMARY KEY, "
-                                  "email TEXT NOT NULL UNIQUE, "
-                                  "password TEXT NOT NULL, "
-                                  "connection_info TEXT)");
-        if (!success) {
-            qDebug() << "Error creating table User:" << query.lastError().text();
-        } else {
-            qDebug() << "Table User created or already exists.";
-        }
-
-        success = query.exec("CREATE TABLE IF NOT EXISTS Game ("
-                             "game_id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                             "player1 TEXT NOT NULL, "
-                             "player2 TEXT NOT NULL, "
-                             "current_turn TEXT NOT NULL, "
-                             "FOREIGN KEY(player1) REFERENCES User(nickname), "
-                             "FOREIGN KEY(player2) REFERENCES User(nickname))");
-        if (!success) {
-            qDebug() << "Error creating table Game:" << query.lastError().text();
-        } else {
-            qDebug() << "Table Game created or already exists.";
-        }
-
-        success = query.exec("CREATE TABLE IF NOT EXISTS Ship ("
-                             "ship_id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                             "game_id INTEGER NOT NULL, "
-                             "player TEXT NOT NULL, "
-                             "x INTEGER NOT NULL, "
-                             "y INTEGER NOT NULL, "
-                             "size INTEGER NOT NULL, "
-                             "is_horizontal INTEGER NOT NULL, "
-                             "FOREIGN KEY(game_id) REFERENCES Game(game_id), "
-                             "FOREIGN KEY(player) REFERENCES User(nickname))");
-        if (!success) {
-            qDebug() << "Error creating table Ship:" << query.lastError().text();
-        } else {
-            qDebug() << "Table Ship created or already exists.";
+        LOG_INFO("Database connected successfully!");
+        if (!SchemaMigrator::migrate(db)) {
+            LOG_ERROR("Database schema is not up to date, version: %1", SchemaMigrator::currentVersion(db));
         }
 
-        success = query.exec("CREATE TABLE IF NOT EXISTS Move ("
-                             "move_id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                             "game_id INTEGER NOT NULL, "
-                             "player TEXT NOT NULL, "
-                             "x INTEGER NOT NULL, "
-                             "y INTEGER NOT NULL, "
-                             "result TEXT NOT NULL, "
-                             "FOREIGN KEY(game_id) REFERENCES Game(game_id), "
-                             "FOREIGN KEY(player) REFERENCES User(nickname))");
-        if (!success) {
-            qDebug() << "Error creating table Move:" << query.lastError().text();
-        } else {
-            qDebug() << "Table Move created or already exists.";
-        }
+        // Таблицы уже созданы, можно запускать фоновую запись
+        persistence = new PersistenceWorker(db.databaseName(), this);
+        persistence->start();
+        Metrics::getInstance().gauge("seabattle_db_pending_writes", "Writes queued for the background DB thread.",
+                                     [this]() { return double(pendingWrites()); });
     }
 }
 
 DatabaseManager::~DatabaseManager()
 {
-    if (db.isOpen()) {
-        db.close();
-    }
+    shutdown();
     instance = nullptr;
 }
 
+QString &DatabaseManager::databaseName()
+{
+    static QString name = "server_db.sqlite";
+    return name;
+}
+
 DatabaseManager* DatabaseManager::getInstance()
 {
     if (!instance) {
@@ -102,188 +66,297 @@ DatabaseManager* DatabaseManager::getInstance()
 
 QSqlDatabase DatabaseManager::getDatabase()
 {
-    return db;
+    return pool.database();
+}
+
+void DatabaseManager::releaseThreadConnection()
+{
+    pool.releaseThreadConnection();
+}
+
+QSqlQuery &DatabaseManager::statement(const QString &sql)
+{
+    return pool.statement(sql);
 }
 
 bool DatabaseManager::addUser(const QString &nickname, const QString &email, const QString &password)
 {
-    QMutexLocker locker(&mutex);
+    DB_CALL("addUser");
+    QSqlDatabase db = pool.database();
     if (!db.isOpen()) {
-        qDebug() << "Database is not open!";
+        LOG_WARNING("Database is not open!");
         return false;
     }
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO User (nickname, email, password, connection_info) VALUES (:nickname, :email, :password, :connection_info)");
+    QSqlQuery &query = pool.statement("INSERT INTO User (nickname, email, password, connection_info) VALUES (:nickname, :email, :password, :connection_info)");
     query.bindValue(":nickname", nickname);
     query.bindValue(":email", email);
     query.bindValue(":password", password);
     query.bindValue(":connection_info", "");
 
-    qDebug() << "Adding user - Nickname:" << nickname << "Email:" << email;
+    LOG_DEBUG("Adding user - Nickname: %1 Email: %2", nickname, email);
 
     if (!query.exec()) {
-        qDebug() << "Error adding user:" << query.lastError().text();
+        LOG_WARNING("Error adding user: %1", query.lastError().text());
         return false;
     }
-    qDebug() << "User added successfully.";
+    LOG_DEBUG("User added successfully.");
     return true;
 }
 
 void DatabaseManager::printUsers()
 {
-    QMutexLocker locker(&mutex);
+    QSqlDatabase db = pool.database();
     QSqlQuery query(db);
     if (!query.exec("SELECT * FROM User")) {
-        qDebug() << "Error fetching users:" << query.lastError().text();
+        LOG_WARNING("Error fetching users: %1", query.lastError().text());
         return;
     }
     while (query.next()) {
-        qDebug() << "Nickname:" << query.value("nickname").toString()
-        << "Email:" << query.value("email").toString()
-        << "Password:" << query.value("password").toString()
-        << "Connection:" << query.value("connection_info").toString();
+        LOG_DEBUG("Nickname: %1 Email: %2 Password: %3 Connection: %4", query.value("nickname").toString(), query.value("email").toString(), query.value("password").toString(), query.value("connection_info").toString());
+    }
+}
+
+PlayerId DatabaseManager::internPlayer(const QString &nickname)
+{
+    DB_CALL("internPlayer");
+    PlayerId id = players.find(nickname);
+    if (id != NoPlayer) {
+        return id;
+    }
+
+    QSqlDatabase db = pool.database();
+    if (!db.isOpen()) {
+        LOG_WARNING("Database is not open!");
+        return NoPlayer;
+    }
+
+    // Два потока могут интернировать одно имя одновременно: оба получат один и тот же player_id
+    QSqlQuery &insertQuery = pool.statement("INSERT OR IGNORE INTO Player (nickname) VALUES (:nickname)");
+    insertQuery.bindValue(":nickname", nickname);
+    if (!insertQuery.exec()) {
+        LOG_WARNING("Error adding player: %1", insertQuery.lastError().text());
+        return NoPlayer;
+    }
+
+    QSqlQuery &query = pool.statement("SELECT player_id FROM Player WHERE nickname = :nickname");
+    query.bindValue(":nickname", nickname);
+    if (!query.exec() || !query.next()) {
+        LOG_WARNING("Error fetching player id: %1", query.lastError().text());
+        return NoPlayer;
+    }
+    id = PlayerId(query.value(0).toUInt());
+    query.finish();
+
+    players.insert(id, nickname);
+    LOG_DEBUG("Player %1 has id %2", nickname, id);
+    return id;
+}
+
+QString DatabaseManager::playerName(PlayerId id)
+{
+    DB_CALL("playerName");
+    QString nickname = players.name(id);
+    if (!nickname.isEmpty() || id == NoPlayer) {
+        return nickname;
+    }
+
+    QSqlDatabase db = pool.database();
+    if (!db.isOpen()) {
+        LOG_WARNING("Database is not open!");
+        return "";
     }
+
+    QSqlQuery &query = pool.statement("SELECT nickname FROM Player WHERE player_id = :player_id");
+    query.bindValue(":player_id", id);
+    if (!query.exec() || !query.next()) {
+        LOG_DEBUG("Unknown player id: %1", id);
+        return "";
+    }
+    nickname = query.value(0).toString();
+    query.finish();
+    players.insert(id, nickname);
+    return nickname;
 }
 
-int DatabaseManager::createGame(const QString &player1, const QString &player2)
+int DatabaseManager::createGame(PlayerId player1, PlayerId player2)
 {
-    QMutexLocker locker(&mutex);
+    DB_CALL("createGame");
+    QSqlDatabase db = pool.database();
     if (!db.isOpen()) {
-        qDebug() << "Database is not open!";
+        LOG_WARNING("Database is not open!");
         return -1;
     }
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO Game (player1, player2, current_turn) VALUES (:player1, :player2, :current_turn)");
-    query.bindValue(":player1", player1);
-    query.bindValue(":player2", player2);
-    query.bindValue(":current_turn", player1);
+    QSqlQuery &query = pool.statement("INSERT INTO Game (player1_id, player2_id, current_turn_id) VALUES (:player1_id, :player2_id, :current_turn_id)");
+    query.bindValue(":player1_id", player1);
+    query.bindValue(":player2_id", player2);
+    query.bindValue(":current_turn_id", player1);
 
     if (!query.exec()) {
-        qDebug() << "Error creating game:" << query.lastError().text();
+        LOG_WARNING("Error creating game: %1", query.lastError().text());
         return -1;
     }
 
-    query.exec("SELECT last_insert_rowid()");
-    if (query.next()) {
-        int gameId = query.value(0).toInt();
-        qDebug() << "Game created with ID:" << gameId << "between" << player1 << "and" << player2;
+    // last_insert_rowid() отдельным запросом не нужен: драйвер возвращает его сам
+    QVariant insertId = query.lastInsertId();
+    if (insertId.isValid()) {
+        int gameId = insertId.toInt();
+        LOG_DEBUG("Game created with ID: %1 between %2 and %3", gameId, player1, player2);
         return gameId;
     }
     return -1;
 }
 
-bool DatabaseManager::saveShip(int gameId, const QString &player, int x, int y, int size, bool isHorizontal)
+bool DatabaseManager::saveShip(int gameId, PlayerId player, int x, int y, int size, bool isHorizontal)
 {
-    QMutexLocker locker(&mutex);
+    DB_CALL("saveShip");
+    QSqlDatabase db = pool.database();
     if (!db.isOpen()) {
-        qDebug() << "Database is not open!";
+        LOG_WARNING("Database is not open!");
         return false;
     }
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO Ship (game_id, player, x, y, size, is_horizontal) VALUES (:game_id, :player, :x, :y, :size, :is_horizontal)");
+    QSqlQuery &query = pool.statement("INSERT INTO Ship (game_id, player_id, x, y, size, is_horizontal) VALUES (:game_id, :player_id, :x, :y, :size, :is_horizontal)");
     query.bindValue(":game_id", gameId);
-    query.bindValue(":player", player);
+    query.bindValue(":player_id", player);
     query.bindValue(":x", x);
     query.bindValue(":y", y);
     query.bindValue(":size", size);
     query.bindValue(":is_horizontal", isHorizontal ? 1 : 0);
 
     if (!query.exec()) {
-        qDebug() << "Error saving ship:" << query.lastError().text();
+        LOG_WARNING("Error saving ship: %1", query.lastError().text());
         return false;
     }
-    qDebug() << "Ship saved for player" << player << "in game" << gameId;
+    LOG_DEBUG("Ship saved for player %1 in game %2", player, gameId);
     return true;
 }
 
-bool DatabaseManager::saveMove(int gameId, const QString &player, int x, int y, const QString &result)
+bool DatabaseManager::saveFleet(int gameId, PlayerId player, const QVector<ShipPlacement> &ships)
 {
-    // Мьютекс уже заблокирован в вызывающей функции (checkMove), поэтому здесь не блокируем
+    DB_CALL("saveFleet");
+    QSqlDatabase db = pool.database();
     if (!db.isOpen()) {
-        qDebug() << "Database is not open in saveMove!";
+        LOG_WARNING("Database is not open!");
         return false;
     }
 
-    qDebug() << "Starting saveMove for player" << player << "in game" << gameId << "at (" << x << "," << y << ") with result:" << result;
+    if (!db.transaction()) {
+        LOG_WARNING("Failed to start transaction in saveFleet: %1", db.lastError().text());
+        return false;
+    }
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO Move (game_id, player, x, y, result) VALUES (:game_id, :player, :x, :y, :result)");
+    QSqlQuery &query = pool.statement("INSERT INTO Ship (game_id, player_id, x, y, size, is_horizontal) VALUES (:game_id, :player_id, :x, :y, :size, :is_horizontal)");
+    for (const ShipPlacement &ship : ships) {
+        query.bindValue(":game_id", gameId);
+        query.bindValue(":player_id", player);
+        query.bindValue(":x", ship.x);
+        query.bindValue(":y", ship.y);
+        query.bindValue(":size", ship.size);
+        query.bindValue(":is_horizontal", ship.isHorizontal ? 1 : 0);
+        if (!query.exec()) {
+            LOG_WARNING("Error saving fleet: %1", query.lastError().text());
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit()) {
+        LOG_WARNING("Failed to commit transaction in saveFleet: %1", db.lastError().text());
+        db.rollback();
+        return false;
+    }
+    LOG_DEBUG("Fleet of %1 ships saved for player %2 in game %3", ships.size(), player, gameId);
+    return true;
+}
+
+bool DatabaseManager::saveMove(int gameId, PlayerId player, int x, int y, const QString &result)
+{
+    DB_CALL("saveMove");
+    QSqlDatabase db = pool.database();
+    if (!db.isOpen()) {
+        LOG_WARNING("Database is not open in saveMove!");
+        return false;
+    }
+
+    LOG_TRACE("Starting saveMove for player %1 in game %2 at (%3, %4) with result: %5", player, gameId, x, y, result);
+
+    QSqlQuery &query = pool.statement("INSERT INTO Move (game_id, player_id, x, y, result) VALUES (:game_id, :player_id, :x, :y, :result)");
     query.bindValue(":game_id", gameId);
-    query.bindValue(":player", player);
+    query.bindValue(":player_id", player);
     query.bindValue(":x", x);
     query.bindValue(":y", y);
     query.bindValue(":result", result);
 
-    qDebug() << "SQL query:" << query.lastQuery();
-    qDebug() << "Bound values:" << query.boundValues();
+    LOG_TRACE("SQL query: %1", query.lastQuery());
+    LOG_TRACE("Bound values: %1", query.boundValues());
 
     try {
         if (!query.exec()) {
-            qDebug() << "Error saving move:" << query.lastError().text();
+            LOG_WARNING("Error saving move: %1", query.lastError().text());
             return false;
         }
     } catch (const std::exception &e) {
-        qDebug() << "Exception in saveMove:" << e.what();
+        LOG_ERROR("Exception in saveMove: %1", e.what());
         return false;
     }
 
-    qDebug() << "Move saved: Player" << player << "in game" << gameId << "at (" << x << "," << y << ") - Result:" << result;
+    LOG_TRACE("Move saved: Player %1 in game %2 at (%3, %4) - Result: %5", player, gameId, x, y, result);
     return true;
 }
 
-QString DatabaseManager::checkMove(int gameId, const QString &player, int x, int y)
+QString DatabaseManager::checkMove(int gameId, PlayerId player, int x, int y)
 {
-    QMutexLocker locker(&mutex);
+    DB_CALL("checkMove");
+    QSqlDatabase db = pool.database();
     if (!db.isOpen()) {
-        qDebug() << "Database is not open!";
+        LOG_WARNING("Database is not open!");
         return "error";
     }
 
-    qDebug() << "Starting checkMove for player" << player << "in game" << gameId << "at (" << x << "," << y << ")";
+    LOG_TRACE("Starting checkMove for player %1 in game %2 at (%3, %4)", player, gameId, x, y);
 
     if (!db.transaction()) {
-        qDebug() << "Failed to start transaction in checkMove:" << db.lastError().text();
+        LOG_WARNING("Failed to start transaction in checkMove: %1", db.lastError().text());
         return "error";
     }
 
     // Получаем оппонента
-    QSqlQuery gameQuery(db);
-    gameQuery.prepare("SELECT player1, player2 FROM Game WHERE game_id = :game_id");
+    QSqlQuery &gameQuery = pool.statement("SELECT player1_id, player2_id FROM Game WHERE game_id = :game_id");
     gameQuery.bindValue(":game_id", gameId);
     if (!gameQuery.exec() || !gameQuery.next()) {
-        qDebug() << "Error fetching game:" << gameQuery.lastError().text();
+        LOG_WARNING("Error fetching game: %1", gameQuery.lastError().text());
         db.rollback();
         return "error";
     }
 
-    QString player1 = gameQuery.value("player1").toString();
-    QString player2 = gameQuery.value("player2").toString();
-    QString opponent = (player == player1) ? player2 : player1;
-    qDebug() << "Opponent for" << player << "is" << opponent;
+    PlayerId player1 = PlayerId(gameQuery.value(0).toUInt());
+    PlayerId player2 = PlayerId(gameQuery.value(1).toUInt());
+    gameQuery.finish();
+    PlayerId opponent = (player == player1) ? player2 : player1;
+    LOG_DEBUG("Opponent for %1 is %2", player, opponent);
 
     // Проверяем, не стреляли ли уже в эту клетку
-    QSqlQuery moveQuery(db);
-    moveQuery.prepare("SELECT result FROM Move WHERE game_id = :game_id AND player = :player AND x = :x AND y = :y");
+    QSqlQuery &moveQuery = pool.statement("SELECT result FROM Move WHERE game_id = :game_id AND player_id = :player_id AND x = :x AND y = :y");
     moveQuery.bindValue(":game_id", gameId);
-    moveQuery.bindValue(":player", player);
+    moveQuery.bindValue(":player_id", player);
     moveQuery.bindValue(":x", x);
     moveQuery.bindValue(":y", y);
-    if (moveQuery.exec() && moveQuery.next()) {
-        qDebug() << "Cell (" << x << "," << y << ") already shot by" << player;
+    bool alreadyShot = moveQuery.exec() && moveQuery.next();
+    moveQuery.finish();
+    if (alreadyShot) {
+        LOG_DEBUG("Cell (%1, %2) already shot by %3", x, y, player);
         db.commit();
         return "already_shot";
     }
 
     // Проверяем, есть ли корабль оппонента в этой клетке
-    QSqlQuery shipQuery(db);
-    shipQuery.prepare("SELECT ship_id, x, y, size, is_horizontal FROM Ship WHERE game_id = :game_id AND player = :player");
+    QSqlQuery &shipQuery = pool.statement("SELECT ship_id, x, y, size, is_horizontal FROM Ship WHERE game_id = :game_id AND player_id = :player_id");
     shipQuery.bindValue(":game_id", gameId);
-    shipQuery.bindValue(":player", opponent);
+    shipQuery.bindValue(":player_id", opponent);
     if (!shipQuery.exec()) {
-        qDebug() << "Error fetching ships:" << shipQuery.lastError().text();
+        LOG_WARNING("Error fetching ships: %1", shipQuery.lastError().text());
         db.rollback();
         return "error";
     }
@@ -299,7 +372,7 @@ QString DatabaseManager::checkMove(int gameId, const QString &player, int x, int
         shipSize = shipQuery.value(3).toInt();
         isHorizontal = shipQuery.value(4).toBool();
         shipId = shipQuery.value(0).toInt();
-        qDebug() << "Checking ship: id=" << shipId << ", x=" << shipX << ", y=" << shipY << ", size=" << shipSize << ", is_horizontal=" << isHorizontal;
+        LOG_TRACE("Checking ship: id= %1, x= %2, y= %3, size= %4, is_horizontal= %5", shipId, shipX, shipY, shipSize, isHorizontal);
 
         if (isHorizontal) {
             if (y == shipY && x >= shipX && x < shipX + shipSize) {
@@ -313,30 +386,31 @@ QString DatabaseManager::checkMove(int gameId, const QString &player, int x, int
             }
         }
     }
+    shipQuery.finish();
 
     QString result;
     if (hit) {
-        QSqlQuery hitQuery(db);
-        hitQuery.prepare("SELECT COUNT(*) FROM Move WHERE game_id = :game_id AND player = :player AND result IN ('hit', 'sunk') AND "
-                         "(x >= :ship_x AND x < :ship_x + :size AND y = :ship_y AND :is_horizontal = 1 OR "
-                         "y >= :ship_y AND y < :ship_y + :size AND x = :ship_x AND :is_horizontal = 0)");
+        QSqlQuery &hitQuery = pool.statement("SELECT COUNT(*) FROM Move WHERE game_id = :game_id AND player_id = :player_id AND result IN ('hit', 'sunk') AND "
+                                             "(x >= :ship_x AND x < :ship_x + :size AND y = :ship_y AND :is_horizontal = 1 OR "
+                                             "y >= :ship_y AND y < :ship_y + :size AND x = :ship_x AND :is_horizontal = 0)");
         hitQuery.bindValue(":game_id", gameId);
-        hitQuery.bindValue(":player", player);
+        hitQuery.bindValue(":player_id", player);
         hitQuery.bindValue(":ship_x", shipX);
         hitQuery.bindValue(":ship_y", shipY);
         hitQuery.bindValue(":size", shipSize);
         hitQuery.bindValue(":is_horizontal", isHorizontal ? 1 : 0);
         if (!hitQuery.exec() || !hitQuery.next()) {
-            qDebug() << "Error counting hits:" << hitQuery.lastError().text();
+            LOG_WARNING("Error counting hits: %1", hitQuery.lastError().text());
             db.rollback();
             return "error";
         }
 
         int hitCount = hitQuery.value(0).toInt() + 1;
-        qDebug() << "Ship id=" << shipId << ", hits=" << hitCount << ", size=" << shipSize;
+        hitQuery.finish();
+        LOG_TRACE("Ship id= %1, hits= %2, size= %3", shipId, hitCount, shipSize);
         if (hitCount >= shipSize) {
             result = "sunk";
-            qDebug() << "Ship id=" << shipId << "sunk!";
+            LOG_DEBUG("Ship id= %1 sunk!", shipId);
         } else {
             result = "hit";
         }
@@ -345,73 +419,165 @@ QString DatabaseManager::checkMove(int gameId, const QString &player, int x, int
     }
 
     // Сохраняем ход в той же транзакции
-    QSqlQuery moveInsertQuery(db);
-    moveInsertQuery.prepare("INSERT INTO Move (game_id, player, x, y, result) VALUES (:game_id, :player, :x, :y, :result)");
+    QSqlQuery &moveInsertQuery = pool.statement("INSERT INTO Move (game_id, player_id, x, y, result) VALUES (:game_id, :player_id, :x, :y, :result)");
     moveInsertQuery.bindValue(":game_id", gameId);
-    moveInsertQuery.bindValue(":player", player);
+    moveInsertQuery.bindValue(":player_id", player);
     moveInsertQuery.bindValue(":x", x);
     moveInsertQuery.bindValue(":y", y);
     moveInsertQuery.bindValue(":result", result);
 
-    qDebug() << "Saving move in checkMove: SQL query:" << moveInsertQuery.lastQuery();
-    qDebug() << "Bound values:" << moveInsertQuery.boundValues();
+    LOG_TRACE("Saving move in checkMove: SQL query: %1", moveInsertQuery.lastQuery());
+    LOG_TRACE("Bound values: %1", moveInsertQuery.boundValues());
 
     try {
         if (!moveInsertQuery.exec()) {
-            qDebug() << "Error saving move in checkMove:" << moveInsertQuery.lastError().text();
+            LOG_WARNING("Error saving move in checkMove: %1", moveInsertQuery.lastError().text());
             db.rollback();
             return "error";
         }
     } catch (const std::exception &e) {
-        qDebug() << "Exception in checkMove while saving move:" << e.what();
+        LOG_ERROR("Exception in checkMove while saving move: %1", e.what());
         db.rollback();
         return "error";
     }
 
     if (!db.commit()) {
-        qDebug() << "Failed to commit transaction in checkMove:" << db.lastError().text();
+        LOG_WARNING("Failed to commit transaction in checkMove: %1", db.lastError().text());
         db.rollback();
         return "error";
     }
 
-    qDebug() << "checkMove completed for" << player << "with result:" << result;
+    LOG_DEBUG("checkMove completed for %1 with result: %2", player, result);
     return result;
 }
 
-QString DatabaseManager::getCurrentTurn(int gameId)
+PlayerId DatabaseManager::getCurrentTurn(int gameId)
 {
-    QMutexLocker locker(&mutex);
+    DB_CALL("getCurrentTurn");
+    QSqlDatabase db = pool.database();
     if (!db.isOpen()) {
-        qDebug() << "Database is not open!";
-        return "";
+        LOG_WARNING("Database is not open!");
+        return NoPlayer;
     }
 
-    QSqlQuery query(db);
-    query.prepare("SELECT current_turn FROM Game WHERE game_id = :game_id");
+    QSqlQuery &query = pool.statement("SELECT current_turn_id FROM Game WHERE game_id = :game_id");
     query.bindValue(":game_id", gameId);
     if (!query.exec() || !query.next()) {
-        qDebug() << "Error fetching current turn:" << query.lastError().text();
-        return "";
+        LOG_WARNING("Error fetching current turn: %1", query.lastError().text());
+        return NoPlayer;
     }
-    return query.value("current_turn").toString();
+    PlayerId currentTurn = PlayerId(query.value(0).toUInt());
+    query.finish();
+    return currentTurn;
 }
 
-bool DatabaseManager::updateTurn(int gameId, const QString &nextPlayer)
+bool DatabaseManager::updateTurn(int gameId, PlayerId nextPlayer)
 {
-    QMutexLocker locker(&mutex);
+    DB_CALL("updateTurn");
+    QSqlDatabase db = pool.database();
     if (!db.isOpen()) {
-        qDebug() << "Database is not open!";
+        LOG_WARNING("Database is not open!");
         return false;
     }
 
-    QSqlQuery query(db);
-    query.prepare("UPDATE Game SET current_turn = :current_turn WHERE game_id = :game_id");
-    query.bindValue(":current_turn", nextPlayer);
+    QSqlQuery &query = pool.statement("UPDATE Game SET current_turn_id = :current_turn_id WHERE game_id = :game_id");
+    query.bindValue(":current_turn_id", nextPlayer);
     query.bindValue(":game_id", gameId);
     if (!query.exec()) {
-        qDebug() << "Error updating turn:" << query.lastError().text();
+        LOG_WARNING("Error updating turn: %1", query.lastError().text());
         return false;
     }
-    qDebug() << "Turn updated to" << nextPlayer << "for game" << gameId;
+    LOG_DEBUG("Turn updated to %1 for game %2", nextPlayer, gameId);
     return true;
 }
+
+void DatabaseManager::enqueueShip(int gameId, PlayerId player, int x, int y, int size, bool isHorizontal)
+{
+    DB_CALL("enqueueShip");
+    if (!persistence) {
+        saveShip(gameId, player, x, y, size, isHorizontal);
+        return;
+    }
+    PersistenceOp op;
+    op.kind = PersistenceOp::SaveShip;
+    op.gameId = gameId;
+    op.playerId = player;
+    op.x = x;
+    op.y = y;
+    op.size = size;
+    op.isHorizontal = isHorizontal;
+    persistence->enqueue(std::move(op));
+}
+
+void DatabaseManager::enqueueFleet(int gameId, PlayerId player, const QVector<ShipPlacement> &ships)
+{
+    DB_CALL("enqueueFleet");
+    if (!persistence) {
+        saveFleet(gameId, player, ships);
+        return;
+    }
+    PersistenceOp op;
+    op.kind = PersistenceOp::SaveFleet;
+    op.gameId = gameId;
+    op.playerId = player;
+    op.ships = ships;
+    persistence->enqueue(std::move(op));
+}
+
+void DatabaseManager::enqueueMove(int gameId, PlayerId player, int x, int y, const QString &result)
+{
+    DB_CALL("enqueueMove");
+    if (!persistence) {
+        saveMove(gameId, player, x, y, result);
+        return;
+    }
+    PersistenceOp op;
+    op.kind = PersistenceOp::SaveMove;
+    op.gameId = gameId;
+    op.playerId = player;
+    op.x = x;
+    op.y = y;
+    op.result = result;
+    persistence->enqueue(std::move(op));
+}
+
+void DatabaseManager::enqueueTurn(int gameId, PlayerId nextPlayer)
+{
+    DB_CALL("enqueueTurn");
+    if (!persistence) {
+        updateTurn(gameId, nextPlayer);
+        return;
+    }
+    PersistenceOp op;
+    op.kind = PersistenceOp::UpdateTurn;
+    op.gameId = gameId;
+    op.playerId = nextPlayer;
+    persistence->enqueue(std::move(op));
+}
+
+void DatabaseManager::configurePersistence(int maxBatchSize, int maxDelayMs)
+{
+    if (persistence) {
+        persistence->configure(maxBatchSize, maxDelayMs);
+    }
+}
+
+void DatabaseManager::setBlobStorage(bool enabled)
+{
+    if (persistence) {
+        persistence->setLayout(enabled ? PersistenceWorker::BlobLayout : PersistenceWorker::RowLayout);
+        LOG_INFO("Board storage layout: %1", (enabled ? "blob" : "rows"));
+    }
+}
+
+int DatabaseManager::pendingWrites() const
+{
+    return persistence ? persistence->pendingWrites() : 0;
+}
+
+void DatabaseManager::shutdown()
+{
+    if (persistence) {
+        persistence->stop();
+    }
+}
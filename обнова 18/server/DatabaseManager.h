@@ -6,6 +6,12 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
+#include <QVector>
+#include "ConnectionPool.h"
+#include "PlayerRegistry.h"
+
+class PersistenceWorker;
+struct ShipPlacement;
 
 class DatabaseManager : public QObject
 {
@@ -13,17 +19,40 @@ class DatabaseManager : public QObject
 
 public:
     static DatabaseManager* getInstance();
-    QSqlDatabase getDatabase();
+    // Файл БД (по умолчанию server_db.sqlite); действует, только если вызвать до первого getInstance()
+    static void setDatabaseName(const QString &name) { databaseName() = name; }
+    QSqlDatabase getDatabase(); // Соединение текущего потока из пула
+    void releaseThreadConnection(); // Вызывается рабочим потоком перед завершением
+    QSqlQuery &statement(const QString &sql); // Подготовленный запрос из кэша соединения текущего потока
+    qint64 getStatementHits() const { return pool.getStatementHits(); }
+    qint64 getStatementCompiles() const { return pool.getStatementCompiles(); }
+    int getConnectionCount() const { return pool.getConnectionCount(); }
     bool addUser(const QString &nickname, const QString &email, const QString &password);
     void printUsers();
 
+    // Интернирование игроков: никнейм -> PlayerId (строка Player создаётся при первом входе)
+    PlayerId internPlayer(const QString &nickname);
+    QString playerName(PlayerId id); // Имя для ответа клиенту
+    int getPlayerCount() const { return players.size(); }
+
     // Методы для работы с игрой
-    int createGame(const QString &player1, const QString &player2); // Создание новой игры с инициализацией первого хода
-    bool saveShip(int gameId, const QString &player, int x, int y, int size, bool isHorizontal); // Сохранение корабля
-    bool saveMove(int gameId, const QString &player, int x, int y, const QString &result); // Сохранение хода
-    QString checkMove(int gameId, const QString &player, int x, int y); // Проверка результата выстрела
-    QString getCurrentTurn(int gameId); // Получение текущего хода
-    bool updateTurn(int gameId, const QString &nextPlayer); // Обновление текущего хода
+    int createGame(PlayerId player1, PlayerId player2); // Создание новой игры с инициализацией первого хода
+    bool saveShip(int gameId, PlayerId player, int x, int y, int size, bool isHorizontal); // Сохранение корабля
+    bool saveMove(int gameId, PlayerId player, int x, int y, const QString &result); // Сохранение хода
+    QString checkMove(int gameId, PlayerId player, int x, int y); // Проверка результата выстрела
+    bool saveFleet(int gameId, PlayerId player, const QVector<ShipPlacement> &ships); // Сохранение флота одной транзакцией
+    PlayerId getCurrentTurn(int gameId); // Получение текущего хода
+    bool updateTurn(int gameId, PlayerId nextPlayer); // Обновление текущего хода
+
+    // Отложенная запись в фоновом потоке (не блокирует цикл событий)
+    void enqueueShip(int gameId, PlayerId player, int x, int y, int size, bool isHorizontal);
+    void enqueueFleet(int gameId, PlayerId player, const QVector<ShipPlacement> &ships);
+    void enqueueMove(int gameId, PlayerId player, int x, int y, const QString &result);
+    void enqueueTurn(int gameId, PlayerId nextPlayer);
+    void configurePersistence(int maxBatchSize, int maxDelayMs);
+    void setBlobStorage(bool enabled); // Флот и выстрелы пишутся строкой PlayerBoard вместо Ship/Move
+    int pendingWrites() const;
+    void shutdown(); // Дописывает очередь записи перед завершением сервера
 
 private:
     DatabaseManager();
@@ -31,8 +60,12 @@ private:
     DatabaseManager(const DatabaseManager&) = delete;
     DatabaseManager& operator=(const DatabaseManager&) = delete;
 
+    static QString &databaseName();
+
     static DatabaseManager* instance;
-    QSqlDatabase db;
+    ConnectionPool pool;
+    PlayerRegistry players; // Кэш таблицы Player, общий для всех потоков
+    PersistenceWorker *persistence;
 };
 
 #endif // DATABASEMANAGER_H
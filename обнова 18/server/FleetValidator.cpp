@@ -0,0 +1,167 @@
+#include "FleetValidator.h"
+
+namespace {
+
+// Заранее вычисленные маски для каждой позиции, размера и ориентации корабля
+struct MaskTables
+{
+    Bitboard ships[2][FleetValidator::MaxShipSize + 1][Bitboard::CellCount];
+    Bitboard halos[2][FleetValidator::MaxShipSize + 1][Bitboard::CellCount];
+
+    MaskTables()
+    {
+        for (int horizontal = 0; horizontal < 2; ++horizontal) {
+            for (int size = 1; size <= FleetValidator::MaxShipSize; ++size) {
+                for (int y = 0; y < Bitboard::Size; ++y) {
+                    for (int x = 0; x < Bitboard::Size; ++x) {
+                        int endX = horizontal ? x + size - 1 : x;
+                        int endY = horizontal ? y : y + size - 1;
+                        if (!Bitboard::inBounds(endX, endY)) {
+                            continue;
+                        }
+                        Bitboard ship;
+                        Bitboard halo;
+                        for (int cy = y - 1; cy <= endY + 1; ++cy) {
+                            for (int cx = x - 1; cx <= endX + 1; ++cx) {
+                                if (!Bitboard::inBounds(cx, cy)) {
+                                    continue;
+                                }
+                                halo.set(Bitboard::index(cx, cy));
+                                if (cx >= x && cx <= endX && cy >= y && cy <= endY) {
+                                    ship.set(Bitboard::index(cx, cy));
+                                }
+                            }
+                        }
+                        ships[horizontal][size][Bitboard::index(x, y)] = ship;
+                        halos[horizontal][size][Bitboard::index(x, y)] = halo;
+                    }
+                }
+            }
+        }
+    }
+};
+
+const MaskTables &tables()
+{
+    static const MaskTables instance;
+    return instance;
+}
+
+bool validShip(int x, int y, int size)
+{
+    return size >= 1 && size <= FleetValidator::MaxShipSize && Bitboard::inBounds(x, y);
+}
+
+} // namespace
+
+int FleetValidator::requiredCount(int size)
+{
+    // 1x4, 2x3, 3x2, 4x1
+    return size >= 1 && size <= MaxShipSize ? MaxShipSize + 1 - size : 0;
+}
+
+Bitboard FleetValidator::shipMask(int x, int y, int size, bool isHorizontal)
+{
+    if (!validShip(x, y, size)) {
+        return Bitboard();
+    }
+    return tables().ships[isHorizontal ? 1 : 0][size][Bitboard::index(x, y)];
+}
+
+Bitboard FleetValidator::haloMask(int x, int y, int size, bool isHorizontal)
+{
+    if (!validShip(x, y, size)) {
+        return Bitboard();
+    }
+    return tables().halos[isHorizontal ? 1 : 0][size][Bitboard::index(x, y)];
+}
+
+FleetValidator::Error FleetValidator::canPlace(const Bitboard &occupied, const ShipPlacement &ship)
+{
+    Bitboard mask = shipMask(ship.x, ship.y, ship.size, ship.isHorizontal);
+    if (mask.isEmpty()) {
+        return InvalidShip;
+    }
+    if (!(mask & occupied).isEmpty()) {
+        return Overlap;
+    }
+    if (!(haloMask(ship.x, ship.y, ship.size, ship.isHorizontal) & occupied).isEmpty()) {
+        return Touching;
+    }
+    return Ok;
+}
+
+FleetValidator::Error FleetValidator::validate(const QVector<ShipPlacement> &ships)
+{
+    Bitboard occupied;
+    Bitboard forbidden; // Клетки кораблей и их ореолов
+    int counts[MaxShipSize + 1] = {0};
+    for (const ShipPlacement &ship : ships) {
+        Bitboard mask = shipMask(ship.x, ship.y, ship.size, ship.isHorizontal);
+        if (mask.isEmpty()) {
+            return InvalidShip;
+        }
+        if (!(mask & forbidden).isEmpty()) {
+            return (mask & occupied).isEmpty() ? Touching : Overlap;
+        }
+        occupied |= mask;
+        forbidden |= haloMask(ship.x, ship.y, ship.size, ship.isHorizontal);
+        ++counts[ship.size];
+    }
+
+    if (ships.size() != FleetSize) {
+        return WrongComposition;
+    }
+    for (int size = 1; size <= MaxShipSize; ++size) {
+        if (counts[size] != requiredCount(size)) {
+            return WrongComposition;
+        }
+    }
+    return occupied.count() == FleetCells ? Ok : WrongComposition;
+}
+
+QVector<ShipPlacement> FleetValidator::shipsFromMask(const Bitboard &cells)
+{
+    QVector<ShipPlacement> ships;
+    Bitboard visited;
+    for (int y = 0; y < Bitboard::Size; ++y) {
+        for (int x = 0; x < Bitboard::Size; ++x) {
+            int index = Bitboard::index(x, y);
+            if (!cells.test(index) || visited.test(index)) {
+                continue;
+            }
+
+            ShipPlacement ship;
+            ship.x = x;
+            ship.y = y;
+            ship.size = 1;
+            ship.isHorizontal = x + 1 < Bitboard::Size && cells.test(index + 1);
+            if (ship.isHorizontal) {
+                while (x + ship.size < Bitboard::Size && cells.test(index + ship.size)) {
+                    visited.set(index + ship.size);
+                    ++ship.size;
+                }
+            } else {
+                while (y + ship.size < Bitboard::Size && cells.test(index + ship.size * Bitboard::Size)) {
+                    visited.set(index + ship.size * Bitboard::Size);
+                    ++ship.size;
+                }
+            }
+            visited.set(index);
+            ships.append(ship);
+        }
+    }
+    return ships;
+}
+
+const char *FleetValidator::errorMessage(Error error)
+{
+    switch (error) {
+    case Ok: return "Fleet is valid";
+    case InvalidShip: return "Ship is out of the board or has invalid size";
+    case Overlap: return "Ships overlap";
+    case Touching: return "Ships must not touch each other";
+    case WrongComposition: return "Fleet must be 1x4, 2x3, 3x2, 4x1";
+    }
+    return "Invalid fleet";
+}
@@ -0,0 +1,52 @@
+#ifndef FLEETVALIDATOR_H
+#define FLEETVALIDATOR_H
+
+#include <QVector>
+#include "Bitboard.h"
+
+// Описание одного корабля при расстановке
+struct ShipPlacement
+{
+    int x = 0;
+    int y = 0;
+    int size = 0;
+    bool isHorizontal = false;
+};
+
+// Проверка расстановки флота на масках клеток: маски кораблей и их окрестностей (ореолов)
+// вычисляются заранее, поэтому проверка флота - это несколько операций AND/OR на корабль.
+// Используется и сервером, и клиентом (SeaBattleClient.pro подключает этот файл из server/).
+class FleetValidator
+{
+public:
+    enum Error {
+        Ok,
+        InvalidShip, // Корабль выходит за поле или имеет недопустимый размер
+        Overlap, // Корабли пересекаются
+        Touching, // Корабли касаются сторонами или углами
+        WrongComposition // Состав флота отличается от 1x4, 2x3, 3x2, 4x1
+    };
+
+    static const int MaxShipSize = 4;
+    static const int FleetSize = 10;
+    static const int FleetCells = 20;
+
+    // Требуемое количество кораблей каждого размера (индекс - размер)
+    static int requiredCount(int size);
+
+    static Error validate(const QVector<ShipPlacement> &ships);
+    // Можно ли добавить корабль к уже стоящим (без проверки состава флота)
+    static Error canPlace(const Bitboard &occupied, const ShipPlacement &ship);
+
+    // Клетки корабля; пустая маска, если корабль не помещается на поле
+    static Bitboard shipMask(int x, int y, int size, bool isHorizontal);
+    // Клетки корабля вместе со всеми соседними клетками
+    static Bitboard haloMask(int x, int y, int size, bool isHorizontal);
+
+    // Разбивает занятые клетки на корабли (горизонтальные и вертикальные отрезки)
+    static QVector<ShipPlacement> shipsFromMask(const Bitboard &cells);
+
+    static const char *errorMessage(Error error);
+};
+
+#endif // FLEETVALIDATOR_H
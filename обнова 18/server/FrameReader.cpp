@@ -0,0 +1,105 @@
+#include "FrameReader.h"
+#include "WireProtocol.h"
+#include <QtEndian>
+
+void FrameReader::append(const QByteArray &data)
+{
+    // Сдвигаем буфер только здесь, чтобы кадры, выданные в текущей пачке, оставались действительными
+    if (readPos == buffer.size()) {
+        buffer.clear();
+    } else if (readPos > 0) {
+        buffer.remove(0, readPos);
+    }
+    readPos = 0;
+    buffer.append(data);
+}
+
+bool FrameReader::nextFrame(QByteArrayView &frame, FrameKind &kind)
+{
+    while (!error && readPos < buffer.size()) {
+        const char *begin = buffer.constData() + readPos;
+        qsizetype available = buffer.size() - readPos;
+
+        if (*begin == LengthPrefixMarker) {
+            if (available < LengthPrefixHeaderSize) {
+                return false;
+            }
+            quint32 length = qFromBigEndian<quint32>(begin + 1);
+            if (length > quint32(MaxFrameSize)) {
+                error = true;
+                return false;
+            }
+            if (available < LengthPrefixHeaderSize + qsizetype(length)) {
+                return false;
+            }
+            frame = QByteArrayView(begin + LengthPrefixHeaderSize, length);
+            kind = LengthPrefixedFrame;
+            readPos += LengthPrefixHeaderSize + length;
+            return true;
+        }
+
+        if (*begin == BinaryMarker) {
+            if (available < BinaryHeaderSize) {
+                return false;
+            }
+            quint16 length = qFromBigEndian<quint16>(begin + 1);
+            if (available < BinaryHeaderSize + qsizetype(length)) {
+                return false;
+            }
+            frame = QByteArrayView(begin + BinaryHeaderSize, length);
+            kind = BinaryFrame;
+            readPos += BinaryHeaderSize + length;
+            return true;
+        }
+
+        qsizetype newline = buffer.indexOf('\n', readPos);
+        if (newline == -1) {
+            if (available > MaxFrameSize) {
+                error = true;
+            }
+            return false;
+        }
+
+        qsizetype length = newline - readPos;
+        readPos = newline + 1;
+        frame = QByteArrayView(begin, length).trimmed();
+        if (frame.isEmpty()) {
+            continue; // Пустые строки между сообщениями пропускаем
+        }
+        kind = LineFrame;
+        return true;
+    }
+    return false;
+}
+
+QByteArray FrameReader::encode(const QByteArray &payload, FrameKind kind)
+{
+    if (kind == LineFrame) {
+        return payload;
+    }
+    if (kind == BinaryFrame && payload.startsWith(BinaryMarker)) {
+        return payload;
+    }
+
+    QByteArray framed;
+    framed.reserve(payload.size() + LengthPrefixHeaderSize);
+    qsizetype start = 0;
+    while (start < payload.size()) {
+        qsizetype end = payload.indexOf('\n', start);
+        if (end == -1) {
+            end = payload.size();
+        }
+        QByteArrayView message = QByteArrayView(payload.constData() + start, end - start).trimmed();
+        if (!message.isEmpty() && kind == BinaryFrame) {
+            framed.append(WireProtocol::encodeJson(message));
+        } else if (!message.isEmpty()) {
+            char header[LengthPrefixHeaderSize];
+            header[0] = LengthPrefixMarker;
+            qToBigEndian<quint32>(quint32(message.size()), header + 1);
+            framed.append(header, LengthPrefixHeaderSize);
+            framed.append(message);
+        }
+        start = end + 1;
+    }
+    return framed;
+}
@@ -0,0 +1,47 @@
+#ifndef FRAMEREADER_H
+#define FRAMEREADER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+// Буфер приёма одного соединения, выделяющий из потока TCP полные кадры.
+// Поддерживаются три вида кадров:
+//  - строка, завершённая '\n' (возможный '\r' перед ним отбрасывается);
+//  - кадр с префиксом длины: байт 0x00, затем длина полезной нагрузки (quint32, big-endian);
+//  - двоичный кадр: байт 0x01, затем длина (quint16, big-endian) и сообщение WireProtocol.
+class FrameReader
+{
+public:
+    enum FrameKind {
+        LineFrame,
+        LengthPrefixedFrame,
+        BinaryFrame
+    };
+
+    static const char LengthPrefixMarker = '\0';
+    static const int LengthPrefixHeaderSize = 5;
+    static const char BinaryMarker = '\x01';
+    static const int BinaryHeaderSize = 3;
+    static const int MaxFrameSize = 64 * 1024;
+
+    // Добавляет принятые данные. Ранее выданные кадры после этого недействительны.
+    void append(const QByteArray &data);
+
+    // Выдаёт следующий полный кадр без копирования: frame указывает внутрь буфера
+    // и действителен до следующего вызова append()
+    bool nextFrame(QByteArrayView &frame, FrameKind &kind);
+
+    bool hasError() const { return error; }
+    qsizetype bufferedBytes() const { return buffer.size() - readPos; }
+
+    // Оформляет исходящие сообщения (одно или несколько, по строке на сообщение) в кадры нужного вида.
+    // Для BinaryFrame уже готовые двоичные кадры передаются как есть, JSON-строки заворачиваются в них
+    static QByteArray encode(const QByteArray &payload, FrameKind kind);
+
+private:
+    QByteArray buffer;
+    qsizetype readPos = 0; // Начало ещё не разобранных данных
+    bool error = false; // Кадр превысил MaxFrameSize, поток дальше не разбирается
+};
+
+#endif // FRAMEREADER_H
@@ -0,0 +1,95 @@
+#include "GameBoard.h"
+#include <cstring>
+
+GameBoard::GameBoard()
+{
+    clear();
+}
+
+void GameBoard::clear()
+{
+    ships = Bitboard();
+    shots = Bitboard();
+    std::memset(cellShip, -1, sizeof(cellShip));
+    std::memset(shipSize, 0, sizeof(shipSize));
+    std::memset(shipHits, 0, sizeof(shipHits));
+    shipCount = 0;
+    sunkCount = 0;
+}
+
+QVector<ShipPlacement> GameBoard::getPlacements() const
+{
+    QVector<ShipPlacement> result;
+    result.reserve(shipCount);
+    for (int i = 0; i < shipCount; ++i) {
+        result.append(placements[i]);
+    }
+    return result;
+}
+
+Bitboard GameBoard::getSunkCells() const
+{
+    Bitboard cells;
+    for (int i = 0; i < shipCount; ++i) {
+        if (shipHits[i] == shipSize[i]) {
+            cells |= FleetValidator::shipMask(placements[i].x, placements[i].y, placements[i].size, placements[i].isHorizontal);
+        }
+    }
+    return cells;
+}
+
+bool GameBoard::placeShip(int x, int y, int size, bool isHorizontal)
+{
+    if (shipCount >= MaxShips || size > MaxShipSize) {
+        return false;
+    }
+    Bitboard mask = shipMask(x, y, size, isHorizontal);
+    if (mask.isEmpty() || !(mask & ships).isEmpty()) {
+        return false;
+    }
+
+    int step = isHorizontal ? 1 : Bitboard::Size;
+    for (int i = 0, index = Bitboard::index(x, y); i < size; ++i, index += step) {
+        cellShip[index] = qint8(shipCount);
+    }
+    ships |= mask;
+    placements[shipCount] = ShipPlacement{x, y, size, isHorizontal};
+    shipSize[shipCount] = quint8(size);
+    shipHits[shipCount] = 0;
+    ++shipCount;
+    return true;
+}
+
+GameBoard::ShotResult GameBoard::fire(int x, int y)
+{
+    if (!Bitboard::inBounds(x, y)) {
+        return InvalidCell;
+    }
+    int index = Bitboard::index(x, y);
+    if (shots.test(index)) {
+        return AlreadyShot;
+    }
+    shots.set(index);
+
+    int ship = cellShip[index];
+    if (ship < 0) {
+        return Miss;
+    }
+    if (++shipHits[ship] < shipSize[ship]) {
+        return Hit;
+    }
+    ++sunkCount;
+    return Sunk;
+}
+
+const char *GameBoard::resultName(ShotResult result)
+{
+    switch (result) {
+    case Miss: return "miss";
+    case Hit: return "hit";
+    case Sunk: return "sunk";
+    case AlreadyShot: return "already_shot";
+    case InvalidCell: return "error";
+    }
+    return "error";
+}
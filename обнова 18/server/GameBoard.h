@@ -0,0 +1,56 @@
+#ifndef GAMEBOARD_H
+#define GAMEBOARD_H
+
+#include "Bitboard.h"
+#include "FleetValidator.h"
+
+// Поле одного игрока в памяти сервера: его корабли и выстрелы соперника по ним.
+// Результат выстрела определяется без обращения к БД.
+class GameBoard
+{
+public:
+    enum ShotResult {
+        Miss,
+        Hit,
+        Sunk,
+        AlreadyShot,
+        InvalidCell
+    };
+
+    static const int MaxShips = 10;
+    static const int MaxShipSize = FleetValidator::MaxShipSize;
+
+    GameBoard();
+
+    // Размещает корабль; false, если он выходит за поле, пересекает другой корабль или флот уже полон
+    bool placeShip(int x, int y, int size, bool isHorizontal);
+    bool placeShip(const ShipPlacement &ship) { return placeShip(ship.x, ship.y, ship.size, ship.isHorizontal); }
+    ShotResult fire(int x, int y);
+    void clear();
+
+    int getShipCount() const { return shipCount; }
+    int getSunkCount() const { return sunkCount; }
+    bool allSunk() const { return shipCount > 0 && sunkCount == shipCount; }
+    Bitboard getShips() const { return ships; }
+    Bitboard getShots() const { return shots; }
+    QVector<ShipPlacement> getPlacements() const;
+    Bitboard getSunkCells() const; // Клетки потопленных кораблей
+
+    static const char *resultName(ShotResult result);
+    static Bitboard shipMask(int x, int y, int size, bool isHorizontal)
+    {
+        return FleetValidator::shipMask(x, y, size, isHorizontal);
+    }
+
+private:
+    Bitboard ships; // Клетки, занятые кораблями
+    Bitboard shots; // Клетки, по которым уже стреляли
+    qint8 cellShip[Bitboard::CellCount]; // Номер корабля в клетке или -1
+    ShipPlacement placements[MaxShips];
+    quint8 shipSize[MaxShips];
+    quint8 shipHits[MaxShips]; // Счётчики попаданий по каждому кораблю
+    int shipCount;
+    int sunkCount;
+};
+
+#endif // GAMEBOARD_H
@@ -0,0 +1,95 @@
+#include "GameSession.h"
+
+GameSession::GameSession(int gameId, PlayerId player1, PlayerId player2)
+    : gameId(gameId), currentTurn(player1)
+{
+    players[0] = player1;
+    players[1] = player2;
+    ready[0] = ready[1] = false;
+    sunkShips[0] = sunkShips[1] = 0;
+}
+
+int GameSession::playerIndex(PlayerId player) const
+{
+    if (player == NoPlayer) return -1;
+    if (players[0] == player) return 0;
+    if (players[1] == player) return 1;
+    return -1;
+}
+
+bool GameSession::hasPlayer(PlayerId player) const
+{
+    return playerIndex(player) != -1;
+}
+
+PlayerId GameSession::getOpponent(PlayerId player) const
+{
+    int index = playerIndex(player);
+    if (index == -1) {
+        return NoPlayer;
+    }
+    return players[1 - index];
+}
+
+void GameSession::setReady(PlayerId player)
+{
+    int index = playerIndex(player);
+    if (index != -1) {
+        ready[index] = true;
+    }
+}
+
+bool GameSession::allReady() const
+{
+    return ready[0] && ready[1];
+}
+
+GameBoard *GameSession::getBoard(PlayerId player)
+{
+    int index = playerIndex(player);
+    return index == -1 ? nullptr : &boards[index];
+}
+
+GameBoard::ShotResult GameSession::fire(PlayerId shooter, int x, int y)
+{
+    int index = playerIndex(shooter);
+    if (index == -1) {
+        return GameBoard::InvalidCell;
+    }
+    return boards[1 - index].fire(x, y);
+}
+
+int GameSession::addSunkShip(PlayerId player)
+{
+    int index = playerIndex(player);
+    if (index == -1) {
+        return 0;
+    }
+    return ++sunkShips[index];
+}
+
+int GameSession::getSunkShips(PlayerId player) const
+{
+    int index = playerIndex(player);
+    return index == -1 ? 0 : sunkShips[index];
+}
+
+TimerWheel::TimerId GameSession::getGraceTimer(PlayerId player) const
+{
+    int index = playerIndex(player);
+    return index == -1 ? 0 : graceTimers[index];
+}
+
+void GameSession::setGraceTimer(PlayerId player, TimerWheel::TimerId timer)
+{
+    int index = playerIndex(player);
+    if (index != -1) {
+        graceTimers[index] = timer;
+    }
+}
+
+bool GameSession::isReady(PlayerId player) const
+{
+    int index = playerIndex(player);
+    return index != -1 && ready[index];
+}
@@ -0,0 +1,57 @@
+#ifndef GAMESESSION_H
+#define GAMESESSION_H
+
+#include "GameBoard.h"
+#include "PlayerRegistry.h"
+#include "TimerWheel.h"
+
+// Состояние одной партии (комнаты): игроки, готовность, очередь хода и счётчики потопленных кораблей.
+// Сессию изменяет только воркер, за которым она закреплена; ID игры и игроки после создания не меняются.
+// Игроки хранятся числовыми ID, поэтому ход обходится без сравнения строк.
+class GameSession
+{
+public:
+    GameSession(int gameId, PlayerId player1, PlayerId player2);
+
+    int getGameId() const { return gameId; }
+    PlayerId getPlayer(int index) const { return players[index]; } // 0 или 1, players[0] ходит первым
+    bool hasPlayer(PlayerId player) const;
+    PlayerId getOpponent(PlayerId player) const;
+
+    // Готовность к бою
+    void setReady(PlayerId player);
+    bool allReady() const;
+
+    // Очередь хода
+    PlayerId getCurrentTurn() const { return currentTurn; }
+    void setCurrentTurn(PlayerId player) { currentTurn = player; }
+    // Срок текущего хода в колесе таймеров воркера сессии, 0 - часы не идут
+    TimerWheel::TimerId getTurnTimer() const { return turnTimer; }
+    void setTurnTimer(TimerWheel::TimerId timer) { turnTimer = timer; }
+    // Ожидание переподключения игрока, 0 - игрок на связи
+    TimerWheel::TimerId getGraceTimer(PlayerId player) const;
+    void setGraceTimer(PlayerId player, TimerWheel::TimerId timer);
+    bool isReady(PlayerId player) const;
+
+    // Поля игроков в памяти: результат хода вычисляется без обращения к БД
+    GameBoard *getBoard(PlayerId player);
+    GameBoard::ShotResult fire(PlayerId shooter, int x, int y); // Выстрел по полю соперника
+
+    // Потопленные корабли (возвращает новое значение счётчика)
+    int addSunkShip(PlayerId player);
+    int getSunkShips(PlayerId player) const;
+
+private:
+    int playerIndex(PlayerId player) const;
+
+    int gameId;
+    PlayerId players[2]; // Ровно два игрока
+    bool ready[2];
+    int sunkShips[2];
+    GameBoard boards[2]; // boards[i] - корабли players[i] и выстрелы соперника по ним
+    PlayerId currentTurn;
+    TimerWheel::TimerId turnTimer = 0;
+    TimerWheel::TimerId graceTimers[2] = {0, 0};
+};
+
+#endif // GAMESESSION_H
@@ -0,0 +1,230 @@
+#include "Logger.h"
+#include "Metrics.h"
+#include <QDateTime>
+#include <cstdio>
+#include <cstdlib>
+
+static const int FlushIntervalMs = 5;
+
+std::atomic<int> Logger::minLevel{Logger::Debug};
+
+QString LogArg::toString() const
+{
+    switch (kind) {
+    case Empty: return QString();
+    case Boolean: return integer ? QStringLiteral("true") : QStringLiteral("false");
+    case Integer: return QString::number(integer);
+    case Unsigned: return QString::number(quint64(integer));
+    case Real: return QString::number(real);
+    case Text: return text;
+    case Bytes: return QString::fromUtf8(bytes);
+    }
+    return QString();
+}
+
+Logger::Logger() : QThread(nullptr)
+{
+    setObjectName("logger");
+    Metrics::getInstance().gauge("seabattle_log_dropped_records", "Log records dropped because a thread's ring buffer was full.",
+                                 [this]() { return double(getDropped()); });
+}
+
+Logger &Logger::getInstance()
+{
+    static Logger instance;
+    return instance;
+}
+
+bool Logger::parseLevel(const QString &name, Level &level)
+{
+    for (int candidate = Trace; candidate <= Off; ++candidate) {
+        if (name.compare(QLatin1String(levelName(Level(candidate))), Qt::CaseInsensitive) == 0) {
+            level = Level(candidate);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *Logger::levelName(Level level)
+{
+    switch (level) {
+    case Trace: return "trace";
+    case Debug: return "debug";
+    case Info: return "info";
+    case Warning: return "warning";
+    case Error: return "error";
+    case Off: return "off";
+    }
+    return "unknown";
+}
+
+Logger::Ring *Logger::threadRing()
+{
+    thread_local Ring *ring = nullptr;
+    if (!ring) {
+        // Кольцо создаётся при первой записи потока и живёт до конца процесса
+        std::unique_ptr<Ring> created = std::make_unique<Ring>();
+        QThread *current = QThread::currentThread();
+        created->threadName = current && !current->objectName().isEmpty()
+            ? current->objectName().toUtf8()
+            : QByteArray("thread-") + QByteArray::number(quintptr(current), 16);
+        ring = created.get();
+        QMutexLocker locker(&ringsMutex);
+        rings.push_back(std::move(created));
+    }
+    return ring;
+}
+
+void Logger::push(Record &&record)
+{
+    record.timeMs = QDateTime::currentMSecsSinceEpoch();
+    if (!draining.load(std::memory_order_acquire)) {
+        writeNow(record);
+        return;
+    }
+    Ring *ring = threadRing();
+    quint32 head = ring->head.load(std::memory_order_relaxed);
+    quint32 used = head - ring->tail.load(std::memory_order_acquire);
+    if (used >= Ring::Capacity) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring->records[head % Ring::Capacity] = std::move(record);
+    ring->head.store(head + 1, std::memory_order_release);
+    // Поток журнала и так просыпается каждые FlushIntervalMs; будим раньше, только если кольцо наполовину полно
+    if (used + 1 == Ring::Capacity / 2) {
+        wakeup.release();
+    }
+}
+
+void Logger::writeNow(const Record &record)
+{
+    QThread *current = QThread::currentThread();
+    QByteArray line = format(record, current ? current->objectName().toUtf8() : QByteArray());
+    QMutexLocker locker(&directMutex);
+    fwrite(line.constData(), 1, size_t(line.size()), stderr);
+}
+
+QByteArray Logger::format(const Record &record, const QByteArray &threadName)
+{
+    // Подстановка %1..%9 за один проход: текст аргументов не разбирается повторно
+    QString message;
+    const char *text = record.format;
+    for (const char *p = text; *p; ++p) {
+        if (*p == '%' && p[1] >= '1' && p[1] <= '9' && p[1] - '1' < record.argCount) {
+            message += QString::fromUtf8(text, p - text);
+            message += record.args[p[1] - '1'].toString();
+            text = p + 2;
+            ++p;
+        }
+    }
+    message += QString::fromUtf8(text);
+
+    QByteArray line = QDateTime::fromMSecsSinceEpoch(record.timeMs).toString("yyyy-MM-dd HH:mm:ss.zzz").toLatin1();
+    line += ' ';
+    line += QByteArray(levelName(record.level)).toUpper().leftJustified(7, ' ');
+    line += " [" + threadName + "] ";
+    line += message.toUtf8();
+    line += '\n';
+    return line;
+}
+
+int Logger::drain(QByteArray &output)
+{
+    std::vector<Ring*> snapshot;
+    {
+        QMutexLocker locker(&ringsMutex);
+        snapshot.reserve(rings.size());
+        for (const std::unique_ptr<Ring> &ring : rings) {
+            snapshot.push_back(ring.get());
+        }
+    }
+
+    int count = 0;
+    for (Ring *ring : snapshot) {
+        quint32 tail = ring->tail.load(std::memory_order_relaxed);
+        quint32 head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            Record record = std::move(ring->records[tail % Ring::Capacity]);
+            ring->tail.store(++tail, std::memory_order_release);
+            output += format(record, ring->threadName);
+            ++count;
+        }
+    }
+    qint64 total = dropped.load(std::memory_order_relaxed);
+    qint64 lost = total - reportedDrops;
+    reportedDrops = total;
+    if (lost > 0) {
+        output += "Logger dropped " + QByteArray::number(lost) + " records: ring buffers were full\n";
+    }
+    return count;
+}
+
+void Logger::run()
+{
+    QByteArray output;
+    for (;;) {
+        wakeup.tryAcquire(1, FlushIntervalMs);
+        bool last = stopping.load(std::memory_order_acquire);
+        output.clear();
+        drain(output);
+        if (!output.isEmpty()) {
+            fwrite(output.constData(), 1, size_t(output.size()), stderr);
+            fflush(stderr);
+        }
+        if (last) {
+            break;
+        }
+    }
+}
+
+void Logger::startDraining()
+{
+    if (isRunning()) {
+        return;
+    }
+    stopping.store(false, std::memory_order_relaxed);
+    draining.store(true, std::memory_order_release);
+    start();
+}
+
+void Logger::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+    // Новые записи пишутся сразу, а поток журнала дописывает то, что уже лежит в кольцах
+    draining.store(false, std::memory_order_release);
+    stopping.store(true, std::memory_order_release);
+    wakeup.release();
+    wait();
+}
+
+void Logger::installMessageHandler()
+{
+    qInstallMessageHandler(&Logger::messageHandler);
+}
+
+void Logger::messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    Q_UNUSED(context)
+    Level level = Debug;
+    switch (type) {
+    case QtDebugMsg: level = Debug; break;
+    case QtInfoMsg: level = Info; break;
+    case QtWarningMsg: level = Warning; break;
+    case QtCriticalMsg:
+    case QtFatalMsg: level = Error; break;
+    }
+    if (type == QtFatalMsg) {
+        // Процесс сейчас завершится: пишем сразу, минуя очередь
+        getInstance().stop();
+        QByteArray line = message.toUtf8() + '\n';
+        fwrite(line.constData(), 1, size_t(line.size()), stderr);
+        std::abort();
+    }
+    if (enabled(level)) {
+        getInstance().write(level, "%1", message);
+    }
+}
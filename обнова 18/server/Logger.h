@@ -0,0 +1,175 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QThread>
+#include <QSemaphore>
+#include <QMutex>
+#include <QString>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QDebug>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Аргумент записи журнала: хранится в исходном виде, в текст превращается только потоком журнала.
+// Строки Qt разделяемые, поэтому их копирование - это лишь увеличение счётчика ссылок
+class LogArg
+{
+public:
+    LogArg() = default;
+    LogArg(bool value) : kind(Boolean), integer(value) {}
+    LogArg(int value) : kind(Integer), integer(value) {}
+    LogArg(uint value) : kind(Unsigned), integer(value) {}
+    LogArg(long value) : kind(Integer), integer(value) {}
+    LogArg(ulong value) : kind(Unsigned), integer(qint64(value)) {}
+    LogArg(qlonglong value) : kind(Integer), integer(value) {}
+    LogArg(qulonglong value) : kind(Unsigned), integer(qint64(value)) {}
+    LogArg(double value) : kind(Real), real(value) {}
+    LogArg(const char *value) : kind(Bytes), bytes(value) {}
+    LogArg(const QString &value) : kind(Text), text(value) {}
+    LogArg(const QByteArray &value) : kind(Bytes), bytes(value) {}
+    LogArg(QByteArrayView value) : kind(Bytes), bytes(value.toByteArray()) {} // Представление живёт не дольше вызова
+
+    // Прочие типы (списки, ошибки, перечисления) форматируются сразу через QDebug
+    template <typename T>
+    LogArg(const T &value) : kind(Text)
+    {
+        QDebug(&text).noquote().nospace() << value;
+    }
+
+    QString toString() const;
+
+private:
+    enum Kind {
+        Empty,
+        Boolean,
+        Integer,
+        Unsigned,
+        Real,
+        Text,
+        Bytes
+    };
+
+    Kind kind = Empty;
+    union {
+        qint64 integer = 0;
+        double real;
+    };
+    QString text;
+    QByteArray bytes;
+};
+
+// Асинхронный журнал сервера.
+// Каждый поток пишет записи (время, уровень, указатель на строку формата и аргументы) в свой кольцевой буфер
+// без блокировок; отдельный поток журнала забирает их, подставляет аргументы в "%1", "%2", ... и пишет в stderr.
+// Если буфер потока полон, запись отбрасывается и учитывается в getDropped(): цикл событий никогда не ждёт журнал.
+// Пока поток журнала не запущен (или уже остановлен), записи пишутся сразу в вызывающем потоке.
+// Уровень меняется на ходу; LOG_TRACE в сборке без отладки (QT_NO_DEBUG) не компилируется вовсе.
+class Logger : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Level {
+        Trace,
+        Debug,
+        Info,
+        Warning,
+        Error,
+        Off
+    };
+
+    static const int MaxArgs = 6;
+
+    static Logger &getInstance();
+    static bool enabled(Level level) { return level >= minLevel.load(std::memory_order_relaxed); }
+    static void setLevel(Level level) { minLevel.store(level, std::memory_order_relaxed); }
+    static Level getLevel() { return Level(minLevel.load(std::memory_order_relaxed)); }
+    static bool parseLevel(const QString &name, Level &level);
+    static const char *levelName(Level level);
+
+    // format должен быть строковым литералом: сохраняется только указатель
+    template <typename... Args>
+    void write(Level level, const char *format, const Args &...args)
+    {
+        static_assert(sizeof...(Args) <= MaxArgs, "Too many log arguments");
+        Record record;
+        record.level = level;
+        record.format = format;
+        record.argCount = sizeof...(Args);
+        int index = 0;
+        ((record.args[index++] = LogArg(args)), ...);
+        Q_UNUSED(index)
+        push(std::move(record));
+    }
+
+    void startDraining(); // Запускает поток журнала
+    void stop(); // Дописывает накопленное и завершает поток журнала
+    void installMessageHandler(); // qDebug() и предупреждения Qt тоже идут через журнал
+    qint64 getDropped() const { return dropped.load(std::memory_order_relaxed); } // Всего с запуска
+
+protected:
+    void run() override;
+
+private:
+    struct Record
+    {
+        qint64 timeMs = 0;
+        Level level = Debug;
+        const char *format = nullptr;
+        int argCount = 0;
+        LogArg args[MaxArgs];
+    };
+
+    // Кольцо одного потока: пишет только он, читает только поток журнала
+    struct Ring
+    {
+        static const quint32 Capacity = 2048;
+
+        QByteArray threadName;
+        Record records[Capacity];
+        std::atomic<quint32> head{0}; // Следующая запись производителя
+        std::atomic<quint32> tail{0}; // Следующая запись потока журнала
+    };
+
+    Logger();
+    Logger(const Logger&) = delete;
+    Logger &operator=(const Logger&) = delete;
+
+    Ring *threadRing();
+    void push(Record &&record);
+    void writeNow(const Record &record);
+    int drain(QByteArray &output);
+    static QByteArray format(const Record &record, const QByteArray &threadName);
+    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message);
+
+    static std::atomic<int> minLevel;
+    QMutex ringsMutex; // Защищает только список колец
+    std::vector<std::unique_ptr<Ring>> rings;
+    QSemaphore wakeup;
+    QMutex directMutex; // Порядок строк при записи без потока журнала
+    std::atomic<bool> draining{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<qint64> dropped{0};
+    qint64 reportedDrops = 0; // Только поток журнала
+};
+
+#define LOG_AT(level, ...) \
+    do { \
+        if (Logger::enabled(level)) { \
+            Logger::getInstance().write(level, __VA_ARGS__); \
+        } \
+    } while (false)
+
+#ifdef QT_NO_DEBUG
+#define LOG_TRACE(...) do {} while (false)
+#else
+#define LOG_TRACE(...) LOG_AT(Logger::Trace, __VA_ARGS__)
+#endif
+#define LOG_DEBUG(...) LOG_AT(Logger::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(Logger::Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(Logger::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(Logger::Error, __VA_ARGS__)
+
+#endif // LOGGER_H
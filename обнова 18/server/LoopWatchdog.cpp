@@ -0,0 +1,209 @@
+#include "LoopWatchdog.h"
+#include "Logger.h"
+#include <QTimer>
+
+thread_local LoopWatchdog::Loop *LoopWatchdog::currentLoop = nullptr;
+
+LoopWatchdog::Activity::Activity(const char *label) : loop(currentLoop)
+{
+    if (!loop) {
+        return;
+    }
+    depth = loop->depth.load(std::memory_order_relaxed);
+    if (depth < MaxDepth) {
+        loop->labels[depth].store(label, std::memory_order_relaxed);
+    }
+    loop->depth.store(depth + 1, std::memory_order_release);
+}
+
+LoopWatchdog::Activity::~Activity()
+{
+    if (loop) {
+        loop->depth.store(depth, std::memory_order_release);
+    }
+}
+
+LoopWatchdog::LoopWatchdog() : QThread(nullptr), lagBuckets(new std::atomic<qint64>[BucketCount])
+{
+    setObjectName("watchdog");
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        lagBuckets[bucket].store(0, std::memory_order_relaxed);
+    }
+    Metrics::getInstance().gauge("seabattle_event_loop_stalls", "Times an event loop stayed blocked longer than the stall threshold.",
+                                 [this]() { return double(getStallCount()); });
+}
+
+LoopWatchdog &LoopWatchdog::getInstance()
+{
+    static LoopWatchdog instance;
+    return instance;
+}
+
+void LoopWatchdog::watchCurrentThread(QObject *owner, const QString &name)
+{
+    if (currentLoop) {
+        return;
+    }
+    std::unique_ptr<Loop> created = std::make_unique<Loop>();
+    Loop *loop = created.get();
+    loop->name = name.toUtf8();
+    loop->lag = Metrics::getInstance().histogram("seabattle_event_loop_lag_seconds", "How late the event loop's probe timer fired.",
+                                                 QString("thread=\"%1\"").arg(name));
+    loop->lastBeatNs.store(Metrics::nowNs(), std::memory_order_relaxed);
+    loop->active.store(true, std::memory_order_release);
+
+    loop->probe = new QTimer(owner);
+    loop->probe->setTimerType(Qt::PreciseTimer);
+    loop->probe->setInterval(ProbeIntervalMs);
+    connect(loop->probe, &QTimer::timeout, loop->probe, [this, loop]() { beat(loop); });
+    loop->probe->start();
+    currentLoop = loop;
+
+    QMutexLocker locker(&mutex);
+    loops.push_back(std::move(created));
+}
+
+void LoopWatchdog::unwatchCurrentThread()
+{
+    Loop *loop = currentLoop;
+    if (!loop) {
+        return;
+    }
+    loop->active.store(false, std::memory_order_release);
+    delete loop->probe;
+    loop->probe = nullptr;
+    currentLoop = nullptr;
+}
+
+void LoopWatchdog::setStallThreshold(qint64 thresholdMs)
+{
+    this->thresholdMs.store(qMax<qint64>(0, thresholdMs), std::memory_order_relaxed);
+    wakeup.release(); // Новый порог - новый период проверки
+}
+
+void LoopWatchdog::beat(Loop *loop)
+{
+    // Лаг - насколько позже положенного сработал таймер: столько цикл был занят чем-то другим
+    qint64 now = Metrics::nowNs();
+    qint64 lagNs = now - loop->lastBeatNs.exchange(now, std::memory_order_release) - qint64(ProbeIntervalMs) * 1000000;
+    lagNs = qMax<qint64>(0, lagNs);
+    loop->lag->observeNs(lagNs);
+
+    qint64 lagMs = lagNs / 1000000;
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && lagMs > (qint64(1) << bucket)) {
+        ++bucket;
+    }
+    lagBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void LoopWatchdog::run()
+{
+    for (;;) {
+        qint64 threshold = thresholdMs.load(std::memory_order_relaxed);
+        // Проверяем в несколько раз чаще порога, чтобы зависание замечалось почти сразу
+        wakeup.tryAcquire(1, threshold > 0 ? int(qBound<qint64>(5, threshold / 4, 1000)) : 1000);
+        if (stopping.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (threshold == 0) {
+            continue;
+        }
+
+        std::vector<Loop*> snapshot;
+        {
+            QMutexLocker locker(&mutex);
+            snapshot.reserve(loops.size());
+            for (const std::unique_ptr<Loop> &loop : loops) {
+                snapshot.push_back(loop.get());
+            }
+        }
+        qint64 now = Metrics::nowNs();
+        for (Loop *loop : snapshot) {
+            check(loop, now, threshold * 1000000);
+        }
+    }
+}
+
+void LoopWatchdog::check(Loop *loop, qint64 now, qint64 thresholdNs)
+{
+    if (!loop->active.load(std::memory_order_acquire)) {
+        loop->stalledSinceNs = 0;
+        return;
+    }
+    qint64 lastBeat = loop->lastBeatNs.load(std::memory_order_acquire);
+    qint64 silentNs = now - lastBeat - qint64(ProbeIntervalMs) * 1000000;
+    if (silentNs <= thresholdNs) {
+        if (loop->stalledSinceNs != 0) {
+            LOG_WARNING("Event loop of %1 is running again after %2 ms", loop->name, (lastBeat - loop->stalledSinceNs) / 1000000);
+            loop->stalledSinceNs = 0;
+        }
+        return;
+    }
+    if (loop->stalledSinceNs != 0) {
+        return; // Это зависание уже учтено
+    }
+
+    // Метки читаются на ходу: цикл мог уже выйти из обработчика, но указатели всегда на строковые литералы
+    loop->stalledSinceNs = lastBeat;
+    QByteArray activity = activityOf(loop);
+    stallCount.fetch_add(1, std::memory_order_relaxed);
+    {
+        QMutexLocker locker(&mutex);
+        ++stalls[activity];
+    }
+    Metrics::getInstance().counter("seabattle_event_loop_stalls_total", "Event loop stalls by the activity that was running.",
+                                   QString("activity=\"%1\"").arg(QString::fromUtf8(activity)))->add();
+    LOG_WARNING("Event loop of %1 is blocked for %2 ms in %3", loop->name, silentNs / 1000000, activity);
+}
+
+QByteArray LoopWatchdog::activityOf(const Loop *loop)
+{
+    int depth = qMin<int>(loop->depth.load(std::memory_order_acquire), MaxDepth);
+    QByteArray activity;
+    for (int level = 0; level < depth; ++level) {
+        const char *label = loop->labels[level].load(std::memory_order_relaxed);
+        if (!label) {
+            continue;
+        }
+        if (!activity.isEmpty()) {
+            activity += '/';
+        }
+        activity += label;
+    }
+    return activity.isEmpty() ? QByteArray("unlabeled") : activity;
+}
+
+void LoopWatchdog::startWatching()
+{
+    if (isRunning()) {
+        return;
+    }
+    stopping.store(false, std::memory_order_relaxed);
+    start();
+}
+
+void LoopWatchdog::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+    stopping.store(true, std::memory_order_release);
+    wakeup.release();
+    wait();
+}
+
+QHash<QByteArray, qint64> LoopWatchdog::stallsByActivity() const
+{
+    QMutexLocker locker(&mutex);
+    return stalls;
+}
+
+QVector<qint64> LoopWatchdog::lagHistogram() const
+{
+    QVector<qint64> histogram(BucketCount, 0);
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        histogram[bucket] = lagBuckets[bucket].load(std::memory_order_relaxed);
+    }
+    return histogram;
+}
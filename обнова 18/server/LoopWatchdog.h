@@ -0,0 +1,96 @@
+#ifndef LOOPWATCHDOG_H
+#define LOOPWATCHDOG_H
+
+#include <QThread>
+#include <QSemaphore>
+#include <QMutex>
+#include <QHash>
+#include <QByteArray>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Metrics.h"
+
+class QTimer;
+
+// Сторож циклов событий: в каждом наблюдаемом потоке таймер тикает раз в ProbeIntervalMs,
+// и опоздание тика (лаг цикла) попадает в гистограмму. Отдельный поток сторожа проверяет, когда цикл тикал
+// последний раз; если дольше порога, цикл считается зависшим, и сторож записывает, что в нём выполнялось.
+// Что выполняется, потоки отмечают через Activity: метки вкладываются ("read/make_move/db.createGame").
+class LoopWatchdog : public QThread
+{
+    Q_OBJECT
+
+    struct Loop;
+
+public:
+    static const int ProbeIntervalMs = 20;
+    static const int MaxDepth = 4; // Вложенность меток Activity
+    // Гистограмма лага с границами корзин 1, 2, 4, ... 2^(BucketCount-2) мс и последней корзиной для остального
+    static const int BucketCount = 14;
+
+    // Метка текущей работы потока на время жизни объекта; label - строковый литерал
+    class Activity
+    {
+    public:
+        explicit Activity(const char *label);
+        ~Activity();
+        Activity(const Activity&) = delete;
+        Activity &operator=(const Activity&) = delete;
+
+    private:
+        Loop *loop;
+        int depth = 0;
+    };
+
+    static LoopWatchdog &getInstance();
+
+    // Вызываются в наблюдаемом потоке; таймер пробы становится дочерним owner
+    void watchCurrentThread(QObject *owner, const QString &name);
+    void unwatchCurrentThread(); // До остановки цикла, иначе остановку примут за зависание
+    void setStallThreshold(qint64 thresholdMs); // 0 - зависания не отслеживаются
+    void startWatching();
+    void stop();
+
+    qint64 getStallCount() const { return stallCount.load(std::memory_order_relaxed); }
+    QHash<QByteArray, qint64> stallsByActivity() const;
+    QVector<qint64> lagHistogram() const;
+
+protected:
+    void run() override;
+
+private:
+    // Состояние одного цикла: пишет его поток, читает поток сторожа
+    struct Loop
+    {
+        QByteArray name;
+        Metrics::Histogram *lag = nullptr;
+        QTimer *probe = nullptr;
+        std::atomic<bool> active{false};
+        std::atomic<qint64> lastBeatNs{0};
+        std::atomic<int> depth{0};
+        std::atomic<const char*> labels[MaxDepth] = {};
+        qint64 stalledSinceNs = 0; // Только поток сторожа: 0 - цикл не завис
+    };
+
+    LoopWatchdog();
+    LoopWatchdog(const LoopWatchdog&) = delete;
+    LoopWatchdog &operator=(const LoopWatchdog&) = delete;
+
+    void beat(Loop *loop);
+    void check(Loop *loop, qint64 now, qint64 thresholdNs);
+    static QByteArray activityOf(const Loop *loop);
+
+    static thread_local Loop *currentLoop;
+    mutable QMutex mutex; // Защищает список циклов и счётчики по меткам
+    std::vector<std::unique_ptr<Loop>> loops; // Живут до конца процесса, неактивные пропускаются
+    QHash<QByteArray, qint64> stalls; // Метка -> Сколько раз цикл завис на ней
+    std::unique_ptr<std::atomic<qint64>[]> lagBuckets;
+    std::atomic<qint64> thresholdMs{0};
+    std::atomic<qint64> stallCount{0};
+    std::atomic<bool> stopping{false};
+    QSemaphore wakeup;
+};
+
+#endif // LOOPWATCHDOG_H
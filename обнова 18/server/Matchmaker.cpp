@@ -0,0 +1,204 @@
+#include "Matchmaker.h"
+#include <utility>
+
+Matchmaker::Matchmaker(Clock source) : customClock(std::move(source)), waits(BucketCount, 0), depths(BucketCount, 0)
+{
+    clock.start();
+}
+
+void Matchmaker::configure(const Config &config)
+{
+    QMutexLocker locker(&mutex);
+    this->config = config;
+    this->config.bandWidth = qMax(0, config.bandWidth);
+    this->config.maxBandSpread = qMax(0, config.maxBandSpread);
+}
+
+Matchmaker::Config Matchmaker::getConfig() const
+{
+    QMutexLocker locker(&mutex);
+    return config;
+}
+
+int Matchmaker::bandOf(int rating) const
+{
+    if (config.bandWidth == 0) {
+        return 0;
+    }
+    // Деление с округлением вниз и для отрицательных рейтингов
+    return rating >= 0 ? rating / config.bandWidth : -((-rating + config.bandWidth - 1) / config.bandWidth);
+}
+
+int Matchmaker::allowedDifference(const Ticket &ticket, qint64 now) const
+{
+    return config.bandWidth + int(config.widenPerSecond * ((now - ticket.enqueuedAt) / 1000));
+}
+
+bool Matchmaker::findOpponent(const Ticket &ticket, qint64 now, Position &opponent)
+{
+    if (config.bandWidth == 0) {
+        Band &band = bands[0];
+        if (band.empty() || band.front().player == ticket.player) {
+            return false;
+        }
+        opponent = Position{0, band.begin()};
+        return true;
+    }
+
+    // Из каждой соседней полосы смотрим только старейшего игрока: он ждёт дольше всех и шире всех готов
+    bool found = false;
+    qint64 oldest = 0;
+    int home = bandOf(ticket.rating);
+    for (int offset = -config.maxBandSpread; offset <= config.maxBandSpread; ++offset) {
+        QHash<int, Band>::iterator band = bands.find(home + offset);
+        if (band == bands.end() || band->empty()) {
+            continue;
+        }
+        Band::iterator candidate = band->begin();
+        if (candidate->player == ticket.player) {
+            if (++candidate == band->end()) {
+                continue;
+            }
+        }
+        int difference = qAbs(candidate->rating - ticket.rating);
+        int allowed = qMax(allowedDifference(*candidate, now), allowedDifference(ticket, now));
+        if (difference <= allowed && (!found || candidate->enqueuedAt < oldest)) {
+            opponent = Position{home + offset, candidate};
+            oldest = candidate->enqueuedAt;
+            found = true;
+        }
+    }
+    return found;
+}
+
+Matchmaker::Match Matchmaker::take(const Ticket &ticket, const Position &opponent, qint64 now)
+{
+    Ticket other = *opponent.ticket;
+    bands[opponent.band].erase(opponent.ticket);
+    positions.remove(other.player);
+
+    Match match;
+    bool otherFirst = other.enqueuedAt <= ticket.enqueuedAt;
+    match.first = otherFirst ? other.player : ticket.player;
+    match.second = otherFirst ? ticket.player : other.player;
+    match.firstRating = otherFirst ? other.rating : ticket.rating;
+    match.secondRating = otherFirst ? ticket.rating : other.rating;
+    match.waitedMs = now - qMin(other.enqueuedAt, ticket.enqueuedAt);
+    record(waits, now - other.enqueuedAt);
+    record(waits, now - ticket.enqueuedAt);
+    ++matchesMade;
+    return match;
+}
+
+Matchmaker::JoinResult Matchmaker::join(PlayerId player, int rating, Match &match)
+{
+    QMutexLocker locker(&mutex);
+    if (player == NoPlayer || positions.contains(player)) {
+        return AlreadyQueued;
+    }
+
+    qint64 now = this->now();
+    record(depths, positions.size());
+    Ticket ticket{player, rating, now};
+    Position opponent;
+    if (findOpponent(ticket, now, opponent)) {
+        match = take(ticket, opponent, now);
+        return Matched;
+    }
+
+    int band = bandOf(rating);
+    Band &queue = bands[band];
+    queue.push_back(ticket);
+    positions.insert(player, Position{band, std::prev(queue.end())});
+    return Queued;
+}
+
+bool Matchmaker::leave(PlayerId player)
+{
+    QMutexLocker locker(&mutex);
+    QHash<PlayerId, Position>::iterator it = positions.find(player);
+    if (it == positions.end()) {
+        return false;
+    }
+    bands[it->band].erase(it->ticket);
+    positions.erase(it);
+    return true;
+}
+
+void Matchmaker::requeue(PlayerId player, int rating)
+{
+    QMutexLocker locker(&mutex);
+    if (player == NoPlayer || positions.contains(player)) {
+        return;
+    }
+    int band = bandOf(rating);
+    Band &queue = bands[band];
+    queue.push_front(Ticket{player, rating, now()});
+    positions.insert(player, Position{band, queue.begin()});
+}
+
+QVector<Matchmaker::Match> Matchmaker::sweep()
+{
+    QMutexLocker locker(&mutex);
+    QVector<Match> matches;
+    if (config.bandWidth == 0 || positions.size() < 2) {
+        return matches; // Без рейтинга пары составляются сразу в join()
+    }
+
+    // Старейшие игроки полос пробуют найти соперника с учётом выросшей допустимой разницы
+    qint64 now = this->now();
+    const QList<int> bandIds = bands.keys();
+    for (int bandId : bandIds) {
+        Band &band = bands[bandId];
+        while (!band.empty()) {
+            Ticket ticket = band.front();
+            Position opponent;
+            if (!findOpponent(ticket, now, opponent)) {
+                break;
+            }
+            band.pop_front();
+            positions.remove(ticket.player);
+            matches.append(take(ticket, opponent, now));
+        }
+    }
+    return matches;
+}
+
+int Matchmaker::depth() const
+{
+    QMutexLocker locker(&mutex);
+    return positions.size();
+}
+
+bool Matchmaker::isQueued(PlayerId player) const
+{
+    QMutexLocker locker(&mutex);
+    return positions.contains(player);
+}
+
+qint64 Matchmaker::getMatchesMade() const
+{
+    QMutexLocker locker(&mutex);
+    return matchesMade;
+}
+
+QVector<qint64> Matchmaker::waitHistogram() const
+{
+    QMutexLocker locker(&mutex);
+    return waits;
+}
+
+QVector<qint64> Matchmaker::depthHistogram() const
+{
+    QMutexLocker locker(&mutex);
+    return depths;
+}
+
+void Matchmaker::record(QVector<qint64> &histogram, qint64 value)
+{
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && value > (qint64(1) << bucket)) {
+        ++bucket;
+    }
+    ++histogram[bucket];
+}
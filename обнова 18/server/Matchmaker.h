@@ -0,0 +1,97 @@
+#ifndef MATCHMAKER_H
+#define MATCHMAKER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QVector>
+#include <functional>
+#include <list>
+#include "PlayerRegistry.h"
+
+// Очередь подбора соперников для start_game.
+// Без рейтинга игроки сводятся строго по очереди (FIFO). С рейтингом очередь делится на полосы
+// шириной bandWidth; новый игрок сравнивается только со старейшими игроками соседних полос,
+// поэтому подбор занимает O(1). Допустимая разница рейтингов растёт на widenPerSecond
+// за каждую секунду ожидания, а sweep() доводит до пары тех, кому подходящий соперник нашёлся позже.
+class Matchmaker
+{
+public:
+    struct Config
+    {
+        int bandWidth = 0; // 0 - без учёта рейтинга
+        int widenPerSecond = 50;
+        int maxBandSpread = 4; // Сколько соседних полос в каждую сторону просматривается
+    };
+
+    struct Match
+    {
+        PlayerId first = NoPlayer; // Ждал дольше, ходит первым
+        PlayerId second = NoPlayer;
+        int firstRating = 0;
+        int secondRating = 0;
+        qint64 waitedMs = 0; // Ожидание первого игрока
+    };
+
+    enum JoinResult {
+        Queued,
+        AlreadyQueued,
+        Matched
+    };
+
+    // Гистограммы с границами корзин 1, 2, 4, ... 2^(BucketCount-2) и последней корзиной для остального
+    static const int BucketCount = 18;
+
+    typedef std::function<qint64()> Clock; // Монотонное время в мс
+
+    // По умолчанию время отсчитывается от создания очереди; тесты подставляют свои часы
+    explicit Matchmaker(Clock source = Clock());
+
+    void configure(const Config &config);
+    Config getConfig() const;
+    JoinResult join(PlayerId player, int rating, Match &match);
+    bool leave(PlayerId player);
+    void requeue(PlayerId player, int rating); // Возвращает игрока в начало очереди без подбора пары
+    QVector<Match> sweep(); // Пары, ставшие возможными из-за расширения полос
+
+    int depth() const;
+    bool isQueued(PlayerId player) const;
+    qint64 getMatchesMade() const;
+    QVector<qint64> waitHistogram() const; // Время ожидания соперника, мс
+    QVector<qint64> depthHistogram() const; // Длина очереди в момент постановки игрока
+
+private:
+    struct Ticket
+    {
+        PlayerId player;
+        int rating;
+        qint64 enqueuedAt; // Мс от запуска clock
+    };
+
+    typedef std::list<Ticket> Band;
+
+    struct Position
+    {
+        int band;
+        Band::iterator ticket;
+    };
+
+    int bandOf(int rating) const;
+    int allowedDifference(const Ticket &ticket, qint64 now) const;
+    bool findOpponent(const Ticket &ticket, qint64 now, Position &opponent);
+    Match take(const Ticket &ticket, const Position &opponent, qint64 now);
+    static void record(QVector<qint64> &histogram, qint64 value);
+    qint64 now() const { return customClock ? customClock() : clock.elapsed(); }
+
+    mutable QMutex mutex;
+    Config config;
+    Clock customClock;
+    QElapsedTimer clock;
+    QHash<int, Band> bands; // Номер полосы -> игроки в порядке постановки
+    QHash<PlayerId, Position> positions; // Где стоит игрок, для выхода из очереди за O(1)
+    qint64 matchesMade = 0;
+    QVector<qint64> waits;
+    QVector<qint64> depths;
+};
+
+#endif // MATCHMAKER_H
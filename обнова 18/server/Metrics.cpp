@@ -0,0 +1,154 @@
+#include "Metrics.h"
+#include <chrono>
+
+Metrics::Histogram::Histogram(const QVector<double> &bounds)
+    : bounds(bounds), buckets(new std::atomic<qint64>[bounds.size() + 1])
+{
+    for (int i = 0; i <= bounds.size(); ++i) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    boundsNs.reserve(bounds.size());
+    for (double bound : bounds) {
+        boundsNs.append(qint64(bound * 1e9));
+    }
+}
+
+void Metrics::Histogram::observeNs(qint64 nanoseconds)
+{
+    int bucket = 0;
+    while (bucket < boundsNs.size() && nanoseconds > boundsNs.at(bucket)) {
+        ++bucket;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+QByteArray Metrics::Histogram::render(const QByteArray &name, const QString &labels) const
+{
+    QByteArray text;
+    QByteArray prefix = labels.isEmpty() ? QByteArray() : labels.toUtf8() + ',';
+    qint64 cumulative = 0;
+    for (int i = 0; i <= bounds.size(); ++i) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        QByteArray le = i < bounds.size() ? QByteArray::number(bounds.at(i), 'g', 6) : QByteArray("+Inf");
+        text += name + "_bucket{" + prefix + "le=\"" + le + "\"} " + QByteArray::number(cumulative) + '\n';
+    }
+    QByteArray suffix = labels.isEmpty() ? QByteArray() : '{' + labels.toUtf8() + '}';
+    text += name + "_sum" + suffix + ' ' + QByteArray::number(sumNs.load(std::memory_order_relaxed) / 1e9, 'g', 9) + '\n';
+    text += name + "_count" + suffix + ' ' + QByteArray::number(count.load(std::memory_order_relaxed)) + '\n';
+    return text;
+}
+
+Metrics &Metrics::getInstance()
+{
+    static Metrics instance;
+    return instance;
+}
+
+qint64 Metrics::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+QVector<double> Metrics::latencyBounds()
+{
+    return {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5};
+}
+
+Metrics::Series *Metrics::series(const QString &name, const QString &help, const QString &type, const QString &labels)
+{
+    // Вызывается под блокировкой
+    Family *family = nullptr;
+    for (const std::unique_ptr<Family> &existing : families) {
+        if (existing->name == name) {
+            family = existing.get();
+            break;
+        }
+    }
+    if (!family) {
+        families.push_back(std::make_unique<Family>());
+        family = families.back().get();
+        family->name = name;
+        family->help = help;
+        family->type = type;
+    }
+    for (const std::unique_ptr<Series> &existing : family->series) {
+        if (existing->labels == labels) {
+            return existing.get();
+        }
+    }
+    family->series.push_back(std::make_unique<Series>());
+    family->series.back()->labels = labels;
+    return family->series.back().get();
+}
+
+Metrics::Counter *Metrics::counter(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&mutex);
+    Series *entry = series(name, help, "counter", labels);
+    if (!entry->counter) {
+        entry->counter = std::make_unique<Counter>();
+    }
+    return entry->counter.get();
+}
+
+Metrics::Gauge *Metrics::gauge(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&mutex);
+    Series *entry = series(name, help, "gauge", labels);
+    if (!entry->gauge) {
+        entry->gauge = std::make_unique<Gauge>();
+    }
+    return entry->gauge.get();
+}
+
+Metrics::Histogram *Metrics::histogram(const QString &name, const QString &help, const QString &labels,
+                                       const QVector<double> &bounds)
+{
+    QMutexLocker locker(&mutex);
+    Series *entry = series(name, help, "histogram", labels);
+    if (!entry->histogram) {
+        entry->histogram = std::make_unique<Histogram>(bounds);
+    }
+    return entry->histogram.get();
+}
+
+void Metrics::gauge(const QString &name, const QString &help, std::function<double()> read)
+{
+    QMutexLocker locker(&mutex);
+    series(name, help, "gauge", QString())->read = std::move(read);
+}
+
+QByteArray Metrics::render() const
+{
+    QMutexLocker locker(&mutex);
+    QByteArray text;
+    for (const std::unique_ptr<Family> &family : families) {
+        QByteArray name = family->name.toUtf8();
+        text += "# HELP " + name + ' ' + family->help.toUtf8() + '\n';
+        text += "# TYPE " + name + ' ' + family->type.toUtf8() + '\n';
+        for (const std::unique_ptr<Series> &entry : family->series) {
+            if (entry->histogram) {
+                text += entry->histogram->render(name, entry->labels);
+                continue;
+            }
+            QByteArray value;
+            if (entry->counter) {
+                value = QByteArray::number(entry->counter->value());
+            } else if (entry->gauge) {
+                value = QByteArray::number(entry->gauge->value());
+            } else if (entry->read) {
+                value = QByteArray::number(entry->read(), 'g', 12);
+            } else {
+                continue;
+            }
+            text += name;
+            if (!entry->labels.isEmpty()) {
+                text += '{' + entry->labels.toUtf8() + '}';
+            }
+            text += ' ' + value + '\n';
+        }
+    }
+    return text;
+}
@@ -0,0 +1,100 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Реестр метрик сервера в текстовом формате Prometheus.
+// Метрика регистрируется один раз (под блокировкой) и дальше обновляется через указатель атомарными
+// операциями без блокировок, поэтому её можно трогать из любого потока на горячем пути.
+// Значения, которые и так хранятся в других объектах (число сессий, очередь записи), снимаются
+// функцией в момент запроса /metrics.
+class Metrics
+{
+public:
+    class Counter
+    {
+    public:
+        void add(qint64 value = 1) { count.fetch_add(value, std::memory_order_relaxed); }
+        qint64 value() const { return count.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<qint64> count{0};
+    };
+
+    class Gauge
+    {
+    public:
+        void set(qint64 value) { current.store(value, std::memory_order_relaxed); }
+        void add(qint64 value = 1) { current.fetch_add(value, std::memory_order_relaxed); }
+        qint64 value() const { return current.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<qint64> current{0};
+    };
+
+    // Гистограмма длительностей: границы корзин в секундах, наблюдения в наносекундах
+    class Histogram
+    {
+    public:
+        explicit Histogram(const QVector<double> &bounds);
+
+        void observeNs(qint64 nanoseconds);
+        QByteArray render(const QByteArray &name, const QString &labels) const;
+
+    private:
+        QVector<double> bounds;
+        QVector<qint64> boundsNs;
+        std::unique_ptr<std::atomic<qint64>[]> buckets; // Не накопительные, последняя - выше всех границ
+        std::atomic<qint64> count{0};
+        std::atomic<qint64> sumNs{0};
+    };
+
+    static Metrics &getInstance();
+    static qint64 nowNs(); // Монотонное время для измерения задержек
+    static QVector<double> latencyBounds(); // От 50 мкс до 2.5 с
+
+    // labels - готовая строка меток вида type="make_move"; повторная регистрация возвращает ту же метрику
+    Counter *counter(const QString &name, const QString &help, const QString &labels = QString());
+    Gauge *gauge(const QString &name, const QString &help, const QString &labels = QString());
+    Histogram *histogram(const QString &name, const QString &help, const QString &labels = QString(),
+                         const QVector<double> &bounds = latencyBounds());
+    void gauge(const QString &name, const QString &help, std::function<double()> read);
+
+    QByteArray render() const;
+
+private:
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics &operator=(const Metrics&) = delete;
+
+    struct Series
+    {
+        QString labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> read;
+    };
+
+    struct Family
+    {
+        QString name;
+        QString help;
+        QString type; // counter, gauge, histogram
+        std::vector<std::unique_ptr<Series>> series;
+    };
+
+    Series *series(const QString &name, const QString &help, const QString &type, const QString &labels);
+
+    mutable QMutex mutex;
+    std::vector<std::unique_ptr<Family>> families; // В порядке регистрации
+};
+
+#endif // METRICS_H
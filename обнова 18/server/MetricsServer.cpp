@@ -0,0 +1,108 @@
+#include "MetricsServer.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include <QTcpSocket>
+
+MetricsServer::MetricsServer(QObject *parent) : QTcpServer(parent)
+{
+    connect(this, &QTcpServer::newConnection, this, &MetricsServer::slotNewConnection);
+}
+
+bool MetricsServer::start(quint16 port)
+{
+    if (!listen(QHostAddress::LocalHost, port)) {
+        LOG_WARNING("Metrics endpoint is NOT started on port %1: %2", port, errorString());
+        return false;
+    }
+    LOG_INFO("Metrics endpoint is started on http://127.0.0.1:%1/metrics", port);
+    return true;
+}
+
+void MetricsServer::slotNewConnection()
+{
+    while (QTcpSocket *socket = nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, &MetricsServer::slotRead);
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void MetricsServer::slotRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+    // Заголовки запроса копятся в свойстве сокета, пока не придёт пустая строка
+    QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+    int headerEnd = request.indexOf("\r\n\r\n");
+    if (headerEnd == -1) {
+        if (request.size() > MaxRequestSize) {
+            reply(socket, "431 Request Header Fields Too Large", "text/plain", "Request too large\n");
+        } else {
+            socket->setProperty("request", request);
+        }
+        return;
+    }
+
+    // Тело нужно только PUT /log-level; ждём его целиком по Content-Length
+    qsizetype contentLength = 0;
+    const QList<QByteArray> headers = request.left(headerEnd).split('\n');
+    for (const QByteArray &header : headers) {
+        if (header.toLower().startsWith("content-length:")) {
+            contentLength = header.mid(header.indexOf(':') + 1).trimmed().toLongLong();
+        }
+    }
+    if (contentLength < 0 || contentLength > MaxRequestSize) {
+        reply(socket, "413 Payload Too Large", "text/plain", "Request too large\n");
+        return;
+    }
+    if (request.size() < headerEnd + 4 + contentLength) {
+        socket->setProperty("request", request);
+        return;
+    }
+    QByteArray body = request.mid(headerEnd + 4, contentLength);
+
+    QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+    if (requestLine.size() >= 2 && requestLine.at(1) == "/log-level") {
+        handleLogLevel(socket, requestLine.at(0), body);
+    } else if (requestLine.size() < 2 || requestLine.at(0) != "GET") {
+        reply(socket, "405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+    } else if (requestLine.at(1) == "/metrics") {
+        reply(socket, "200 OK", "text/plain; version=0.0.4; charset=utf-8", Metrics::getInstance().render());
+    } else if (requestLine.at(1) == "/trace") {
+        reply(socket, "200 OK", "application/json", Tracer::getInstance().exportJson(true));
+    } else {
+        reply(socket, "404 Not Found", "text/plain", "Not found\n");
+    }
+}
+
+void MetricsServer::handleLogLevel(QTcpSocket *socket, const QByteArray &method, const QByteArray &body)
+{
+    if (method == "GET") {
+        reply(socket, "200 OK", "text/plain", QByteArray(Logger::levelName(Logger::getLevel())) + '\n');
+        return;
+    }
+    if (method != "PUT") {
+        reply(socket, "405 Method Not Allowed", "text/plain", "Only GET and PUT are supported\n");
+        return;
+    }
+    Logger::Level level;
+    if (!Logger::parseLevel(QString::fromUtf8(body.trimmed()), level)) {
+        reply(socket, "400 Bad Request", "text/plain", "Expected trace, debug, info, warning, error or off\n");
+        return;
+    }
+    Logger::setLevel(level);
+    LOG_INFO("Log level is set to %1", Logger::levelName(level));
+    reply(socket, "200 OK", "text/plain", QByteArray(Logger::levelName(level)) + '\n');
+}
+
+void MetricsServer::reply(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body)
+{
+    QByteArray response = "HTTP/1.1 " + status + "\r\n"
+                          "Content-Type: " + contentType + "\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body;
+    socket->write(response);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,32 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QTcpServer>
+
+class QTcpSocket;
+
+// Минимальный HTTP-сервер для сборщика метрик: GET /metrics отдаёт Metrics::render(), остальное - 404.
+// GET /trace отдаёт накопленные участки Tracer в формате Chrome trace events и начинает накопление заново.
+// GET /log-level возвращает текущий уровень журнала, PUT /log-level с телом "debug" и т.п. меняет его на ходу.
+// Слушает только локальный интерфейс на отдельном порту и живёт в главном потоке, не мешая воркерам.
+class MetricsServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(QObject *parent = nullptr);
+
+    bool start(quint16 port);
+
+private slots:
+    void slotNewConnection();
+    void slotRead();
+
+private:
+    static const int MaxRequestSize = 8192;
+
+    void handleLogLevel(QTcpSocket *socket, const QByteArray &method, const QByteArray &body);
+    void reply(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body);
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,61 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Неблокирующая очередь "много производителей - один потребитель" (алгоритм Вьюкова).
+// push() можно вызывать из любых потоков, pop() - только из одного потока-потребителя.
+template<typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+    {
+        Node *stub = new Node();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value)) {
+        }
+        delete tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value)
+    {
+        Node *node = new Node();
+        node->value = std::move(value);
+        Node *prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T &value)
+    {
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        delete tail;
+        tail = next; // Узел next становится новой заглушкой
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node*> head; // Последний добавленный узел (общий для производителей)
+    Node *tail; // Заглушка перед первым непрочитанным узлом (только потребитель)
+};
+
+#endif // MPSCQUEUE_H
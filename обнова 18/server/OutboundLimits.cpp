@@ -0,0 +1,27 @@
+#include "OutboundLimits.h"
+#include <QStringList>
+
+bool OutboundLimits::parsePolicies(const QString &spec)
+{
+    const QStringList entries = spec.split(',', Qt::SkipEmptyParts);
+    for (const QString &entry : entries) {
+        QStringList pair = entry.trimmed().split('=');
+        if (pair.size() != 2) {
+            return false;
+        }
+
+        MessageClass messageClass;
+        const QString name = pair.at(0).trimmed();
+        if (name == "essential") messageClass = Essential;
+        else if (name == "state") messageClass = LatestState;
+        else if (name == "best_effort") messageClass = BestEffort;
+        else return false;
+
+        const QString policy = pair.at(1).trimmed();
+        if (policy == "disconnect") policies[messageClass] = Disconnect;
+        else if (policy == "coalesce") policies[messageClass] = CoalesceLatest;
+        else if (policy == "drop") policies[messageClass] = Drop;
+        else return false;
+    }
+    return true;
+}
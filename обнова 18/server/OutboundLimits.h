@@ -0,0 +1,53 @@
+#ifndef OUTBOUNDLIMITS_H
+#define OUTBOUNDLIMITS_H
+
+#include <QString>
+
+// Ограничения исходящего трафика одного соединения: медленный клиент не должен раздувать память сервера.
+// Соединение перегружено, когда неотправленные данные (outbox и буфер сокета) превысили highWatermark,
+// и снова свободно, когда их стало меньше lowWatermark. Пока соединение перегружено, новое сообщение
+// обрабатывается по политике своего класса.
+struct OutboundLimits
+{
+    enum MessageClass {
+        Essential, // Ответы на запросы и игровые события
+        LatestState, // Снимки состояния (stats): важен только последний
+        BestEffort, // Ошибки разбора и прочие необязательные сообщения
+        MessageClassCount
+    };
+
+    enum Policy {
+        Disconnect, // Отключить клиента, не успевающего читать
+        CoalesceLatest, // Хранить только последнее сообщение и отправить его после разгрузки
+        Drop // Выбросить сообщение
+    };
+
+    qint64 highWatermark = 1024 * 1024;
+    qint64 lowWatermark = 256 * 1024;
+    Policy policies[MessageClassCount] = {Disconnect, CoalesceLatest, Drop};
+
+    // Разбор строки вида "essential=disconnect,state=coalesce,best_effort=drop"; false при ошибке
+    bool parsePolicies(const QString &spec);
+};
+
+// Счётчики исходящего трафика (суммируются по воркерам)
+struct OutboundStats
+{
+    qint64 messagesSent = 0;
+    qint64 socketWrites = 0;
+    qint64 dropped = 0;
+    qint64 coalesced = 0;
+    qint64 slowDisconnects = 0;
+
+    OutboundStats &operator+=(const OutboundStats &other)
+    {
+        messagesSent += other.messagesSent;
+        socketWrites += other.socketWrites;
+        dropped += other.dropped;
+        coalesced += other.coalesced;
+        slowDisconnects += other.slowDisconnects;
+        return *this;
+    }
+};
+
+#endif // OUTBOUNDLIMITS_H
@@ -0,0 +1,284 @@
+#include "PersistenceWorker.h"
+#include "BoardBlob.h"
+#include "ConnectionPool.h"
+#include "Logger.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+
+static const char *PersistenceConnectionName = "persistence";
+
+PersistenceWorker::PersistenceWorker(const QString &databaseName, QObject *parent)
+    : QThread(parent), databaseName(databaseName)
+{
+    transactionLatency = Metrics::getInstance().histogram("seabattle_db_transaction_duration_seconds",
+                                                          "Time to write and commit one background DB batch.");
+}
+
+PersistenceWorker::~PersistenceWorker()
+{
+    stop();
+}
+
+void PersistenceWorker::enqueue(PersistenceOp op)
+{
+    if (stopped.load(std::memory_order_acquire)) {
+        LOG_WARNING("Persistence worker is stopped, writing game %1 synchronously", op.gameId);
+        pending.fetch_add(1, std::memory_order_relaxed);
+        writeNow(QVector<PersistenceOp>{std::move(op)});
+        return;
+    }
+    pending.fetch_add(1, std::memory_order_relaxed);
+    queue.push(std::move(op));
+    wakeup.release();
+}
+
+void PersistenceWorker::configure(int maxBatchSize, int maxDelayMs)
+{
+    this->maxBatchSize.store(qMax(1, maxBatchSize), std::memory_order_relaxed);
+    this->maxDelayMs.store(qMax(0, maxDelayMs), std::memory_order_relaxed);
+}
+
+void PersistenceWorker::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+    stopping.store(true, std::memory_order_release);
+    wakeup.release();
+    wait();
+    stopped.store(true, std::memory_order_release);
+
+    // Операции, поставленные между последней пачкой потока и флагом stopped, дописываем здесь
+    QVector<PersistenceOp> rest;
+    PersistenceOp op;
+    while (queue.pop(op)) {
+        rest.append(std::move(op));
+    }
+    if (!rest.isEmpty()) {
+        writeNow(rest);
+    }
+    LOG_INFO("Persistence worker stopped, pending writes: %1", pendingWrites());
+}
+
+void PersistenceWorker::writeNow(const QVector<PersistenceOp> &batch)
+{
+    // Соединение SQLite привязано к потоку, поэтому открывается на время записи в потоке вызывающего
+    QMutexLocker locker(&syncMutex);
+    QString connectionName = QString("%1_sync").arg(PersistenceConnectionName);
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        database.setDatabaseName(databaseName);
+        database.setConnectOptions(ConnectionPool::connectOptions(databaseName));
+        if (!database.open()) {
+            LOG_ERROR("Failed to open DB for synchronous persistence: %1", database.lastError().text());
+        }
+        {
+            Statements statements(database);
+            writeBatch(database, statements, batch);
+        }
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+int PersistenceWorker::drain(QVector<PersistenceOp> &batch)
+{
+    int limit = maxBatchSize.load(std::memory_order_relaxed);
+    int taken = 0;
+    PersistenceOp op;
+    while (batch.size() < limit && queue.pop(op)) {
+        batch.append(std::move(op));
+        ++taken;
+    }
+    return taken;
+}
+
+PersistenceWorker::Statements::Statements(const QSqlDatabase &database)
+    : ship(database), move(database), turn(database),
+      fleetBlob(database), shotBlob(database), selectFleetBlob(database)
+{
+    ship.prepare("INSERT INTO Ship (game_id, player_id, x, y, size, is_horizontal) VALUES (:game_id, :player_id, :x, :y, :size, :is_horizontal)");
+    move.prepare("INSERT INTO Move (game_id, player_id, x, y, result) VALUES (:game_id, :player_id, :x, :y, :result)");
+    turn.prepare("UPDATE Game SET current_turn_id = :current_turn_id WHERE game_id = :game_id");
+    fleetBlob.prepare("INSERT INTO PlayerBoard (game_id, player_id, fleet) VALUES (:game_id, :player_id, :fleet) "
+                      "ON CONFLICT (game_id, player_id) DO UPDATE SET fleet = excluded.fleet");
+    // Выстрел дописывается в конец списка выстрелов игрока. Оператор || в SQLite возвращает TEXT,
+    // поэтому результат приводится к BLOB: иначе length() и substr() считали бы символы, а не байты
+    shotBlob.prepare("INSERT INTO PlayerBoard (game_id, player_id, shots) VALUES (:game_id, :player_id, :shot) "
+                     "ON CONFLICT (game_id, player_id) DO UPDATE SET shots = CAST(shots || excluded.shots AS BLOB)");
+    selectFleetBlob.prepare("SELECT fleet FROM PlayerBoard WHERE game_id = :game_id AND player_id = :player_id");
+}
+
+void PersistenceWorker::run()
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", PersistenceConnectionName);
+        database.setDatabaseName(databaseName);
+        database.setConnectOptions(ConnectionPool::connectOptions(databaseName));
+        if (!database.open()) {
+            LOG_ERROR("Persistence worker failed to open DB: %1", database.lastError().text());
+        }
+
+        {
+            Statements statements(database); // Освобождаются до закрытия соединения
+            QVector<PersistenceOp> batch;
+            batch.reserve(maxBatchSize.load(std::memory_order_relaxed));
+            for (;;) {
+                wakeup.acquire();
+                wakeup.tryAcquire(wakeup.available()); // Одно пробуждение обрабатывает все накопленные операции
+
+                drain(batch);
+                if (batch.isEmpty()) {
+                    if (stopping.load(std::memory_order_acquire)) {
+                        break;
+                    }
+                    continue;
+                }
+
+                // Добираем пачку, пока она не заполнится или не истечёт допустимая задержка
+                QElapsedTimer timer;
+                timer.start();
+                int delay = maxDelayMs.load(std::memory_order_relaxed);
+                while (batch.size() < maxBatchSize.load(std::memory_order_relaxed) &&
+                       !stopping.load(std::memory_order_acquire) && timer.elapsed() < delay) {
+                    if (wakeup.tryAcquire(1, int(delay - timer.elapsed()))) {
+                        drain(batch);
+                    }
+                }
+
+                writeBatch(database, statements, batch);
+                batch.clear();
+
+                if (stopping.load(std::memory_order_acquire)) {
+                    wakeup.release(); // Дописываем остаток очереди перед выходом
+                }
+            }
+        }
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(PersistenceConnectionName);
+}
+
+void PersistenceWorker::writeBatch(QSqlDatabase &database, Statements &statements, const QVector<PersistenceOp> &batch)
+{
+    if (!database.isOpen()) {
+        LOG_WARNING("Persistence DB is not open, dropping %1 writes", batch.size());
+        pending.fetch_sub(batch.size(), std::memory_order_relaxed);
+        return;
+    }
+
+    qint64 startedNs = Metrics::nowNs();
+    if (!database.transaction()) {
+        LOG_WARNING("Failed to start persistence transaction: %1", database.lastError().text());
+    }
+
+    bool blobs = getLayout() == BlobLayout;
+    for (const PersistenceOp &op : batch) {
+        bool written = (blobs && op.kind != PersistenceOp::UpdateTurn) ? writeBlob(statements, op) : writeRow(statements, op);
+        if (!written) {
+            LOG_WARNING("Persistence write failed for game %1", op.gameId);
+        }
+    }
+
+    if (!database.commit()) {
+        LOG_WARNING("Failed to commit persistence batch: %1", database.lastError().text());
+        database.rollback();
+    }
+    transactionLatency->observeNs(Metrics::nowNs() - startedNs);
+    pending.fetch_sub(batch.size(), std::memory_order_relaxed);
+    batches.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool PersistenceWorker::writeRow(Statements &statements, const PersistenceOp &op)
+{
+    QSqlQuery *query = nullptr;
+    switch (op.kind) {
+    case PersistenceOp::SaveShip:
+        query = &statements.ship;
+        query->bindValue(":game_id", op.gameId);
+        query->bindValue(":player_id", op.playerId);
+        query->bindValue(":x", op.x);
+        query->bindValue(":y", op.y);
+        query->bindValue(":size", op.size);
+        query->bindValue(":is_horizontal", op.isHorizontal ? 1 : 0);
+        break;
+    case PersistenceOp::SaveFleet:
+        for (const ShipPlacement &ship : op.ships) {
+            statements.ship.bindValue(":game_id", op.gameId);
+            statements.ship.bindValue(":player_id", op.playerId);
+            statements.ship.bindValue(":x", ship.x);
+            statements.ship.bindValue(":y", ship.y);
+            statements.ship.bindValue(":size", ship.size);
+            statements.ship.bindValue(":is_horizontal", ship.isHorizontal ? 1 : 0);
+            if (!statements.ship.exec()) {
+                LOG_WARNING("Failed to save ship: %1", statements.ship.lastError().text());
+                return false;
+            }
+        }
+        return true;
+    case PersistenceOp::SaveMove:
+        query = &statements.move;
+        query->bindValue(":game_id", op.gameId);
+        query->bindValue(":player_id", op.playerId);
+        query->bindValue(":x", op.x);
+        query->bindValue(":y", op.y);
+        query->bindValue(":result", op.result);
+        break;
+    case PersistenceOp::UpdateTurn:
+        query = &statements.turn;
+        query->bindValue(":current_turn_id", op.playerId);
+        query->bindValue(":game_id", op.gameId);
+        break;
+    }
+    if (!query->exec()) {
+        LOG_WARNING("Failed to write row: %1", query->lastError().text());
+        return false;
+    }
+    return true;
+}
+
+bool PersistenceWorker::writeBlob(Statements &statements, const PersistenceOp &op)
+{
+    QSqlQuery *query = nullptr;
+    switch (op.kind) {
+    case PersistenceOp::SaveShip: {
+        // Одиночный корабль дописывается к уже сохранённому флоту
+        QVector<ShipPlacement> ships;
+        QSqlQuery &select = statements.selectFleetBlob;
+        select.bindValue(":game_id", op.gameId);
+        select.bindValue(":player_id", op.playerId);
+        if (select.exec() && select.next()) {
+            BoardBlob::decodeFleet(select.value(0).toByteArray(), ships);
+        }
+        select.finish();
+        ships.append(ShipPlacement{op.x, op.y, op.size, op.isHorizontal});
+
+        query = &statements.fleetBlob;
+        query->bindValue(":game_id", op.gameId);
+        query->bindValue(":player_id", op.playerId);
+        query->bindValue(":fleet", BoardBlob::encodeFleet(ships));
+        break;
+    }
+    case PersistenceOp::SaveFleet:
+        query = &statements.fleetBlob;
+        query->bindValue(":game_id", op.gameId);
+        query->bindValue(":player_id", op.playerId);
+        query->bindValue(":fleet", BoardBlob::encodeFleet(op.ships));
+        break;
+    case PersistenceOp::SaveMove:
+        query = &statements.shotBlob;
+        query->bindValue(":game_id", op.gameId);
+        query->bindValue(":player_id", op.playerId);
+        query->bindValue(":shot", BoardBlob::encodeShot(op.x, op.y, op.result));
+        break;
+    case PersistenceOp::UpdateTurn:
+        return writeRow(statements, op);
+    }
+    if (!query->exec()) {
+        LOG_WARNING("Failed to write board blob: %1", query->lastError().text());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef PERSISTENCEWORKER_H
+#define PERSISTENCEWORKER_H
+
+#include <QThread>
+#include <QSemaphore>
+#include <QMutex>
+#include "Metrics.h"
+#include <QSqlQuery>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "MpscQueue.h"
+#include "GameBoard.h"
+#include "PlayerRegistry.h"
+
+// Операция записи в БД, выполняемая в фоне
+struct PersistenceOp
+{
+    enum Kind {
+        SaveShip,
+        SaveFleet,
+        SaveMove,
+        UpdateTurn
+    };
+
+    Kind kind = SaveMove;
+    int gameId = -1;
+    PlayerId playerId = NoPlayer; // Владелец корабля, автор хода или игрок, чей теперь ход
+    int x = 0;
+    int y = 0;
+    int size = 0;
+    bool isHorizontal = false;
+    QString result;
+    QVector<ShipPlacement> ships; // Для SaveFleet: весь флот пишется в одной транзакции
+};
+
+// Поток отложенной записи: операции копятся в неблокирующей очереди и
+// записываются пачками в одной транзакции на собственном соединении с БД
+class PersistenceWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    // Как хранятся расстановка и ходы
+    enum Layout {
+        RowLayout, // Строка на каждый корабль (Ship) и каждый выстрел (Move)
+        BlobLayout // Одна строка PlayerBoard на игрока: флот и выстрелы в двоичном виде
+    };
+
+    PersistenceWorker(const QString &databaseName, QObject *parent = nullptr);
+    ~PersistenceWorker();
+
+    void enqueue(PersistenceOp op); // После stop() пишет сразу, в потоке вызывающего
+    void configure(int maxBatchSize, int maxDelayMs);
+    void setLayout(Layout layout) { this->layout.store(layout, std::memory_order_relaxed); }
+    Layout getLayout() const { return Layout(layout.load(std::memory_order_relaxed)); }
+    void stop(); // Дописывает всё накопленное и завершает поток
+
+    int pendingWrites() const { return pending.load(std::memory_order_relaxed); }
+    qint64 committedBatches() const { return batches.load(std::memory_order_relaxed); }
+
+protected:
+    void run() override;
+
+private:
+    // Запросы соединения потока записи: подготавливаются один раз при запуске
+    struct Statements
+    {
+        explicit Statements(const QSqlDatabase &database);
+
+        QSqlQuery ship;
+        QSqlQuery move;
+        QSqlQuery turn;
+        QSqlQuery fleetBlob;
+        QSqlQuery shotBlob;
+        QSqlQuery selectFleetBlob;
+    };
+
+    int drain(QVector<PersistenceOp> &batch);
+    void writeNow(const QVector<PersistenceOp> &batch);
+    void writeBatch(QSqlDatabase &database, Statements &statements, const QVector<PersistenceOp> &batch);
+    bool writeRow(Statements &statements, const PersistenceOp &op);
+    bool writeBlob(Statements &statements, const PersistenceOp &op);
+
+    QString databaseName;
+    MpscQueue<PersistenceOp> queue;
+    QSemaphore wakeup; // Сигнал потоку о новых операциях
+    std::atomic<int> pending{0}; // Поставлено в очередь, но ещё не зафиксировано
+    std::atomic<qint64> batches{0};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> stopped{false}; // Поток завершён, очередь больше никто не читает
+    QMutex syncMutex; // Синхронные записи после остановки идут по одной
+    std::atomic<int> maxBatchSize{256};
+    std::atomic<int> maxDelayMs{20};
+    std::atomic<int> layout{RowLayout};
+    Metrics::Histogram *transactionLatency; // Длительность одной пакетной транзакции
+};
+
+#endif // PERSISTENCEWORKER_H
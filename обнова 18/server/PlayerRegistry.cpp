@@ -0,0 +1,26 @@
+#include "PlayerRegistry.h"
+
+PlayerId PlayerRegistry::find(const QString &nickname) const
+{
+    QReadLocker locker(&lock);
+    return ids.value(nickname, NoPlayer);
+}
+
+QString PlayerRegistry::name(PlayerId id) const
+{
+    QReadLocker locker(&lock);
+    return names.value(id);
+}
+
+void PlayerRegistry::insert(PlayerId id, const QString &nickname)
+{
+    QWriteLocker locker(&lock);
+    ids.insert(nickname, id);
+    names.insert(id, nickname);
+}
+
+int PlayerRegistry::size() const
+{
+    QReadLocker locker(&lock);
+    return ids.size();
+}
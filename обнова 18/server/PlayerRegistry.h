@@ -0,0 +1,28 @@
+#ifndef PLAYERREGISTRY_H
+#define PLAYERREGISTRY_H
+
+#include <QHash>
+#include <QString>
+#include <QReadWriteLock>
+
+// Внутренний идентификатор игрока (player_id таблицы Player), 0 - игрок не известен
+typedef quint32 PlayerId;
+static const PlayerId NoPlayer = 0;
+
+// Интернированные никнеймы: имя превращается в PlayerId при входе, дальше сервер
+// работает только с числами, а имя нужно лишь при формировании ответа клиенту
+class PlayerRegistry
+{
+public:
+    PlayerId find(const QString &nickname) const;
+    QString name(PlayerId id) const;
+    void insert(PlayerId id, const QString &nickname);
+    int size() const;
+
+private:
+    mutable QReadWriteLock lock; // Читают все потоки, пишут только при входе нового игрока
+    QHash<QString, PlayerId> ids;
+    QHash<PlayerId, QString> names;
+};
+
+#endif // PLAYERREGISTRY_H
@@ -0,0 +1,178 @@
+#include "Request.h"
+#include "WireProtocol.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+static Request::Type typeFromString(const QString &type)
+{
+    if (type == "make_move") return Request::MakeMove;
+    if (type == "place_ship") return Request::PlaceShip;
+    if (type == "place_fleet") return Request::PlaceFleet;
+    if (type == "ready_to_battle") return Request::ReadyToBattle;
+    if (type == "start_game") return Request::StartGame;
+    if (type == "login") return Request::Login;
+    if (type == "register") return Request::Register;
+    if (type == "stats") return Request::Stats;
+    if (type == "hello") return Request::Hello;
+    if (type == "resume") return Request::Resume;
+    return Request::Unknown;
+}
+
+const char *Request::typeLabel(Type type)
+{
+    switch (type) {
+    case MakeMove: return "make_move";
+    case PlaceShip: return "place_ship";
+    case PlaceFleet: return "place_fleet";
+    case ReadyToBattle: return "ready_to_battle";
+    case StartGame: return "start_game";
+    case Login: return "login";
+    case Register: return "register";
+    case Stats: return "stats";
+    case Hello: return "hello";
+    case Resume: return "resume";
+    case Unknown:
+    case TypeCount:
+        break;
+    }
+    return "unknown";
+}
+
+bool Request::decode(const QByteArray &data, Request &request, QString &error)
+{
+    QJsonDocument doc = QJsonDocument::fromJson(data);
+    if (!doc.isObject()) {
+        error = "Invalid JSON format";
+        return false;
+    }
+
+    const QJsonObject jsonObj = doc.object();
+    QJsonObject::const_iterator it = jsonObj.constFind(QLatin1String("type"));
+    if (it == jsonObj.constEnd()) {
+        error = "Missing type field";
+        return false;
+    }
+    request.typeName = it.value().toString();
+    request.type = typeFromString(request.typeName);
+
+    if ((it = jsonObj.constFind(QLatin1String("nickname"))) != jsonObj.constEnd()) {
+        request.nickname = it.value().toString();
+        request.fields |= NicknameField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("email"))) != jsonObj.constEnd()) {
+        request.email = it.value().toString();
+        request.fields |= EmailField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("password"))) != jsonObj.constEnd()) {
+        request.password = it.value().toString();
+        request.fields |= PasswordField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("game_id"))) != jsonObj.constEnd()) {
+        request.gameId = it.value().toInt();
+        request.fields |= GameIdField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("x"))) != jsonObj.constEnd()) {
+        request.x = it.value().toInt();
+        request.fields |= XField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("y"))) != jsonObj.constEnd()) {
+        request.y = it.value().toInt();
+        request.fields |= YField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("size"))) != jsonObj.constEnd()) {
+        request.size = it.value().toInt();
+        request.fields |= SizeField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("is_horizontal"))) != jsonObj.constEnd()) {
+        request.isHorizontal = it.value().toBool();
+        request.fields |= IsHorizontalField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("protocol"))) != jsonObj.constEnd()) {
+        request.protocol = it.value().toString();
+        request.fields |= ProtocolField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("rating"))) != jsonObj.constEnd()) {
+        request.rating = it.value().toInt();
+        request.fields |= RatingField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("token"))) != jsonObj.constEnd()) {
+        request.token = it.value().toString();
+        request.fields |= TokenField;
+    }
+    if ((it = jsonObj.constFind(QLatin1String("ships"))) != jsonObj.constEnd() && it.value().isArray()) {
+        const QJsonArray ships = it.value().toArray();
+        request.ships.reserve(ships.size());
+        for (const QJsonValue &value : ships) {
+            const QJsonObject shipObj = value.toObject();
+            ShipPlacement ship;
+            ship.x = shipObj.value(QLatin1String("x")).toInt(-1);
+            ship.y = shipObj.value(QLatin1String("y")).toInt(-1);
+            ship.size = shipObj.value(QLatin1String("size")).toInt();
+            ship.isHorizontal = shipObj.value(QLatin1String("is_horizontal")).toBool();
+            request.ships.append(ship);
+        }
+        request.fields |= ShipsField;
+    }
+    return true;
+}
+
+bool Request::decodeBinary(QByteArrayView payload, Request &request, QString &error)
+{
+    if (payload.isEmpty()) {
+        error = "Empty binary message";
+        return false;
+    }
+
+    // Разбор фиксированных раскладок не выделяет память: строки остаются пустыми
+    bool valid = true;
+    switch (WireProtocol::opcode(payload)) {
+    case WireProtocol::JsonMessage: {
+        QByteArrayView json = WireProtocol::json(payload);
+        return decode(QByteArray::fromRawData(json.data(), json.size()), request, error);
+    }
+    case WireProtocol::StartGameMessage:
+        request.type = StartGame;
+        request.typeName = QStringLiteral("start_game");
+        valid = payload.size() == 1;
+        break;
+    case WireProtocol::PlaceShipMessage: {
+        ShipPlacement ship;
+        request.type = PlaceShip;
+        request.typeName = QStringLiteral("place_ship");
+        valid = WireProtocol::decodePlaceShip(payload, request.gameId, ship);
+        request.x = ship.x;
+        request.y = ship.y;
+        request.size = ship.size;
+        request.isHorizontal = ship.isHorizontal;
+        request.fields |= GameIdField | XField | YField | SizeField | IsHorizontalField;
+        break;
+    }
+    case WireProtocol::ReadyToBattleMessage:
+        request.type = ReadyToBattle;
+        request.typeName = QStringLiteral("ready_to_battle");
+        valid = WireProtocol::decodeGameId(payload, request.gameId);
+        request.fields |= GameIdField;
+        break;
+    case WireProtocol::MakeMoveMessage: {
+        WireProtocol::Move move;
+        request.type = MakeMove;
+        request.typeName = QStringLiteral("make_move");
+        valid = WireProtocol::decodeMove(payload, move);
+        request.gameId = move.gameId;
+        request.x = move.x;
+        request.y = move.y;
+        request.fields |= GameIdField | XField | YField;
+        break;
+    }
+    default:
+        error = "Unknown binary message";
+        return false;
+    }
+
+    if (!valid) {
+        error = "Malformed binary message";
+        return false;
+    }
+    return true;
+}
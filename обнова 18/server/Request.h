@@ -0,0 +1,75 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QVector>
+#include "GameBoard.h"
+#include "PlayerRegistry.h"
+
+// Запрос клиента, разобранный из JSON один раз и передаваемый обработчикам по ссылке
+struct Request
+{
+    enum Type {
+        Unknown,
+        Register,
+        Login,
+        StartGame,
+        PlaceShip,
+        PlaceFleet,
+        ReadyToBattle,
+        MakeMove,
+        Stats,
+        Hello,
+        Resume,
+        TypeCount
+    };
+
+    // Флаги присутствия полей в исходном сообщении
+    enum Field {
+        NicknameField = 1 << 0,
+        EmailField = 1 << 1,
+        PasswordField = 1 << 2,
+        GameIdField = 1 << 3,
+        XField = 1 << 4,
+        YField = 1 << 5,
+        SizeField = 1 << 6,
+        IsHorizontalField = 1 << 7,
+        ShipsField = 1 << 8,
+        ProtocolField = 1 << 9,
+        RatingField = 1 << 10,
+        TokenField = 1 << 11
+    };
+
+    Type type = Unknown;
+    QString typeName; // Исходное значение поля "type"
+    int fields = 0;
+
+    QString nickname;
+    PlayerId playerId = NoPlayer; // Заполняет сервер по никнейму, обработчики работают только с ним
+    QString email;
+    QString password;
+    int gameId = -1;
+    int x = 0;
+    int y = 0;
+    int size = 0;
+    bool isHorizontal = false;
+    QVector<ShipPlacement> ships; // Весь флот для place_fleet
+    QString protocol; // Протокол, предложенный в hello
+    int rating = 0; // Рейтинг для подбора соперника в start_game
+    QString token; // Токен возобновления сессии из ответа на login
+    qint64 receivedNs = 0; // Metrics::nowNs() в момент разбора кадра, для гистограмм задержки
+    quint64 traceId = 0; // Номер трассы Tracer, 0 - запрос не трассируется
+    bool binaryReplies = false; // Соединение перешло на двоичный протокол: частые ответы кодируются WireProtocol
+
+    bool has(int requiredFields) const { return (fields & requiredFields) == requiredFields; }
+    static const char *typeLabel(Type type); // Имя типа для метрик: неизвестные типы сводятся к "unknown"
+
+    // Разбирает одно сообщение; при ошибке заполняет error текстом для ответа клиенту
+    static bool decode(const QByteArray &data, Request &request, QString &error);
+    // То же для двоичного кадра WireProtocol
+    static bool decodeBinary(QByteArrayView payload, Request &request, QString &error);
+};
+
+#endif // REQUEST_H
@@ -0,0 +1,224 @@
+#include "SchemaMigrator.h"
+#include "BoardBlob.h"
+#include "Logger.h"
+#include <QSqlQuery>
+#include <QSqlError>
+
+// Представления раскладывают BLOB-столбцы PlayerBoard обратно в строки в формате Ship и Move.
+// players - столбцы игрока в результате, source - источник строк PlayerBoard под псевдонимом b
+static QString shipBlobView(const QString &players, const QString &source)
+{
+    QString cell = BoardBlob::sqlByteAt("b.fleet", "16 + slot.n * 2");
+    QString size = BoardBlob::sqlByteAt("b.fleet", "17 + slot.n * 2");
+    return QString("CREATE VIEW IF NOT EXISTS ShipBlobView AS "
+                   "WITH RECURSIVE slot(n) AS (SELECT 0 UNION ALL SELECT n + 1 FROM slot WHERE n < 9) "
+                   "SELECT b.game_id, %3, slot.n AS ship_no, "
+                   "%1 % 10 AS x, %1 / 10 AS y, %2 % 128 AS size, %2 / 128 AS is_horizontal "
+                   "FROM %4 JOIN slot "
+                   "WHERE b.fleet IS NOT NULL AND %2 % 128 > 0").arg(cell, size, players, source);
+}
+
+static QString moveBlobView(const QString &players, const QString &source)
+{
+    QString cell = BoardBlob::sqlByteAt("b.shots", "shot.n * 2");
+    QString code = BoardBlob::sqlByteAt("b.shots", "shot.n * 2 + 1");
+    return QString("CREATE VIEW IF NOT EXISTS MoveBlobView AS "
+                   "WITH RECURSIVE shot(n) AS (SELECT 0 UNION ALL SELECT n + 1 FROM shot WHERE n < 99) "
+                   "SELECT b.game_id, %3, shot.n + 1 AS move_no, %1 % 10 AS x, %1 / 10 AS y, "
+                   "CASE %2 WHEN 1 THEN 'hit' WHEN 2 THEN 'sunk' ELSE 'miss' END AS result "
+                   "FROM %4 JOIN shot ON shot.n * 2 < length(b.shots)").arg(cell, code, players, source);
+}
+
+const QVector<Migration> &SchemaMigrator::migrations()
+{
+    static const QVector<Migration> steps = {
+        {1, "Initial game tables", {
+             "CREATE TABLE IF NOT EXISTS User ("
+             "nickname TEXT PRIMARY KEY, "
+             "email TEXT NOT NULL UNIQUE, "
+             "password TEXT NOT NULL, "
+             "connection_info TEXT)",
+             "CREATE TABLE IF NOT EXISTS Game ("
+             "game_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "player1 TEXT NOT NULL, "
+             "player2 TEXT NOT NULL, "
+             "current_turn TEXT NOT NULL, "
+             "FOREIGN KEY(player1) REFERENCES User(nickname), "
+             "FOREIGN KEY(player2) REFERENCES User(nickname))",
+             "CREATE TABLE IF NOT EXISTS Ship ("
+             "ship_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "game_id INTEGER NOT NULL, "
+             "player TEXT NOT NULL, "
+             "x INTEGER NOT NULL, "
+             "y INTEGER NOT NULL, "
+             "size INTEGER NOT NULL, "
+             "is_horizontal INTEGER NOT NULL, "
+             "FOREIGN KEY(game_id) REFERENCES Game(game_id), "
+             "FOREIGN KEY(player) REFERENCES User(nickname))",
+             "CREATE TABLE IF NOT EXISTS Move ("
+             "move_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "game_id INTEGER NOT NULL, "
+             "player TEXT NOT NULL, "
+             "x INTEGER NOT NULL, "
+             "y INTEGER NOT NULL, "
+             "result TEXT NOT NULL, "
+             "FOREIGN KEY(game_id) REFERENCES Game(game_id), "
+             "FOREIGN KEY(player) REFERENCES User(nickname))"
+         }},
+        // Покрывающие индексы: проверка "уже стреляли", подсчёт попаданий и выборка
+        // кораблей игрока читают только индекс, без обхода всей таблицы
+        {2, "Covering indexes for move and ship lookups", {
+             "CREATE INDEX IF NOT EXISTS idx_move_game_player_cell ON Move (game_id, player, x, y, result)",
+             "CREATE INDEX IF NOT EXISTS idx_ship_game_player ON Ship (game_id, player, x, y, size, is_horizontal)"
+         }},
+        // Поле игрока одной строкой: флот и выстрелы в двоичном виде (формат описан в BoardBlob.h)
+        {3, "Per-player board blobs with decoding views", {
+             "CREATE TABLE IF NOT EXISTS PlayerBoard ("
+             "game_id INTEGER NOT NULL, "
+             "player TEXT NOT NULL, "
+             "fleet BLOB, "
+             "shots BLOB NOT NULL DEFAULT x'', "
+             "PRIMARY KEY (game_id, player)) WITHOUT ROWID",
+             shipBlobView("b.player", "PlayerBoard b"),
+             moveBlobView("b.player", "PlayerBoard b")
+         }},
+        // Никнейм хранится один раз в Player, остальные таблицы ссылаются на игрока числом.
+        // SQLite не меняет тип столбца, поэтому таблицы пересоздаются с переносом данных
+        {4, "Integer player IDs instead of nickname keys", {
+             "CREATE TABLE IF NOT EXISTS Player ("
+             "player_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "nickname TEXT NOT NULL UNIQUE)",
+             "INSERT OR IGNORE INTO Player (nickname) SELECT nickname FROM User",
+             "INSERT OR IGNORE INTO Player (nickname) "
+             "SELECT player1 FROM Game UNION SELECT player2 FROM Game UNION SELECT current_turn FROM Game "
+             "UNION SELECT player FROM Ship UNION SELECT player FROM Move UNION SELECT player FROM PlayerBoard",
+             "DROP VIEW IF EXISTS ShipBlobView",
+             "DROP VIEW IF EXISTS MoveBlobView",
+             "CREATE TABLE Game_new ("
+             "game_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "player1_id INTEGER NOT NULL, "
+             "player2_id INTEGER NOT NULL, "
+             "current_turn_id INTEGER NOT NULL, "
+             "FOREIGN KEY(player1_id) REFERENCES Player(player_id), "
+             "FOREIGN KEY(player2_id) REFERENCES Player(player_id))",
+             "INSERT INTO Game_new (game_id, player1_id, player2_id, current_turn_id) "
+             "SELECT g.game_id, p1.player_id, p2.player_id, pt.player_id FROM Game g "
+             "JOIN Player p1 ON p1.nickname = g.player1 "
+             "JOIN Player p2 ON p2.nickname = g.player2 "
+             "JOIN Player pt ON pt.nickname = g.current_turn",
+             "CREATE TABLE Ship_new ("
+             "ship_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "game_id INTEGER NOT NULL, "
+             "player_id INTEGER NOT NULL, "
+             "x INTEGER NOT NULL, "
+             "y INTEGER NOT NULL, "
+             "size INTEGER NOT NULL, "
+             "is_horizontal INTEGER NOT NULL, "
+             "FOREIGN KEY(game_id) REFERENCES Game(game_id), "
+             "FOREIGN KEY(player_id) REFERENCES Player(player_id))",
+             "INSERT INTO Ship_new (ship_id, game_id, player_id, x, y, size, is_horizontal) "
+             "SELECT s.ship_id, s.game_id, p.player_id, s.x, s.y, s.size, s.is_horizontal FROM Ship s "
+             "JOIN Player p ON p.nickname = s.player",
+             "CREATE TABLE Move_new ("
+             "move_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "game_id INTEGER NOT NULL, "
+             "player_id INTEGER NOT NULL, "
+             "x INTEGER NOT NULL, "
+             "y INTEGER NOT NULL, "
+             "result TEXT NOT NULL, "
+             "FOREIGN KEY(game_id) REFERENCES Game(game_id), "
+             "FOREIGN KEY(player_id) REFERENCES Player(player_id))",
+             "INSERT INTO Move_new (move_id, game_id, player_id, x, y, result) "
+             "SELECT m.move_id, m.game_id, p.player_id, m.x, m.y, m.result FROM Move m "
+             "JOIN Player p ON p.nickname = m.player",
+             "CREATE TABLE PlayerBoard_new ("
+             "game_id INTEGER NOT NULL, "
+             "player_id INTEGER NOT NULL, "
+             "fleet BLOB, "
+             "shots BLOB NOT NULL DEFAULT x'', "
+             "PRIMARY KEY (game_id, player_id)) WITHOUT ROWID",
+             "INSERT INTO PlayerBoard_new (game_id, player_id, fleet, shots) "
+             "SELECT b.game_id, p.player_id, b.fleet, b.shots FROM PlayerBoard b "
+             "JOIN Player p ON p.nickname = b.player",
+             "DROP TABLE Move",
+             "DROP TABLE Ship",
+             "DROP TABLE PlayerBoard",
+             "DROP TABLE Game",
+             "ALTER TABLE Game_new RENAME TO Game",
+             "ALTER TABLE Ship_new RENAME TO Ship",
+             "ALTER TABLE Move_new RENAME TO Move",
+             "ALTER TABLE PlayerBoard_new RENAME TO PlayerBoard",
+             "CREATE INDEX IF NOT EXISTS idx_move_game_player_cell ON Move (game_id, player_id, x, y, result)",
+             "CREATE INDEX IF NOT EXISTS idx_ship_game_player ON Ship (game_id, player_id, x, y, size, is_horizontal)",
+             shipBlobView("b.player_id, p.nickname AS player", "PlayerBoard b JOIN Player p ON p.player_id = b.player_id"),
+             moveBlobView("b.player_id, p.nickname AS player", "PlayerBoard b JOIN Player p ON p.player_id = b.player_id")
+         }},
+        // Выстрелы, дописанные без приведения типа, хранились как TEXT
+        {5, "Store appended shots as BLOB", {
+             "UPDATE PlayerBoard SET shots = CAST(shots AS BLOB) WHERE typeof(shots) = 'text'"
+         }}
+    };
+    return steps;
+}
+
+int SchemaMigrator::latestVersion()
+{
+    return migrations().isEmpty() ? 0 : migrations().last().version;
+}
+
+int SchemaMigrator::currentVersion(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec("SELECT MAX(version) FROM schema_version") || !query.next()) {
+        return 0;
+    }
+    return query.value(0).toInt();
+}
+
+bool SchemaMigrator::migrate(QSqlDatabase &db, int targetVersion)
+{
+    if (targetVersion < 0) {
+        targetVersion = latestVersion();
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS schema_version ("
+                    "version INTEGER PRIMARY KEY, "
+                    "description TEXT NOT NULL, "
+                    "applied_at TEXT NOT NULL DEFAULT CURRENT_TIMESTAMP)")) {
+        LOG_WARNING("Error creating table schema_version: %1", query.lastError().text());
+        return false;
+    }
+
+    int version = currentVersion(db);
+    LOG_INFO("Schema version: %1, target: %2", version, targetVersion);
+
+    for (const Migration &migration : migrations()) {
+        if (migration.version <= version || migration.version > targetVersion) {
+            continue;
+        }
+
+        // Шаг применяется целиком или не применяется вовсе
+        if (!db.transaction()) {
+            LOG_WARNING("Failed to start migration %1: %2", migration.version, db.lastError().text());
+            return false;
+        }
+        for (const QString &statement : migration.statements) {
+            if (!query.exec(statement)) {
+                LOG_WARNING("Migration %1 failed: %2", migration.version, query.lastError().text());
+                db.rollback();
+                return false;
+            }
+        }
+        query.prepare("INSERT INTO schema_version (version, description) VALUES (:version, :description)");
+        query.bindValue(":version", migration.version);
+        query.bindValue(":description", migration.description);
+        if (!query.exec() || !db.commit()) {
+            LOG_WARNING("Failed to record migration %1: %2", migration.version, db.lastError().text());
+            db.rollback();
+            return false;
+        }
+        LOG_INFO("Applied migration %1 - %2", migration.version, migration.description);
+    }
+    return true;
+}
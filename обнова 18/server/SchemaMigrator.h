@@ -0,0 +1,30 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Один шаг изменения схемы БД
+struct Migration
+{
+    int version;
+    QString description;
+    QStringList statements; // Выполняются по порядку в одной транзакции
+};
+
+// Версионные миграции схемы: номер применённой версии хранится в таблице schema_version,
+// при запуске выполняются только шаги с большим номером. Новое изменение схемы - новый шаг
+// в конце списка migrations(), уже выпущенные шаги не меняются.
+class SchemaMigrator
+{
+public:
+    static const QVector<Migration> &migrations();
+    static int latestVersion();
+    static int currentVersion(QSqlDatabase &db);
+    // Применяет шаги до targetVersion (по умолчанию до последней); false, если какой-то шаг не применился
+    static bool migrate(QSqlDatabase &db, int targetVersion = -1);
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -0,0 +1,471 @@
+#include "ServerWorker.h"
+#include "mytcpserver.h"
+#include "func2serv.h"
+#include "ClientConnection.h"
+#include "DatabaseManager.h"
+#include "Metrics.h"
+#include "Request.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include "LoopWatchdog.h"
+#include <QTcpSocket>
+#include <QTimer>
+#include <QJsonObject>
+#include <atomic>
+#include <utility>
+
+static std::atomic<quint64> nextConnectionId{1}; // Номера соединений уникальны на весь сервер
+
+namespace {
+
+// Метрики общие для всех воркеров: ряды регистрируются один раз, дальше обновляются без блокировок
+struct WorkerMetrics
+{
+    Metrics::Gauge *connections;
+    Metrics::Counter *bytesIn;
+    Metrics::Counter *bytesOut;
+    Metrics::Counter *requests[Request::TypeCount];
+
+    WorkerMetrics()
+    {
+        Metrics &registry = Metrics::getInstance();
+        connections = registry.gauge("seabattle_connections", "Open client connections.");
+        bytesIn = registry.counter("seabattle_received_bytes_total", "Bytes read from client sockets.");
+        bytesOut = registry.counter("seabattle_sent_bytes_total", "Bytes written to client sockets.");
+        for (int type = 0; type < Request::TypeCount; ++type) {
+            requests[type] = registry.counter("seabattle_requests_total", "Client requests by type.",
+                                              QString("type=\"%1\"").arg(Request::typeLabel(Request::Type(type))));
+        }
+    }
+};
+
+const WorkerMetrics &metrics()
+{
+    static const WorkerMetrics instance;
+    return instance;
+}
+
+} // namespace
+
+ServerWorker::ServerWorker(int index, MyTcpServer *server)
+    : QObject(nullptr), index(index), server(server)
+{
+    thread.setObjectName(QString("worker-%1").arg(index));
+    // Таймер создаётся дочерним, чтобы переехать в поток вместе с воркером, а запускается уже в нём
+    wheelTimer = new QTimer(this);
+    wheelTimer->setInterval(int(wheel.getTickMs()));
+    connect(wheelTimer, &QTimer::timeout, this, &ServerWorker::slotWheelTick);
+    connect(&thread, &QThread::started, this, [this]() {
+        wheelClock.start();
+        wheelTimer->start();
+        LoopWatchdog::getInstance().watchCurrentThread(this, thread.objectName());
+    });
+    moveToThread(&thread);
+}
+
+ServerWorker::~ServerWorker()
+{
+    stop();
+}
+
+void ServerWorker::start()
+{
+    thread.start();
+}
+
+void ServerWorker::stop()
+{
+    if (!thread.isRunning()) {
+        return;
+    }
+    QMetaObject::invokeMethod(this, [this]() {
+        LoopWatchdog::getInstance().unwatchCurrentThread();
+        closeConnections();
+    }, Qt::BlockingQueuedConnection);
+    thread.quit();
+    thread.wait();
+}
+
+void ServerWorker::addConnection(qintptr socketDescriptor)
+{
+    QMetaObject::invokeMethod(this, [this, socketDescriptor]() { acceptConnection(socketDescriptor); }, Qt::QueuedConnection);
+}
+
+void ServerWorker::deliver(quint64 connectionId, const QByteArray &message, OutboundLimits::MessageClass messageClass)
+{
+    if (QThread::currentThread() == &thread) {
+        writeToConnection(connectionId, message, messageClass);
+        return;
+    }
+    QMetaObject::invokeMethod(this, [this, connectionId, message, messageClass]() {
+        writeToConnection(connectionId, message, messageClass);
+    }, Qt::QueuedConnection);
+}
+
+void ServerWorker::setOutboundLimits(const OutboundLimits &limits)
+{
+    QMetaObject::invokeMethod(this, [this, limits]() { this->limits = limits; }, Qt::QueuedConnection);
+}
+
+void ServerWorker::setIdleTimeout(qint64 timeoutMs)
+{
+    QMetaObject::invokeMethod(this, [this, timeoutMs]() { idleTimeoutMs = qMax<qint64>(0, timeoutMs); }, Qt::QueuedConnection);
+}
+
+OutboundStats ServerWorker::getOutboundStats() const
+{
+    OutboundStats stats;
+    stats.messagesSent = messagesSent.load(std::memory_order_relaxed);
+    stats.socketWrites = socketWrites.load(std::memory_order_relaxed);
+    stats.dropped = droppedMessages.load(std::memory_order_relaxed);
+    stats.coalesced = coalescedMessages.load(std::memory_order_relaxed);
+    stats.slowDisconnects = slowDisconnects.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ServerWorker::acceptConnection(qintptr socketDescriptor)
+{
+    // Сокет создаётся в потоке воркера, поэтому все его события приходят сюда же
+    QTcpSocket *clientSocket = new QTcpSocket(this);
+    if (!clientSocket->setSocketDescriptor(socketDescriptor)) {
+        LOG_WARNING("Worker %1 failed to accept connection: %2", index, clientSocket->errorString());
+        delete clientSocket;
+        return;
+    }
+
+    // Ответы и так собираются в одну запись за итерацию, задержка Нейгла им только мешает
+    clientSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    metrics().connections->add(1);
+
+    ClientConnection *connection = new ClientConnection(nextConnectionId.fetch_add(1, std::memory_order_relaxed), clientSocket);
+    mConnections.insert(clientSocket, connection);
+    mConnectionsById.insert(connection->id, connection);
+    connect(clientSocket, &QTcpSocket::readyRead, this, &ServerWorker::slotServerRead);
+    connect(clientSocket, &QTcpSocket::disconnected, this, &ServerWorker::slotClientDisconnected);
+    connect(clientSocket, &QTcpSocket::bytesWritten, this, &ServerWorker::slotBytesWritten);
+    connection->lastActivity = wheel.now();
+    armIdleTimer(connection, idleTimeoutMs);
+    LOG_DEBUG("New client connected from %1 on worker %2", clientSocket->peerAddress().toString(), index);
+}
+
+void ServerWorker::slotServerRead()
+{
+    LoopWatchdog::Activity activity("read");
+    QTcpSocket *clientSocket = qobject_cast<QTcpSocket*>(sender());
+    if (!clientSocket) {
+        LOG_WARNING("Invalid client socket in slotServerRead");
+        return;
+    }
+    ClientConnection *connection = mConnections.value(clientSocket, nullptr);
+    if (!connection) {
+        return;
+    }
+
+    // Таймер простоя не переставляется на каждое чтение: при срабатывании он сверится с этим временем
+    connection->lastActivity = wheel.now();
+    // Один readyRead может содержать несколько запросов или только часть запроса
+    QByteArray data = clientSocket->readAll();
+    metrics().bytesIn->add(data.size());
+    connection->reader.append(data);
+    QByteArrayView frame;
+    FrameReader::FrameKind kind;
+    while (connection->reader.nextFrame(frame, kind)) {
+        connection->framing = kind;
+        processRequest(connection, frame, kind);
+    }
+
+    if (connection->reader.hasError()) {
+        LOG_WARNING("Frame too large from %1, closing connection", clientSocket->peerAddress().toString());
+        writeToSocket(connection, createJsonResponse("error", "error", "Frame too large"));
+        flushConnection(connection);
+        clientSocket->disconnectFromHost();
+    }
+}
+
+void ServerWorker::processRequest(ClientConnection *connection, QByteArrayView frame, FrameReader::FrameKind kind)
+{
+    LOG_TRACE("Received request: %1", frame);
+
+    // Запрос разбирается один раз; дальше обработчики работают с готовой структурой
+    qint64 decodeStartNs = Metrics::nowNs();
+    Request request;
+    QString error;
+    bool decoded = kind == FrameReader::BinaryFrame
+        ? Request::decodeBinary(frame, request, error)
+        : Request::decode(QByteArray::fromRawData(frame.data(), frame.size()), request, error);
+    request.receivedNs = Metrics::nowNs();
+    // Решение о трассировке принимается после разбора, поэтому участок разбора записывается задним числом
+    request.traceId = Tracer::getInstance().sample();
+    if (request.traceId != 0) {
+        Tracer::getInstance().record("decode", request.traceId, decodeStartNs, request.receivedNs);
+    }
+    Tracer::Context trace(request.traceId);
+    metrics().requests[decoded ? request.type : Request::Unknown]->add();
+    if (!decoded) {
+        LOG_WARNING("Failed to decode request: %1 - %2", frame, error);
+        writeToSocket(connection, createJsonResponse("error", "error", error), OutboundLimits::BestEffort);
+        return;
+    }
+
+    if (request.type == Request::Hello) {
+        negotiateProtocol(connection, request);
+        return;
+    }
+
+    if (request.type == Request::Register || request.type == Request::Login) {
+        // Игрок определится, только если обработчик подтвердит данные: тогда dispatchRequest вызовет bindPlayer
+        if (request.nickname.isEmpty()) {
+            writeToSocket(connection, createJsonResponse("error", "error", "Nickname is empty"));
+            return;
+        }
+    } else if (request.type == Request::Resume) {
+        // Игрок определяется только токеном; никнейм из запроса не учитывается
+        PlayerId playerId = server->redeemResumeToken(request.token);
+        if (playerId == NoPlayer) {
+            writeToSocket(connection, createJsonResponse("resume", "error", "Invalid resume token"));
+            return;
+        }
+        bindPlayer(connection->id, playerId, DatabaseManager::getInstance()->playerName(playerId));
+        request.nickname = connection->nickname;
+        request.fields |= Request::NicknameField;
+        request.playerId = playerId;
+    } else {
+        // Остальные запросы выполняются от имени игрока, вошедшего через это соединение.
+        // Двоичные запросы не содержат никнейма; чужой никнейм в JSON отклоняется
+        if (request.has(Request::NicknameField) && request.nickname != connection->nickname) {
+            writeToSocket(connection, createJsonResponse("error", "error",
+                                                         connection->playerId == NoPlayer ? "Not logged in" : "Nickname does not match the logged in player"));
+            return;
+        }
+        request.nickname = connection->nickname;
+        request.fields |= Request::NicknameField;
+        request.playerId = connection->playerId;
+    }
+    request.binaryReplies = connection->protocol == WireProtocol::BinaryProtocol;
+
+    // Обработчик выполнится в потоке, которому принадлежит состояние игрока; ответ вернётся через deliver
+    server->dispatchRequest(request, this, connection->id);
+}
+
+void ServerWorker::bindPlayer(quint64 connectionId, PlayerId player, const QString &nickname)
+{
+    ClientConnection *connection = mConnectionsById.value(connectionId, nullptr);
+    if (!connection) {
+        return;
+    }
+    // Повторный вход под другим именем: прежний игрок больше не получает сообщения через это соединение
+    if (connection->playerId != NoPlayer && connection->playerId != player) {
+        server->unregisterClient(connection->playerId, this, connection->id);
+    }
+    connection->nickname = nickname;
+    connection->playerId = player;
+    server->registerClient(player, this, connection->id, connection->protocol == WireProtocol::BinaryProtocol);
+}
+
+void ServerWorker::negotiateProtocol(ClientConnection *connection, const Request &request)
+{
+    bool binary = request.protocol == QLatin1String("binary");
+    QJsonObject reply;
+    reply["type"] = "hello";
+    reply["status"] = "success";
+    reply["protocol"] = binary ? "binary" : "json";
+    reply["version"] = WireProtocol::Version;
+    // Ответ уходит ещё прежним видом кадров, следующие сообщения - уже выбранным протоколом
+    writeToSocket(connection, createJsonMessage(reply));
+
+    connection->protocol = binary ? WireProtocol::BinaryProtocol : WireProtocol::JsonProtocol;
+    if (connection->playerId != NoPlayer) {
+        server->registerClient(connection->playerId, this, connection->id, binary);
+    }
+    LOG_DEBUG("Connection %1 uses %2 protocol", connection->id, (binary ? "binary" : "JSON"));
+}
+
+void ServerWorker::writeToConnection(quint64 connectionId, const QByteArray &message, OutboundLimits::MessageClass messageClass)
+{
+    ClientConnection *connection = mConnectionsById.value(connectionId, nullptr);
+    if (!connection || connection->socket->state() != QAbstractSocket::ConnectedState) {
+        LOG_WARNING("Cannot send message to connection %1 - it is closed. Message: %2", connectionId, message);
+        return;
+    }
+    LOG_TRACE("Sending message to %1: %2", connection->nickname, message);
+    writeToSocket(connection, message, messageClass);
+}
+
+void ServerWorker::writeToSocket(ClientConnection *connection, const QByteArray &message, OutboundLimits::MessageClass messageClass)
+{
+    if (connection->closing) {
+        return;
+    }
+
+    // Клиент не успевает читать: дальнейшее зависит от класса сообщения
+    qint64 backlog = connection->outbox.size() + connection->socket->bytesToWrite();
+    if (!connection->congested && backlog >= limits.highWatermark) {
+        connection->congested = true;
+        LOG_DEBUG("Connection %1 is congested: %2 bytes not sent", connection->id, backlog);
+    }
+    if (connection->congested) {
+        switch (limits.policies[messageClass]) {
+        case OutboundLimits::Drop:
+            droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        case OutboundLimits::CoalesceLatest:
+            if (!connection->latestState.isEmpty()) {
+                coalescedMessages.fetch_add(1, std::memory_order_relaxed);
+            }
+            connection->latestState = message;
+            return;
+        case OutboundLimits::Disconnect:
+            slowDisconnects.fetch_add(1, std::memory_order_relaxed);
+            LOG_DEBUG("Disconnecting slow client %1 with %2 bytes not sent", connection->nickname, backlog);
+            connection->closing = true;
+            connection->outbox.clear();
+            connection->latestState.clear();
+            // Соединение удалит slotClientDisconnected, поэтому закрываем его уже после текущего обработчика
+            QMetaObject::invokeMethod(connection->socket, [socket = connection->socket]() { socket->abort(); }, Qt::QueuedConnection);
+            return;
+        }
+    }
+
+    // Отвечаем клиенту тем же видом кадров, которым он пишет нам, или согласованным двоичным протоколом
+    FrameReader::FrameKind kind = connection->protocol == WireProtocol::BinaryProtocol ? FrameReader::BinaryFrame : connection->framing;
+    enqueueOutbound(connection, FrameReader::encode(message, kind));
+}
+
+void ServerWorker::enqueueOutbound(ClientConnection *connection, const QByteArray &frames)
+{
+    // Кадры копятся в outbox и уходят одной записью, когда цикл событий разберёт текущие события:
+    // ответ на ход, уведомление соперника и game_over становятся одним write на сокет
+    if (connection->outbox.isEmpty()) {
+        mPendingFlush.append(connection->id);
+    }
+    connection->outbox.append(frames);
+    messagesSent.fetch_add(1, std::memory_order_relaxed);
+
+    if (!flushScheduled) {
+        flushScheduled = true;
+        QMetaObject::invokeMethod(this, [this]() { flushPending(); }, Qt::QueuedConnection);
+    }
+}
+
+void ServerWorker::flushConnection(ClientConnection *connection)
+{
+    if (connection->outbox.isEmpty()) {
+        return;
+    }
+    // Не используем flush, чтобы избежать блокировки: данные допишет цикл событий
+    qint64 written = connection->socket->write(connection->outbox);
+    if (written == -1) {
+        LOG_WARNING("Failed to write to socket - Error: %1", connection->socket->errorString());
+    } else {
+        metrics().bytesOut->add(written);
+    }
+    socketWrites.fetch_add(1, std::memory_order_relaxed);
+    connection->outbox.clear();
+}
+
+void ServerWorker::flushPending()
+{
+    LoopWatchdog::Activity activity("flush");
+    flushScheduled = false;
+    const QVector<quint64> pending = std::exchange(mPendingFlush, QVector<quint64>());
+    for (quint64 connectionId : pending) {
+        ClientConnection *connection = mConnectionsById.value(connectionId, nullptr);
+        if (connection) {
+            flushConnection(connection);
+        }
+    }
+}
+
+void ServerWorker::slotBytesWritten()
+{
+    ClientConnection *connection = mConnections.value(qobject_cast<QTcpSocket*>(sender()), nullptr);
+    if (!connection || !connection->congested || connection->closing) {
+        return;
+    }
+    if (connection->outbox.size() + connection->socket->bytesToWrite() > limits.lowWatermark) {
+        return;
+    }
+
+    // Клиент догнал: отправляем отложенное последнее состояние
+    connection->congested = false;
+    LOG_DEBUG("Connection %1 is drained", connection->id);
+    if (!connection->latestState.isEmpty()) {
+        FrameReader::FrameKind kind = connection->protocol == WireProtocol::BinaryProtocol ? FrameReader::BinaryFrame : connection->framing;
+        enqueueOutbound(connection, FrameReader::encode(std::exchange(connection->latestState, QByteArray()), kind));
+    }
+}
+
+void ServerWorker::slotClientDisconnected()
+{
+    QTcpSocket *clientSocket = qobject_cast<QTcpSocket*>(sender());
+    ClientConnection *connection = mConnections.take(clientSocket);
+    if (!connection) {
+        return;
+    }
+    mConnectionsById.remove(connection->id);
+    wheel.cancel(connection->idleTimer);
+    metrics().connections->add(-1);
+    if (connection->playerId != NoPlayer) {
+        server->unregisterClient(connection->playerId, this, connection->id);
+        LOG_DEBUG("Client %1 disconnected from worker %2", connection->nickname, index);
+    }
+    delete connection;
+    clientSocket->deleteLater();
+}
+
+void ServerWorker::slotWheelTick()
+{
+    LoopWatchdog::Activity activity("timers");
+    // Прокручиваем на фактически прошедшее время: тики таймера Qt могут запаздывать
+    wheel.advance(wheelClock.restart());
+    timerCount.store(wheel.size(), std::memory_order_relaxed);
+}
+
+void ServerWorker::armIdleTimer(ClientConnection *connection, qint64 delayMs)
+{
+    if (idleTimeoutMs <= 0) {
+        return;
+    }
+    quint64 connectionId = connection->id;
+    connection->idleTimer = wheel.schedule(delayMs, [this, connectionId]() { checkIdle(connectionId); });
+}
+
+void ServerWorker::checkIdle(quint64 connectionId)
+{
+    ClientConnection *connection = mConnectionsById.value(connectionId, nullptr);
+    if (!connection) {
+        return;
+    }
+    connection->idleTimer = 0;
+    qint64 idle = wheel.now() - connection->lastActivity;
+    if (idle < idleTimeoutMs) {
+        armIdleTimer(connection, idleTimeoutMs - idle);
+        return;
+    }
+    // Клиент не шлёт keepalive: игрок в очереди или в игре может молчать долго, ожидая соперника
+    // или его расстановку. Зависшую игру закрывает срок хода, здесь закрываются только соединения вне их
+    PlayerId player = connection->playerId;
+    if (player != NoPlayer && (server->isInGame(player) || server->getMatchmaker().isQueued(player))) {
+        armIdleTimer(connection, idleTimeoutMs);
+        return;
+    }
+    LOG_DEBUG("Closing idle connection %1 of %2 after %3 ms on worker %4", connectionId, connection->nickname, idle, index);
+    // Полуоткрытый сокет может так и не сообщить об обрыве, поэтому закрываем без ожидания отправки
+    connection->socket->abort();
+}
+
+void ServerWorker::closeConnections()
+{
+    wheelTimer->stop();
+    for (ClientConnection *connection : std::as_const(mConnections)) {
+        connection->socket->disconnect(this);
+        delete connection->socket;
+        delete connection;
+    }
+    metrics().connections->add(-mConnections.size());
+    mConnections.clear();
+    mConnectionsById.clear();
+    mPendingFlush.clear();
+    // Соединение с БД этого потока закрывается здесь же: из другого потока его трогать нельзя
+    DatabaseManager::getInstance()->releaseThreadConnection();
+}
@@ -0,0 +1,90 @@
+#ifndef SERVERWORKER_H
+#define SERVERWORKER_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QByteArray>
+#include <QVector>
+#include <QElapsedTimer>
+#include <atomic>
+#include "FrameReader.h"
+#include "OutboundLimits.h"
+#include "PlayerRegistry.h"
+#include "TimerWheel.h"
+
+class MyTcpServer;
+class QTcpSocket;
+class QTimer;
+struct ClientConnection;
+struct Request;
+
+// Рабочий поток сервера: обслуживает свою часть соединений (приём, разбор кадров, отправку)
+// и игровые сессии, закреплённые за ним. Состояние воркера трогает только его собственный поток,
+// остальные потоки обращаются к нему через очередь событий (deliver, addConnection, invokeMethod).
+class ServerWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    ServerWorker(int index, MyTcpServer *server);
+    ~ServerWorker();
+
+    int getIndex() const { return index; }
+    OutboundStats getOutboundStats() const;
+    int getTimerCount() const { return timerCount.load(std::memory_order_relaxed); }
+    TimerWheel &timers() { return wheel; } // Только из потока воркера: сроки ходов его сессий и простоя соединений
+    void start();
+    void stop(); // Закрывает соединения воркера и останавливает поток
+
+    // Потокобезопасные методы
+    void addConnection(qintptr socketDescriptor);
+    // Отправка сообщения в соединение воркера
+    void deliver(quint64 connectionId, const QByteArray &message,
+                 OutboundLimits::MessageClass messageClass = OutboundLimits::Essential);
+    void setOutboundLimits(const OutboundLimits &limits);
+    void setIdleTimeout(qint64 timeoutMs); // 0 - соединения без ограничения простоя
+    // Привязывает соединение к игроку после проверки пароля; только из потока воркера
+    void bindPlayer(quint64 connectionId, PlayerId player, const QString &nickname);
+
+private slots:
+    void slotServerRead();
+    void slotClientDisconnected();
+    void slotBytesWritten();
+    void slotWheelTick();
+
+private:
+    void acceptConnection(qintptr socketDescriptor);
+    void processRequest(ClientConnection *connection, QByteArrayView frame, FrameReader::FrameKind kind);
+    void negotiateProtocol(ClientConnection *connection, const Request &request);
+    void writeToConnection(quint64 connectionId, const QByteArray &message, OutboundLimits::MessageClass messageClass);
+    void writeToSocket(ClientConnection *connection, const QByteArray &message,
+                       OutboundLimits::MessageClass messageClass = OutboundLimits::Essential);
+    void enqueueOutbound(ClientConnection *connection, const QByteArray &frames);
+    void flushConnection(ClientConnection *connection);
+    void flushPending();
+    void closeConnections();
+    void armIdleTimer(ClientConnection *connection, qint64 delayMs);
+    void checkIdle(quint64 connectionId);
+
+    int index;
+    MyTcpServer *server;
+    QThread thread;
+    QHash<QTcpSocket*, ClientConnection*> mConnections; // Сокет -> Состояние соединения
+    QHash<quint64, ClientConnection*> mConnectionsById; // Номер соединения -> Состояние соединения
+    QVector<quint64> mPendingFlush; // Соединения с непустым outbox
+    bool flushScheduled = false;
+    OutboundLimits limits;
+    TimerWheel wheel; // Все таймеры воркера; прокручивается одним QTimer
+    QTimer *wheelTimer;
+    QElapsedTimer wheelClock;
+    qint64 idleTimeoutMs = 0;
+    std::atomic<int> timerCount{0};
+    std::atomic<qint64> socketWrites{0};
+    std::atomic<qint64> messagesSent{0};
+    std::atomic<qint64> droppedMessages{0};
+    std::atomic<qint64> coalescedMessages{0};
+    std::atomic<qint64> slowDisconnects{0};
+};
+
+#endif // SERVERWORKER_H
@@ -0,0 +1,93 @@
+#include "ShutdownSignals.h"
+#include "Logger.h"
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <atomic>
+#include <cstdlib>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <QSocketNotifier>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<bool> quitRequested{false};
+
+#ifdef Q_OS_WIN
+
+BOOL WINAPI consoleHandler(DWORD type)
+{
+    if (type != CTRL_C_EVENT && type != CTRL_BREAK_EVENT && type != CTRL_CLOSE_EVENT && type != CTRL_SHUTDOWN_EVENT) {
+        return FALSE;
+    }
+    if (quitRequested.exchange(true)) {
+        std::_Exit(1);
+    }
+    // Обработчик выполняется в отдельном потоке: quit() ставится в очередь главного
+    QMetaObject::invokeMethod(QCoreApplication::instance(), []() { QCoreApplication::quit(); }, Qt::QueuedConnection);
+    return TRUE;
+}
+
+#else
+
+int signalPipe[2] = {-1, -1};
+
+void signalHandler(int)
+{
+    // В обработчике сигнала допустимы только async-signal-safe вызовы
+    if (quitRequested.exchange(true)) {
+        std::_Exit(1);
+    }
+    char byte = 1;
+    ssize_t written = ::write(signalPipe[1], &byte, 1);
+    Q_UNUSED(written);
+}
+
+#endif
+
+} // namespace
+
+bool ShutdownSignals::install()
+{
+#ifdef Q_OS_WIN
+    if (!SetConsoleCtrlHandler(consoleHandler, TRUE)) {
+        LOG_WARNING("Failed to install console control handler");
+        return false;
+    }
+    return true;
+#else
+    if (::pipe(signalPipe) != 0) {
+        LOG_WARNING("Failed to create signal pipe");
+        return false;
+    }
+    for (int fd : signalPipe) {
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    QSocketNotifier *notifier = new QSocketNotifier(signalPipe[0], QSocketNotifier::Read, QCoreApplication::instance());
+    QObject::connect(notifier, &QSocketNotifier::activated, notifier, [notifier]() {
+        char byte;
+        while (::read(signalPipe[0], &byte, 1) > 0) {
+        }
+        notifier->setEnabled(false);
+        LOG_INFO("Termination signal received, shutting down");
+        QCoreApplication::quit();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = signalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (::sigaction(SIGINT, &action, nullptr) != 0 || ::sigaction(SIGTERM, &action, nullptr) != 0) {
+        LOG_WARNING("Failed to install SIGINT/SIGTERM handlers");
+        return false;
+    }
+    return true;
+#endif
+}
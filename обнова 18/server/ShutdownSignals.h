@@ -0,0 +1,16 @@
+#ifndef SHUTDOWNSIGNALS_H
+#define SHUTDOWNSIGNALS_H
+
+// Ctrl+C и kill завершают сервер через QCoreApplication::quit(), а не обрывают процесс:
+// тогда срабатывает aboutToQuit и очередь записи в БД, журнал и трассировка успевают сохраниться.
+// На Unix обработчик SIGINT/SIGTERM только пишет байт в self-pipe, а quit() вызывается уже
+// в главном потоке по QSocketNotifier. На Windows то же делает обработчик SetConsoleCtrlHandler.
+// Повторный сигнал во время остановки завершает процесс сразу.
+class ShutdownSignals
+{
+public:
+    // Вызывается из главного потока после создания QCoreApplication
+    static bool install();
+};
+
+#endif // SHUTDOWNSIGNALS_H
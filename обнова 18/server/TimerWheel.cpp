@@ -0,0 +1,87 @@
+#include "TimerWheel.h"
+#include <utility>
+
+TimerWheel::TimerWheel(qint64 tickMs) : tickMs(qMax<qint64>(1, tickMs))
+{
+}
+
+TimerWheel::TimerId TimerWheel::schedule(qint64 delayMs, Callback callback)
+{
+    const quint64 maxTicks = (quint64(1) << (SlotBits * Levels)) - 1;
+    quint64 ticks = quint64(qMax<qint64>(1, (delayMs + tickMs - 1) / tickMs));
+    TimerId id = nextId++;
+    place(Timer{id, currentTick + qMin(ticks, maxTicks), std::move(callback)});
+    return id;
+}
+
+void TimerWheel::place(Timer &&timer)
+{
+    // Уровень выбирается по расстоянию до срока, ячейка - по соответствующим битам самого срока
+    quint64 delta = timer.expiry - currentTick;
+    int level = 0;
+    while (level < Levels - 1 && delta >= (quint64(1) << (SlotBits * (level + 1)))) {
+        ++level;
+    }
+    Slot &slot = wheelSlots[level][(timer.expiry >> (SlotBits * level)) & (Slots - 1)];
+    TimerId id = timer.id;
+    slot.push_back(std::move(timer));
+    index.insert(id, Position{&slot, std::prev(slot.end())});
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    QHash<TimerId, Position>::iterator it = index.find(id);
+    if (it == index.end()) {
+        return false;
+    }
+    it->slot->erase(it->timer);
+    index.erase(it);
+    return true;
+}
+
+void TimerWheel::cascade(int level)
+{
+    // Таймеры ячейки верхнего уровня сработают в ближайшие Slots^level тиков - раскладываем их ниже
+    Slot &slot = wheelSlots[level][(currentTick >> (SlotBits * level)) & (Slots - 1)];
+    Slot pending;
+    pending.swap(slot);
+    while (!pending.empty()) {
+        Timer timer = std::move(pending.front());
+        pending.pop_front();
+        index.remove(timer.id);
+        place(std::move(timer));
+    }
+}
+
+int TimerWheel::tick()
+{
+    ++currentTick;
+    for (int level = Levels - 1; level > 0; --level) {
+        if ((currentTick & ((quint64(1) << (SlotBits * level)) - 1)) == 0) {
+            cascade(level);
+        }
+    }
+
+    // Обработчик может ставить и отменять таймеры, поэтому снимаем их с ячейки по одному
+    Slot &slot = wheelSlots[0][currentTick & (Slots - 1)];
+    int fired = 0;
+    while (!slot.empty()) {
+        Timer timer = std::move(slot.front());
+        slot.pop_front();
+        index.remove(timer.id);
+        timer.callback();
+        ++fired;
+    }
+    return fired;
+}
+
+int TimerWheel::advance(qint64 elapsedMs)
+{
+    carryMs += qMax<qint64>(0, elapsedMs);
+    int fired = 0;
+    while (carryMs >= tickMs) {
+        carryMs -= tickMs;
+        fired += tick();
+    }
+    return fired;
+}
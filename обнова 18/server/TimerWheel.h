@@ -0,0 +1,61 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QHash>
+#include <functional>
+#include <list>
+
+// Иерархическое колесо таймеров: Levels уровней по Slots ячеек, ячейка уровня n покрывает Slots^n тиков.
+// Постановка и отмена таймера - O(1), тик обрабатывает одну ячейку нижнего уровня и изредка
+// переносит ячейку верхнего уровня вниз, поэтому стоимость тика не зависит от числа таймеров.
+// Не потокобезопасно: колесом пользуется только поток-владелец (у каждого воркера своё колесо).
+class TimerWheel
+{
+public:
+    typedef quint64 TimerId;
+    typedef std::function<void()> Callback;
+
+    static const int SlotBits = 6;
+    static const int Slots = 1 << SlotBits;
+    static const int Levels = 4; // При тике 100 мс - около 19 суток вперёд
+
+    explicit TimerWheel(qint64 tickMs = 100);
+
+    qint64 getTickMs() const { return tickMs; }
+    qint64 now() const { return qint64(currentTick) * tickMs; } // Время колеса, мс
+
+    // Срок округляется вверх до тика; слишком дальние сроки сокращаются до предела колеса
+    TimerId schedule(qint64 delayMs, Callback callback);
+    bool cancel(TimerId id);
+    int advance(qint64 elapsedMs); // Прокручивает колесо, вызывает наступившие таймеры и возвращает их число
+    int size() const { return index.size(); }
+
+private:
+    struct Timer
+    {
+        TimerId id;
+        quint64 expiry; // Тик срабатывания
+        Callback callback;
+    };
+
+    typedef std::list<Timer> Slot;
+
+    struct Position
+    {
+        Slot *slot;
+        Slot::iterator timer;
+    };
+
+    void place(Timer &&timer);
+    void cascade(int level);
+    int tick();
+
+    qint64 tickMs;
+    qint64 carryMs = 0; // Остаток времени меньше тика
+    quint64 currentTick = 0;
+    TimerId nextId = 1;
+    Slot wheelSlots[Levels][Slots]; // Не slots: в Qt это макрос
+    QHash<TimerId, Position> index; // Для отмены за O(1)
+};
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,140 @@
+#include "Tracer.h"
+#include "Metrics.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QCoreApplication>
+#include <cmath>
+
+thread_local quint64 Tracer::currentTrace = 0;
+
+Tracer::Span::Span(const char *name) : name(name), traceId(currentTrace)
+{
+    if (traceId != 0) {
+        startNs = Metrics::nowNs();
+    }
+}
+
+void Tracer::Span::finish()
+{
+    if (traceId == 0) {
+        return;
+    }
+    Tracer::getInstance().record(name, traceId, startNs, Metrics::nowNs());
+    traceId = 0;
+}
+
+Tracer::Tracer()
+{
+    Metrics::getInstance().gauge("seabattle_trace_dropped_events", "Trace spans dropped because the buffer held MaxEvents.",
+                                 [this]() { return double(getDroppedEvents()); });
+}
+
+Tracer &Tracer::getInstance()
+{
+    static Tracer instance;
+    return instance;
+}
+
+void Tracer::setSampleRate(double rate)
+{
+    quint32 every = 0;
+    if (rate > 0) {
+        every = rate >= 1 ? 1 : quint32(std::lround(1.0 / rate));
+    }
+    sampleEvery.store(every, std::memory_order_relaxed);
+}
+
+quint64 Tracer::sample()
+{
+    quint32 every = sampleEvery.load(std::memory_order_relaxed);
+    if (every == 0) {
+        return 0;
+    }
+    // Каждый every-й запрос, без генератора случайных чисел на горячем пути
+    if (requestCounter.fetch_add(1, std::memory_order_relaxed) % every != 0) {
+        return 0;
+    }
+    return nextTrace.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Tracer::record(const char *name, quint64 traceId, qint64 startNs, qint64 endNs)
+{
+    QMutexLocker locker(&mutex);
+    if (int(events.size()) >= MaxEvents) {
+        droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    events.push_back(Event{name, traceId, startNs, endNs - startNs, threadIndex()});
+}
+
+int Tracer::threadIndex()
+{
+    // Индекс запоминается потоком; имя берётся один раз, при первом участке
+    thread_local int index = -1;
+    if (index == -1) {
+        QThread *current = QThread::currentThread();
+        QByteArray name = current && !current->objectName().isEmpty()
+            ? current->objectName().toUtf8()
+            : QByteArray("thread-") + QByteArray::number(quintptr(current), 16);
+        index = int(threadNames.size());
+        threadNames.push_back(name);
+    }
+    return index;
+}
+
+QByteArray Tracer::exportJson(bool clear)
+{
+    std::vector<Event> snapshot;
+    std::vector<QByteArray> names;
+    {
+        QMutexLocker locker(&mutex);
+        if (clear) {
+            snapshot.swap(events);
+        } else {
+            snapshot = events;
+        }
+        names = threadNames;
+    }
+
+    QJsonArray traceEvents;
+    qint64 pid = QCoreApplication::applicationPid();
+    for (size_t thread = 0; thread < names.size(); ++thread) {
+        QJsonObject metadata;
+        metadata["ph"] = "M";
+        metadata["name"] = "thread_name";
+        metadata["pid"] = pid;
+        metadata["tid"] = int(thread);
+        metadata["args"] = QJsonObject{{"name", QString::fromUtf8(names[thread])}};
+        traceEvents.append(metadata);
+    }
+    // Время в микросекундах, как требует формат; дробная часть сохраняет наносекунды
+    for (const Event &event : snapshot) {
+        QJsonObject span;
+        span["ph"] = "X";
+        span["name"] = event.name;
+        span["cat"] = "request";
+        span["pid"] = pid;
+        span["tid"] = event.thread;
+        span["ts"] = event.startNs / 1000.0;
+        span["dur"] = event.durationNs / 1000.0;
+        span["args"] = QJsonObject{{"trace", qint64(event.traceId)}};
+        traceEvents.append(span);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool Tracer::writeFile(const QString &path, bool clear)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(exportJson(clear)) != -1;
+}
@@ -0,0 +1,90 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+// Трассировка отдельных запросов: из каждых N запросов один получает номер трассы, и все участки (Span),
+// пройденные им в любом потоке, сохраняются с началом и длительностью. exportJson() отдаёт их в формате
+// Chrome trace events - файл открывается в chrome://tracing или Perfetto как временная шкала по потокам.
+// Для несэмплированного запроса участок стоит одно чтение thread_local переменной.
+class Tracer
+{
+public:
+    static const int MaxEvents = 200000; // Дальше участки отбрасываются до следующей выгрузки
+
+    // Делает трассу текущей для потока на время своей жизни (запрос переходит между воркерами)
+    class Context
+    {
+    public:
+        explicit Context(quint64 traceId) : previous(currentTrace) { currentTrace = traceId; }
+        ~Context() { currentTrace = previous; }
+        Context(const Context&) = delete;
+        Context &operator=(const Context&) = delete;
+
+    private:
+        quint64 previous;
+    };
+
+    // Участок текущей трассы: от конструктора до finish() или деструктора. name - строковый литерал
+    class Span
+    {
+    public:
+        explicit Span(const char *name);
+        ~Span() { finish(); }
+        Span(const Span&) = delete;
+        Span &operator=(const Span&) = delete;
+
+        void finish();
+
+    private:
+        const char *name;
+        quint64 traceId;
+        qint64 startNs = 0;
+    };
+
+    static Tracer &getInstance();
+    static quint64 current() { return currentTrace; } // 0 - поток сейчас ничего не трассирует
+
+    void setSampleRate(double rate); // Доля трассируемых запросов: 0 - выключено, 1 - все
+    quint64 sample(); // Номер трассы для нового запроса или 0
+    void record(const char *name, quint64 traceId, qint64 startNs, qint64 endNs);
+    // Накопленные участки в JSON; clear - начать накопление заново
+    QByteArray exportJson(bool clear);
+    bool writeFile(const QString &path, bool clear);
+    qint64 getDroppedEvents() const { return droppedEvents.load(std::memory_order_relaxed); }
+
+private:
+    struct Event
+    {
+        const char *name;
+        quint64 traceId;
+        qint64 startNs;
+        qint64 durationNs;
+        int thread; // Индекс в threadNames
+    };
+
+    Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer &operator=(const Tracer&) = delete;
+
+    int threadIndex(); // Под mutex
+
+    static thread_local quint64 currentTrace;
+    std::atomic<quint32> sampleEvery{0}; // 0 - трассировка выключена
+    std::atomic<quint64> requestCounter{0};
+    std::atomic<quint64> nextTrace{1};
+    std::atomic<qint64> droppedEvents{0};
+    QMutex mutex; // Берётся только для сэмплированных запросов
+    std::vector<Event> events;
+    std::vector<QByteArray> threadNames;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Участок до конца текущего блока
+#define TRACE_SPAN(name) Tracer::Span TRACE_CONCAT(traceSpan, __LINE__)(name)
+
+#endif // TRACER_H
@@ -0,0 +1,143 @@
+#include "WireProtocol.h"
+#include "FrameReader.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+// Кадр: заголовок FrameReader, код сообщения и поля
+QByteArray frame(WireProtocol::Opcode opcode, const char *fields, int size)
+{
+    Q_ASSERT(1 + size <= WireProtocol::MaxPayloadSize);
+    QByteArray data(FrameReader::BinaryHeaderSize + 1 + size, Qt::Uninitialized);
+    char *out = data.data();
+    out[0] = FrameReader::BinaryMarker;
+    qToBigEndian<quint16>(quint16(1 + size), out + 1);
+    out[FrameReader::BinaryHeaderSize] = char(opcode);
+    if (size > 0) {
+        memcpy(out + FrameReader::BinaryHeaderSize + 1, fields, size);
+    }
+    return data;
+}
+
+char cell(int x, int y)
+{
+    return Bitboard::inBounds(x, y) ? char(Bitboard::index(x, y)) : char(0xFF);
+}
+
+void fromCell(uchar cell, int &x, int &y)
+{
+    x = cell % Bitboard::Size;
+    y = cell / Bitboard::Size;
+}
+
+const uchar *fields(QByteArrayView payload)
+{
+    return reinterpret_cast<const uchar*>(payload.data()) + 1;
+}
+
+} // namespace
+
+QByteArray WireProtocol::encodeStartGame()
+{
+    return frame(StartGameMessage, nullptr, 0);
+}
+
+QByteArray WireProtocol::encodePlaceShip(qint32 gameId, int x, int y, int size, bool isHorizontal)
+{
+    char data[6];
+    qToBigEndian<qint32>(gameId, data);
+    data[4] = cell(x, y);
+    data[5] = char((size & 0x7F) | (isHorizontal ? HorizontalFlag : 0));
+    return frame(PlaceShipMessage, data, sizeof(data));
+}
+
+QByteArray WireProtocol::encodeReadyToBattle(qint32 gameId)
+{
+    char data[4];
+    qToBigEndian<qint32>(gameId, data);
+    return frame(ReadyToBattleMessage, data, sizeof(data));
+}
+
+QByteArray WireProtocol::encodeMakeMove(qint32 gameId, int x, int y)
+{
+    char data[5];
+    qToBigEndian<qint32>(gameId, data);
+    data[4] = cell(x, y);
+    return frame(MakeMoveMessage, data, sizeof(data));
+}
+
+QByteArray WireProtocol::encodeShot(Opcode opcode, int x, int y, BoardBlob::ShotCode code, bool yourTurn)
+{
+    char data[3] = {cell(x, y), char(code), char(yourTurn ? YourTurnFlag : 0)};
+    return frame(opcode, data, sizeof(data));
+}
+
+QByteArray WireProtocol::encodeGameStart(bool yourTurn)
+{
+    char data[1] = {char(yourTurn ? YourTurnFlag : 0)};
+    return frame(GameStartMessage, data, sizeof(data));
+}
+
+QByteArray WireProtocol::encodeJson(QByteArrayView json)
+{
+    json = json.trimmed();
+    if (1 + json.size() > MaxPayloadSize) {
+        return FrameReader::encode(json.toByteArray(), FrameReader::LengthPrefixedFrame);
+    }
+    return frame(JsonMessage, json.data(), int(json.size()));
+}
+
+bool WireProtocol::decodeGameId(QByteArrayView payload, qint32 &gameId)
+{
+    if (payload.size() != 5) {
+        return false;
+    }
+    gameId = qFromBigEndian<qint32>(fields(payload));
+    return true;
+}
+
+bool WireProtocol::decodePlaceShip(QByteArrayView payload, qint32 &gameId, ShipPlacement &ship)
+{
+    if (payload.size() != 7) {
+        return false;
+    }
+    const uchar *data = fields(payload);
+    gameId = qFromBigEndian<qint32>(data);
+    fromCell(data[4], ship.x, ship.y);
+    ship.size = data[5] & 0x7F;
+    ship.isHorizontal = data[5] & HorizontalFlag;
+    return true;
+}
+
+bool WireProtocol::decodeMove(QByteArrayView payload, Move &move)
+{
+    if (payload.size() != 6) {
+        return false;
+    }
+    const uchar *data = fields(payload);
+    move.gameId = qFromBigEndian<qint32>(data);
+    fromCell(data[4], move.x, move.y);
+    return true;
+}
+
+bool WireProtocol::decodeShot(QByteArrayView payload, Shot &shot)
+{
+    if (payload.size() != 4) {
+        return false;
+    }
+    const uchar *data = fields(payload);
+    fromCell(data[0], shot.x, shot.y);
+    shot.code = data[1] <= BoardBlob::SunkCode ? BoardBlob::ShotCode(data[1]) : BoardBlob::MissCode;
+    shot.yourTurn = data[2] & YourTurnFlag;
+    return true;
+}
+
+bool WireProtocol::decodeGameStart(QByteArrayView payload, bool &yourTurn)
+{
+    if (payload.size() != 2) {
+        return false;
+    }
+    yourTurn = fields(payload)[0] & YourTurnFlag;
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef WIREPROTOCOL_H
+#define WIREPROTOCOL_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include "BoardBlob.h"
+
+// Двоичный протокол обмена клиента и сервера.
+//
+// Клиент предлагает его сообщением {"type":"hello","protocol":"binary"}; после ответа сервера
+// обе стороны пишут кадры FrameReader::BinaryFrame. Первый байт полезной нагрузки - код сообщения.
+// Частые сообщения (ходы, начало боя) имеют фиксированную раскладку: клетка - один байт
+// (y * 10 + x, как в BoardBlob), номер игры - qint32 big-endian. Остальные сообщения передаются
+// JSON-текстом в кадре с кодом JsonMessage, поэтому отладочный вывод остаётся читаемым.
+// Игрок в двоичных запросах не передаётся: сервер знает его по соединению.
+class WireProtocol
+{
+public:
+    enum Protocol {
+        JsonProtocol,
+        BinaryProtocol
+    };
+
+    enum Opcode : quint8 {
+        JsonMessage = 0x00,
+        // Клиент -> сервер
+        StartGameMessage = 0x01, // без полей
+        PlaceShipMessage = 0x02, // game_id, клетка, размер | HorizontalFlag
+        ReadyToBattleMessage = 0x03, // game_id
+        MakeMoveMessage = 0x04, // game_id, клетка
+        // Сервер -> клиент
+        MoveResultMessage = 0x10, // результат своего выстрела: клетка, код результата, флаги
+        OpponentMoveMessage = 0x11, // выстрел соперника, раскладка та же
+        GameStartMessage = 0x12 // флаги
+    };
+
+    enum Flag : quint8 {
+        HorizontalFlag = 0x80, // В байте размера корабля
+        YourTurnFlag = 0x01 // Следующий ход за получателем
+    };
+
+    static const int Version = 1;
+    static const int MaxPayloadSize = 0xFFFF; // Длина в заголовке двоичного кадра - quint16
+
+    // Разобранные сообщения фиксированной раскладки: без выделения памяти
+    struct Move
+    {
+        qint32 gameId = -1;
+        int x = 0;
+        int y = 0;
+    };
+
+    struct Shot
+    {
+        int x = 0;
+        int y = 0;
+        BoardBlob::ShotCode code = BoardBlob::MissCode;
+        bool yourTurn = false;
+    };
+
+    // Готовые кадры для записи в сокет
+    static QByteArray encodeStartGame();
+    static QByteArray encodePlaceShip(qint32 gameId, int x, int y, int size, bool isHorizontal);
+    static QByteArray encodeReadyToBattle(qint32 gameId);
+    static QByteArray encodeMakeMove(qint32 gameId, int x, int y);
+    static QByteArray encodeShot(Opcode opcode, int x, int y, BoardBlob::ShotCode code, bool yourTurn);
+    static QByteArray encodeGameStart(bool yourTurn);
+    // Одно JSON-сообщение; не помещающееся в двоичный кадр уходит кадром с префиксом длины,
+    // который FrameReader принимает при любом протоколе
+    static QByteArray encodeJson(QByteArrayView json);
+
+    // Разбор полезной нагрузки кадра; false, если длина не совпадает с раскладкой
+    static Opcode opcode(QByteArrayView payload) { return payload.isEmpty() ? JsonMessage : Opcode(quint8(payload.at(0))); }
+    static QByteArrayView json(QByteArrayView payload) { return payload.isEmpty() ? payload : payload.sliced(1); }
+    static bool decodeGameId(QByteArrayView payload, qint32 &gameId);
+    static bool decodePlaceShip(QByteArrayView payload, qint32 &gameId, ShipPlacement &ship);
+    static bool decodeMove(QByteArrayView payload, Move &move);
+    static bool decodeShot(QByteArrayView payload, Shot &shot);
+    static bool decodeGameStart(QByteArrayView payload, bool &yourTurn);
+};
+
+#endif // WIREPROTOCOL_H
@@ -3,7 +3,7 @@ QT -= gui
 QT += network #Для работы с сетью
 QT += sql
 
-CONFIG += c++11 console
+CONFIG += c++17 console
 CONFIG -= app_bundle
 
 # The following define makes your compiler emit warnings if you use
@@ -18,10 +18,31 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    BoardBlob.cpp \
+    ConnectionPool.cpp \
     DatabaseManager.cpp \
+    FleetValidator.cpp \
+    FrameReader.cpp \
     func2serv.cpp \
+    GameBoard.cpp \
+    GameSession.cpp \
+    Logger.cpp \
+    LoopWatchdog.cpp \
     main.cpp \
-    mytcpserver.cpp
+    Matchmaker.cpp \
+    Metrics.cpp \
+    MetricsServer.cpp \
+    mytcpserver.cpp \
+    OutboundLimits.cpp \
+    PersistenceWorker.cpp \
+    PlayerRegistry.cpp \
+    Request.cpp \
+    SchemaMigrator.cpp \
+    ServerWorker.cpp \
+    ShutdownSignals.cpp \
+    TimerWheel.cpp \
+    Tracer.cpp \
+    WireProtocol.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -29,6 +50,30 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    Bitboard.h \
+    BoardBlob.h \
+    ClientConnection.h \
+    ConnectionPool.h \
     DatabaseManager.h \
+    FleetValidator.h \
+    FrameReader.h \
     func2serv.h \
-    mytcpserver.h
+    GameBoard.h \
+    GameSession.h \
+    Logger.h \
+    LoopWatchdog.h \
+    Matchmaker.h \
+    Metrics.h \
+    MetricsServer.h \
+    MpscQueue.h \
+    mytcpserver.h \
+    OutboundLimits.h \
+    PersistenceWorker.h \
+    PlayerRegistry.h \
+    Request.h \
+    SchemaMigrator.h \
+    ServerWorker.h \
+    ShutdownSignals.h \
+    TimerWheel.h \
+    Tracer.h \
+    WireProtocol.h
@@ -1,9 +1,17 @@
 #include "func2serv.h"
+#include "BoardBlob.h"
 #include "DatabaseManager.h"
 #include "mytcpserver.h"
+#include "FleetValidator.h"
+#include "GameSession.h"
+#include "Request.h"
+#include "WireProtocol.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include "LoopWatchdog.h"
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QDebug>
 
 // Функция формирования JSON-ответа
 QByteArray createJsonResponse(const QString &type, const QString &status, const QString &message) {
@@ -11,179 +19,146 @@ QByteArray createJsonResponse(const QString &type, const QString &status, const
     jsonObj["type"] = type;
     jsonObj["status"] = status;
     jsonObj["message"] = message;
-    QJsonDocument doc(jsonObj);
-    return doc.toJson(QJsonDocument::Compact) + "\r\n";
+    return createJsonMessage(jsonObj);
 }
 
-// Функция парсинга команд
-QByteArray parse(const QString &input, MyTcpServer *server) {
-    qDebug() << "Received input:" << input;
-    QJsonDocument doc = QJsonDocument::fromJson(input.toUtf8());
-    if (!doc.isObject()) {
-        qDebug() << "Invalid JSON format, input:" << input;
-        return createJsonResponse("error", "error", "Invalid JSON format");
-    }
-
-    QJsonObject jsonObj = doc.object();
-    if (!jsonObj.contains("type")) {
-        qDebug() << "Missing type field in JSON, input:" << input;
-        return createJsonResponse("error", "error", "Missing type field");
-    }
-
-    QString type = jsonObj["type"].toString();
-    qDebug() << "Parsed type:" << type;
-    if (type == "register") {
-        QByteArray response = handleRegister(input);
-        QJsonDocument doc = QJsonDocument::fromJson(response);
-        if (doc.isObject()) {
-            QJsonObject obj = doc.object();
-            if (obj["status"].toString() == "success") {
-                QString nickname = jsonObj["nickname"].toString();
-                obj["nickname"] = nickname;
-                response = QJsonDocument(obj).toJson(QJsonDocument::Compact) + "\r\n";
-            }
-        }
-        return response;
-    } else if (type == "login") {
-        QByteArray response = slotLogin(input);
-        QJsonDocument doc = QJsonDocument::fromJson(response);
-        if (doc.isObject()) {
-            QJsonObject obj = doc.object();
-            if (obj["status"].toString() == "success") {
-                QString nickname = jsonObj["nickname"].toString();
-                obj["nickname"] = nickname;
-                response = QJsonDocument(obj).toJson(QJsonDocument::Compact) + "\r\n";
-            }
-        }
-        return response;
-    } else if (type == "start_game") {
-        return handleStartGame(input, server);
-    } else if (type == "place_ship") {
-        return handlePlaceShip(input, server);
-    } else if (type == "make_move") {
-        return handleMakeMove(input, server);
-    } else if (type == "ready_to_battle") {
-        return createJsonResponse("ready_to_battle", "success", "Ready status received");
-    }
-
-    qDebug() << "Unknown command type:" << type;
-    return createJsonResponse("error", "error", "Unknown command");
+// Сериализация готового сообщения в одну строку протокола
+QByteArray createJsonMessage(const QJsonObject &jsonObj) {
+    return QJsonDocument(jsonObj).toJson(QJsonDocument::Compact) + "\r\n";
 }
 
-bool parseRegisterData(const QString &data, QString &nickname, QString &email, QString &password) {
-    QJsonDocument doc = QJsonDocument::fromJson(data.toUtf8());
-    if (!doc.isObject()) return false;
-
-    QJsonObject jsonObj = doc.object();
-    if (!jsonObj.contains("nickname") || !jsonObj.contains("email") || !jsonObj.contains("password")) return false;
-
-    nickname = jsonObj["nickname"].toString();
-    email = jsonObj["email"].toString();
-    password = jsonObj["password"].toString();
-
-    if (nickname.isEmpty() || email.isEmpty() || password.isEmpty()) return false;
-
-    qDebug() << "Parsed register data - Nickname:" << nickname << "Email:" << email << "Password:" << password;
-    return true;
-}
-
-bool parseLoginData(const QString &data, QString &nickname, QString &password) {
-    QJsonDocument doc = QJsonDocument::fromJson(data.toUtf8());
-    if (!doc.isObject()) return false;
-
-    QJsonObject jsonObj = doc.object();
-    if (!jsonObj.contains("nickname") || !jsonObj.contains("password")) return false;
-
-    nickname = jsonObj["nickname"].toString();
-    password = jsonObj["password"].toString();
-
-    if (nickname.isEmpty() || password.isEmpty()) return false;
+// Функция маршрутизации команд
+QByteArray parse(const Request &request, MyTcpServer *server, PlayerId *authenticated) {
+    switch (request.type) {
+    case Request::Register:
+        return handleRegister(request, authenticated);
+    case Request::Login:
+        return slotLogin(request, server, authenticated);
+    case Request::StartGame:
+        return handleStartGame(request, server);
+    case Request::PlaceShip:
+        return handlePlaceShip(request, server);
+    case Request::PlaceFleet:
+        return handlePlaceFleet(request, server);
+    case Request::ReadyToBattle:
+        return handleReadyToBattle(request, server);
+    case Request::MakeMove:
+        return handleMakeMove(request, server);
+    case Request::Stats:
+        return handleStats(server);
+    case Request::Resume:
+        return handleResume(request, server);
+    case Request::Hello: // Согласуется воркером соединения
+    case Request::Unknown:
+    case Request::TypeCount:
+        break;
+    }
 
-    qDebug() << "Parsed login data - Nickname:" << nickname << "Password:" << password;
-    return true;
+    LOG_DEBUG("Unknown command type: %1", request.typeName);
+    return createJsonResponse("error", "error", "Unknown command");
 }
 
-QByteArray handleRegister(const QString &data) {
-    QString nickname, email, password;
-    if (!parseRegisterData(data, nickname, email, password)) {
+QByteArray handleRegister(const Request &request, PlayerId *authenticated) {
+    if (!request.has(Request::NicknameField | Request::EmailField | Request::PasswordField) ||
+        request.nickname.isEmpty() || request.email.isEmpty() || request.password.isEmpty()) {
         return createJsonResponse("register", "error", "Invalid registration data");
     }
 
     DatabaseManager *db = DatabaseManager::getInstance();
     QSqlDatabase database = db->getDatabase();
     if (!database.isOpen()) {
-        qDebug() << "Database is not open in handleRegister";
+        LOG_ERROR("Database is not open in handleRegister");
         return createJsonResponse("register", "error", "Database is not open");
     }
 
-    QSqlQuery query(database);
-    query.prepare("SELECT COUNT(*) FROM User WHERE nickname = :nickname OR email = :email");
-    query.bindValue(":nickname", nickname);
-    query.bindValue(":email", email);
-
-    qDebug() << "Executing query in handleRegister: SELECT COUNT(*) FROM User WHERE nickname =" << nickname << "OR email =" << email;
+    QSqlQuery &query = db->statement("SELECT COUNT(*) FROM User WHERE nickname = :nickname OR email = :email");
+    query.bindValue(":nickname", request.nickname);
+    query.bindValue(":email", request.email);
 
     if (!query.exec()) {
-        qDebug() << "Database query failed (SELECT) in handleRegister:" << query.lastError().text();
+        LOG_WARNING("Database query failed (SELECT) in handleRegister: %1", query.lastError().text());
         return createJsonResponse("register", "error", "Database query failed");
     }
 
     query.next();
-    if (query.value(0).toInt() > 0) {
+    bool exists = query.value(0).toInt() > 0;
+    query.finish();
+    if (exists) {
         return createJsonResponse("register", "error", "User already exists");
     }
 
-    bool success = db->addUser(nickname, email, password);
-    if (success) {
-        return createJsonResponse("register", "success", "User registered successfully");
-    } else {
+    if (!db->addUser(request.nickname, request.email, request.password)) {
         return createJsonResponse("register", "error", "Registration failed");
     }
+    // Никнейм интернируется только для созданного аккаунта, дальше сервер адресует игрока по ID
+    PlayerId player = db->internPlayer(request.nickname);
+    if (player == NoPlayer) {
+        return createJsonResponse("register", "error", "Database error");
+    }
+    if (authenticated) {
+        *authenticated = player;
+    }
+
+    QJsonObject responseObj;
+    responseObj["type"] = "register";
+    responseObj["status"] = "success";
+    responseObj["message"] = "User registered successfully";
+    responseObj["nickname"] = request.nickname;
+    return createJsonMessage(responseObj);
 }
 
-QByteArray slotLogin(const QString &data) {
-    QString nickname, password;
-    if (!parseLoginData(data, nickname, password)) {
+QByteArray slotLogin(const Request &request, MyTcpServer *server, PlayerId *authenticated) {
+    if (!request.has(Request::NicknameField | Request::PasswordField) ||
+        request.nickname.isEmpty() || request.password.isEmpty()) {
         return createJsonResponse("login", "error", "Invalid login data");
     }
 
     DatabaseManager *db = DatabaseManager::getInstance();
     QSqlDatabase database = db->getDatabase();
     if (!database.isOpen()) {
-        qDebug() << "Database is not open in slotLogin";
+        LOG_ERROR("Database is not open in slotLogin");
         return createJsonResponse("login", "error", "Database is not open");
     }
 
-    QSqlQuery query(database);
-    query.prepare("SELECT * FROM User WHERE nickname = :nickname AND password = :password");
-    query.bindValue(":nickname", nickname);
-    query.bindValue(":password", password);
-
-    qDebug() << "Executing query in slotLogin: SELECT * FROM User WHERE nickname =" << nickname << "AND password =" << password;
+    QSqlQuery &query = db->statement("SELECT nickname FROM User WHERE nickname = :nickname AND password = :password");
+    query.bindValue(":nickname", request.nickname);
+    query.bindValue(":password", request.password);
 
     if (!query.exec()) {
-        qDebug() << "Database query failed (SELECT) in slotLogin:" << query.lastError().text();
+        LOG_WARNING("Database query failed (SELECT) in slotLogin: %1", query.lastError().text());
         return createJsonResponse("login", "error", "Database query failed");
     }
 
-    if (query.next()) {
-        qDebug() << "Login successful";
-        return createJsonResponse("login", "success", "Login successful");
-    } else {
-        qDebug() << "Login error";
+    bool found = query.next();
+    query.finish();
+    if (!found) {
+        LOG_INFO("Login error");
         return createJsonResponse("login", "error", "Invalid nickname or password");
     }
-}
 
-QByteArray handleStartGame(const QString &data, MyTcpServer *server) {
-    QJsonDocument doc = QJsonDocument::fromJson(data.toUtf8());
-    if (!doc.isObject()) {
-        return createJsonResponse("start_game", "error", "Invalid JSON format");
+    // Пароль проверен: только теперь игрок получает ID и соединение может быть привязано к нему
+    PlayerId player = db->internPlayer(request.nickname);
+    if (player == NoPlayer) {
+        return createJsonResponse("login", "error", "Database error");
+    }
+    if (authenticated) {
+        *authenticated = player;
     }
 
-    QJsonObject jsonObj = doc.object();
-    QString nickname = jsonObj["nickname"].toString();
-    if (nickname.isEmpty()) {
+    LOG_DEBUG("Login successful");
+    QJsonObject responseObj;
+    responseObj["type"] = "login";
+    responseObj["status"] = "success";
+    responseObj["message"] = "Login successful";
+    responseObj["nickname"] = request.nickname;
+    // С этим токеном клиент вернётся в свою игру после обрыва связи
+    responseObj["resume_token"] = server->issueResumeToken(player);
+    return createJsonMessage(responseObj);
+}
+
+QByteArray handleStartGame(const Request &request, MyTcpServer *server) {
+    PlayerId player = request.playerId;
+    if (request.nickname.isEmpty() || player == NoPlayer) {
         return createJsonResponse("start_game", "error", "Missing nickname");
     }
 
@@ -191,26 +166,21 @@ QByteArray handleStartGame(const QString &data, MyTcpServer *server) {
         return createJsonResponse("start_game", "error", "Server error");
     }
 
-    server->addPlayerToGame(nickname);
-    if (server->getPlayerCount() == 2) {
-        QString opponent = server->getOpponent(nickname);
-        DatabaseManager *db = DatabaseManager::getInstance();
-        int gameId = db->createGame(nickname, opponent);
-        if (gameId != -1) {
-            server->currentGameId = gameId;
-            QJsonObject responseObj;
-            responseObj["type"] = "game_ready";
-            responseObj["status"] = "success";
-            responseObj["message"] = "Please place your ships and confirm readiness";
-            responseObj["game_id"] = gameId;
-            responseObj["opponent"] = opponent;
-            QByteArray response = QJsonDocument(responseObj).toJson(QJsonDocument::Compact) + "\r\n";
-            server->sendMessageToUser(nickname, response);
-
-            responseObj["opponent"] = nickname;
-            response = QJsonDocument(responseObj).toJson(QJsonDocument::Compact) + "\r\n";
-            server->sendMessageToUser(opponent, response);
-        } else {
+    if (server->isInGame(player)) {
+        return createJsonResponse("start_game", "waiting", "Waiting for opponent");
+    }
+
+    Matchmaker &matchmaker = server->getMatchmaker();
+    Matchmaker::Match match;
+    if (matchmaker.join(player, request.rating, match) == Matchmaker::Matched) {
+        LOG_DEBUG("Paired player %1 with player %2 after %3 ms", match.first, match.second, match.waitedMs);
+        if (startMatchedGame(match.first, match.second, server) == -1) {
+            // Возвращаем соперника в ожидание
+            if (match.first == player) {
+                matchmaker.requeue(match.second, match.secondRating);
+            } else {
+                matchmaker.requeue(match.first, match.firstRating);
+            }
             return createJsonResponse("start_game", "error", "Failed to create game");
         }
     }
@@ -218,30 +188,48 @@ QByteArray handleStartGame(const QString &data, MyTcpServer *server) {
     return createJsonResponse("start_game", "waiting", "Waiting for opponent");
 }
 
-QByteArray handlePlaceShip(const QString &data, MyTcpServer *server) {
-    QJsonDocument doc = QJsonDocument::fromJson(data.toUtf8());
-    if (!doc.isObject()) {
-        return createJsonResponse("place_ship", "error", "Invalid JSON format");
+int startMatchedGame(PlayerId first, PlayerId second, MyTcpServer *server) {
+    DatabaseManager *db = DatabaseManager::getInstance();
+    int gameId = db->createGame(first, second);
+    if (gameId == -1) {
+        return -1;
     }
+    // Первым ходит тот, кто дольше ждал
+    server->createSession(gameId, first, second);
+    // Имена нужны только в ответах клиентам
+    QJsonObject responseObj;
+    responseObj["type"] = "game_ready";
+    responseObj["status"] = "success";
+    responseObj["message"] = "Please place your ships and confirm readiness";
+    responseObj["game_id"] = gameId;
+    responseObj["opponent"] = db->playerName(first);
+    server->sendMessageToUser(second, createJsonMessage(responseObj));
+
+    responseObj["opponent"] = db->playerName(second);
+    server->sendMessageToUser(first, createJsonMessage(responseObj));
+    return gameId;
+}
 
-    QJsonObject jsonObj = doc.object();
-    if (!jsonObj.contains("nickname") || !jsonObj.contains("game_id") || !jsonObj.contains("x") ||
-        !jsonObj.contains("y") || !jsonObj.contains("size") || !jsonObj.contains("is_horizontal")) {
+QByteArray handlePlaceShip(const Request &request, MyTcpServer *server) {
+    if (!request.has(Request::NicknameField | Request::GameIdField | Request::XField |
+                     Request::YField | Request::SizeField | Request::IsHorizontalField)) {
         return createJsonResponse("place_ship", "error", "Missing required fields");
     }
 
-    QString nickname = jsonObj["nickname"].toString();
-    int gameId = jsonObj["game_id"].toInt();
-    int x = jsonObj["x"].toInt();
-    int y = jsonObj["y"].toInt();
-    int size = jsonObj["size"].toInt();
-    bool isHorizontal = jsonObj["is_horizontal"].toBool();
+    const QString &nickname = request.nickname;
+    PlayerId player = request.playerId;
+    int gameId = request.gameId;
+    int x = request.x;
+    int y = request.y;
+    int size = request.size;
+    bool isHorizontal = request.isHorizontal;
 
-    if (nickname.isEmpty()) {
+    if (nickname.isEmpty() || player == NoPlayer) {
         return createJsonResponse("place_ship", "error", "Invalid nickname");
     }
 
-    if (gameId != server->getGameId()) {
+    GameSession *session = server->getSessionByPlayer(player);
+    if (!session || session->getGameId() != gameId) {
         return createJsonResponse("place_ship", "error", "Invalid game ID");
     }
 
@@ -256,77 +244,364 @@ QByteArray handlePlaceShip(const QString &data, MyTcpServer *server) {
         return createJsonResponse("place_ship", "error", "Ship exceeds vertical board limits");
     }
 
-    DatabaseManager *db = DatabaseManager::getInstance();
-    if (db->saveShip(gameId, nickname, x, y, size, isHorizontal)) {
-        qDebug() << "Ship placed successfully for" << nickname << ": game_id=" << gameId
-                 << ", x=" << x << ", y=" << y << ", size=" << size << ", is_horizontal=" << isHorizontal;
-        return createJsonResponse("place_ship", "success", "Ship placed successfully");
-    } else {
-        qDebug() << "Failed to place ship for" << nickname << ": game_id=" << gameId;
-        return createJsonResponse("place_ship", "error", "Failed to place ship");
+    // Поле в памяти - основной источник истины для ходов, БД только сохраняет расстановку
+    GameBoard *board = session->getBoard(player);
+    FleetValidator::Error error = FleetValidator::canPlace(board->getShips(), ShipPlacement{x, y, size, isHorizontal});
+    if (error != FleetValidator::Ok) {
+        return createJsonResponse("place_ship", "error", FleetValidator::errorMessage(error));
     }
+    // Лишний корабль одного размера не даст собрать флот 1x4, 2x3, 3x2, 4x1, и игра не начнётся
+    int sameSize = 0;
+    for (const ShipPlacement &ship : board->getPlacements()) {
+        if (ship.size == size) {
+            ++sameSize;
+        }
+    }
+    if (sameSize >= FleetValidator::requiredCount(size)) {
+        return createJsonResponse("place_ship", "error", "Too many ships of this size");
+    }
+    if (!board->placeShip(x, y, size, isHorizontal)) {
+        return createJsonResponse("place_ship", "error", "Fleet is full");
+    }
+
+    DatabaseManager::getInstance()->enqueueShip(gameId, player, x, y, size, isHorizontal);
+    LOG_TRACE("Ship placed successfully for %1: game_id=%2, x=%3, y=%4, size=%5, is_horizontal=%6",
+              nickname, gameId, x, y, size, isHorizontal);
+    return createJsonResponse("place_ship", "success", "Ship placed successfully");
 }
 
-QByteArray handleMakeMove(const QString &data, MyTcpServer *server) {
-    QJsonDocument doc = QJsonDocument::fromJson(data.toUtf8());
-    if (!doc.isObject()) {
-        return createJsonResponse("make_move", "error", "Invalid JSON format");
+QByteArray handlePlaceFleet(const Request &request, MyTcpServer *server) {
+    if (!request.has(Request::NicknameField | Request::GameIdField | Request::ShipsField)) {
+        return createJsonResponse("place_fleet", "error", "Missing required fields");
     }
 
-    QJsonObject jsonObj = doc.object();
-    if (!jsonObj.contains("nickname") || !jsonObj.contains("game_id") || !jsonObj.contains("x") || !jsonObj.contains("y")) {
-        return createJsonResponse("make_move", "error", "Missing required fields");
+    const QString &nickname = request.nickname;
+    PlayerId player = request.playerId;
+    GameSession *session = server->getSessionByPlayer(player);
+    if (player == NoPlayer || !session || session->getGameId() != request.gameId) {
+        return createJsonResponse("place_fleet", "error", "Invalid game ID");
     }
 
-    QString nickname = jsonObj["nickname"].toString();
-    int gameId = jsonObj["game_id"].toInt();
-    int x = jsonObj["x"].toInt();
-    int y = jsonObj["y"].toInt();
+    GameBoard *board = session->getBoard(player);
+    if (board->getShipCount() > 0) {
+        return createJsonResponse("place_fleet", "error", "Fleet already placed");
+    }
 
-    if (gameId != server->getGameId()) {
-        return createJsonResponse("make_move", "error", "Invalid game ID");
+    // Флот проверяется целиком (состав, пересечения, касания) и принимается либо отклоняется полностью
+    FleetValidator::Error error = FleetValidator::validate(request.ships);
+    if (error != FleetValidator::Ok) {
+        return createJsonResponse("place_fleet", "error", FleetValidator::errorMessage(error));
+    }
+    for (const ShipPlacement &ship : request.ships) {
+        board->placeShip(ship);
     }
 
-    DatabaseManager *db = DatabaseManager::getInstance();
-    QString currentTurn = db->getCurrentTurn(gameId);
-    if (currentTurn != nickname) {
-        return createJsonResponse("make_move", "error", "Not your turn");
+    DatabaseManager::getInstance()->enqueueFleet(request.gameId, player, request.ships);
+    LOG_DEBUG("Fleet of %1 ships placed for %2 in game %3", request.ships.size(), nickname, request.gameId);
+    return createJsonResponse("place_fleet", "success", "Fleet placed successfully");
+}
+
+QByteArray handleReadyToBattle(const Request &request, MyTcpServer *server) {
+    const QString &nickname = request.nickname;
+    PlayerId player = request.playerId;
+    GameSession *session = server->getSessionByPlayer(player);
+    if (player == NoPlayer || !session) {
+        return createJsonResponse("error", "error", "Player not registered");
     }
 
-    QString result = db->checkMove(gameId, nickname, x, y);
-    if (result == "error") {
-        return createJsonResponse("make_move", "error", "Failed to process move");
+    LOG_DEBUG("Processing ready_to_battle for %1 - gameId: %2", nickname, session->getGameId());
+    // Флот, собранный через place_ship, проверяется на полноту только здесь
+    FleetValidator::Error error = FleetValidator::validate(session->getBoard(player)->getPlacements());
+    if (error != FleetValidator::Ok) {
+        return createJsonResponse("ready_to_battle", "error", FleetValidator::errorMessage(error));
+    }
+    session->setReady(player);
+    if (session->allReady()) {
+        LOG_DEBUG("Both players ready, starting game with gameId: %1", session->getGameId());
+        DatabaseManager *db = DatabaseManager::getInstance();
+        PlayerId player1 = session->getPlayer(0);
+        session->setCurrentTurn(player1);
+        db->enqueueTurn(session->getGameId(), player1);
+        QJsonObject startMsg;
+        startMsg["type"] = "game_start";
+        startMsg["status"] = "success";
+        startMsg["message"] = "Game started";
+        startMsg["current_turn"] = db->playerName(player1);
+        QByteArray startResponse = createJsonMessage(startMsg);
+        server->sendMessageToUser(session->getPlayer(0), startResponse, WireProtocol::encodeGameStart(true));
+        server->sendMessageToUser(session->getPlayer(1), startResponse, WireProtocol::encodeGameStart(false));
+        server->restartTurnClock(session);
     }
+    return createJsonResponse("ready_to_battle", "success", "Ready status received");
+}
 
-    if (result == "already_shot") {
-        return createJsonResponse("make_move", "error", "Cell already shot");
+QByteArray handleMakeMove(const Request &request, MyTcpServer *server) {
+    if (!request.has(Request::NicknameField | Request::GameIdField | Request::XField | Request::YField)) {
+        return createJsonResponse("error", "error", "Missing required fields");
     }
 
-    db->saveMove(gameId, nickname, x, y, result);
+    const QString &nickname = request.nickname;
+    PlayerId player = request.playerId;
+    int gameId = request.gameId;
+    int x = request.x;
+    int y = request.y;
+    LOG_TRACE("Processing make_move for %1 in game %2 at (%3, %4)", nickname, gameId, x, y);
+
+    GameSession *session = server->getSessionByPlayer(player);
+    if (!session || session->getGameId() != gameId) {
+        LOG_WARNING("Move rejected: %1 is not a player of game %2", nickname, gameId);
+        return createJsonResponse("error", "error", "Invalid game ID");
+    }
+    // До game_start очередь хода не определена: выстрел попал бы в поле, на котором ещё расставляют флот
+    if (!session->allReady()) {
+        LOG_WARNING("Move rejected: game %1 has not started yet", gameId);
+        return createJsonResponse("error", "error", "Game has not started yet");
+    }
+
+    // Очередь хода и результат выстрела берутся из состояния сессии в памяти
+    Tracer::Span fireSpan("make_move.fire");
+    PlayerId currentTurn = session->getCurrentTurn();
+    if (currentTurn != player) {
+        LOG_WARNING("Move rejected: not %1's turn, current turn is player %2", nickname, currentTurn);
+        return createJsonResponse("error", "error", "Not your turn");
+    }
 
-    QString opponent = server->getOpponent(nickname);
-    QString nextTurn = (result != "hit" && result != "sunk") ? opponent : nickname;
-    if (result != "hit" && result != "sunk") {
-        db->updateTurn(gameId, opponent);
+    GameBoard::ShotResult shot = session->fire(player, x, y);
+    fireSpan.finish();
+    if (shot == GameBoard::InvalidCell) {
+        return createJsonResponse("error", "error", "Invalid cell coordinates");
+    }
+    if (shot == GameBoard::AlreadyShot) {
+        return createJsonResponse("error", "error", "Cell already shot");
+    }
+    QString result = GameBoard::resultName(shot);
+    LOG_TRACE("Move result for %1: %2", nickname, result);
+
+    // Обновляем current_turn только один раз
+    PlayerId opponent = session->getOpponent(player);
+    PlayerId nextTurn = currentTurn;
+    if (shot == GameBoard::Miss) {
+        nextTurn = opponent;
+        session->setCurrentTurn(opponent);
     }
 
-    QJsonObject response;
-    response["type"] = "make_move";
-    response["status"] = result;
-    response["message"] = result == "sunk" ? "Ship sunk!" : result == "hit" ? "Hit!" : "Miss!";
-    response["x"] = x;
-    response["y"] = y;
-    response["current_turn"] = nextTurn;
+    // БД только фиксирует ход в фоне, решение уже принято
+    Tracer::Span persistSpan("make_move.persist");
+    DatabaseManager *db = DatabaseManager::getInstance();
+    db->enqueueMove(gameId, player, x, y, result);
+    if (shot == GameBoard::Miss) {
+        db->enqueueTurn(gameId, opponent);
+    }
+    persistSpan.finish();
+    // Срок отсчитывается заново на каждый выстрел; при конце игры таймер снимет endSession
+    server->restartTurnClock(session);
+
+    // Клиенту с двоичным протоколом ход уходит кадром в несколько байт, без имён и текста
+    Tracer::Span serializeSpan("make_move.serialize");
+    BoardBlob::ShotCode code = BoardBlob::shotCode(result);
+    QString nextTurnName = nextTurn == player ? nickname : db->playerName(nextTurn);
+    QByteArray response;
+    if (request.binaryReplies) {
+        response = WireProtocol::encodeShot(WireProtocol::MoveResultMessage, x, y, code, nextTurn == player);
+    } else {
+        QJsonObject moveResponse;
+        moveResponse["type"] = "make_move";
+        moveResponse["status"] = result;
+        moveResponse["message"] = "Move processed";
+        moveResponse["x"] = x;
+        moveResponse["y"] = y;
+        moveResponse["current_turn"] = nextTurnName;
+        response = createJsonMessage(moveResponse);
+    }
 
     QJsonObject opponentResponse;
     opponentResponse["type"] = "move_result";
     opponentResponse["status"] = result;
     opponentResponse["x"] = x;
     opponentResponse["y"] = y;
-    opponentResponse["message"] = result == "sunk" ? "Your ship was sunk!" : result == "hit" ? "Your ship was hit!" : "Opponent missed!";
-    opponentResponse["current_turn"] = nextTurn;
+    opponentResponse["message"] = "Opponent made a move";
+    opponentResponse["current_turn"] = nextTurnName;
+    QByteArray opponentJson = createJsonMessage(opponentResponse);
+    QByteArray opponentBinary = WireProtocol::encodeShot(WireProtocol::OpponentMoveMessage, x, y, code, nextTurn == opponent);
+    serializeSpan.finish();
+
+    server->sendMessageToUser(opponent, opponentJson, opponentBinary);
+
+    // Обновляем счётчик потопленных кораблей
+    if (shot == GameBoard::Sunk) {
+        session->addSunkShip(player);
+    }
+    if (session->getBoard(opponent)->allSunk()) {
+        QJsonObject gameOverMsg;
+        gameOverMsg["type"] = "game_over";
+        gameOverMsg["status"] = "success";
+        gameOverMsg["message"] = QString("%1 победил! Игра окончена.").arg(nickname);
+        gameOverMsg["winner"] = nickname;
+        QByteArray gameOverResponse = createJsonMessage(gameOverMsg);
+
+        // Победитель получает game_over вслед за ответом на ход, соперник - вслед за move_result
+        response += request.binaryReplies ? WireProtocol::encodeJson(gameOverResponse) : gameOverResponse;
+        server->sendMessageToUser(opponent, gameOverResponse);
+        LOG_DEBUG("Game over: %1 has sunk the whole fleet. Sent game_over to both players.", nickname);
+
+        server->endSession(session);
+    }
+
+    return response;
+}
+
+void handleTurnTimeout(int gameId, MyTcpServer *server) {
+    GameSession *session = server->getSession(gameId);
+    if (!session) {
+        return;
+    }
+    session->setTurnTimer(0);
+    DatabaseManager *db = DatabaseManager::getInstance();
+    PlayerId late = session->getCurrentTurn();
+    PlayerId opponent = session->getOpponent(late);
+    QString lateName = db->playerName(late);
+    QString opponentName = db->playerName(opponent);
+
+    if (server->getTurnTimeoutAction() == MyTcpServer::PassOnTimeout) {
+        session->setCurrentTurn(opponent);
+        db->enqueueTurn(gameId, opponent);
+        QJsonObject timeoutMsg;
+        timeoutMsg["type"] = "turn_timeout";
+        timeoutMsg["status"] = "success";
+        timeoutMsg["message"] = QString("%1 не успел походить, ход переходит сопернику").arg(lateName);
+        timeoutMsg["current_turn"] = opponentName;
+        QByteArray timeoutResponse = createJsonMessage(timeoutMsg);
+        server->sendMessageToUser(late, timeoutResponse);
+        server->sendMessageToUser(opponent, timeoutResponse);
+        LOG_DEBUG("Turn timeout in game %1: turn passed from %2 to %3", gameId, lateName, opponentName);
+        server->restartTurnClock(session);
+        return;
+    }
+
+    QJsonObject gameOverMsg;
+    gameOverMsg["type"] = "game_over";
+    gameOverMsg["status"] = "success";
+    gameOverMsg["message"] = QString("%1 не успел походить. %2 победил! Игра окончена.").arg(lateName, opponentName);
+    gameOverMsg["winner"] = opponentName;
+    gameOverMsg["reason"] = "turn_timeout";
+    QByteArray gameOverResponse = createJsonMessage(gameOverMsg);
+    server->sendMessageToUser(late, gameOverResponse);
+    server->sendMessageToUser(opponent, gameOverResponse);
+    LOG_DEBUG("Game over by turn timeout in game %1: %2 forfeits", gameId, lateName);
+    server->endSession(session);
+}
+
+// Полное состояние сессии глазами игрока: свой флот, выстрелы обеих сторон, очередь хода и счёт.
+// Поля передаются масками BoardBlob (по 16 байт) в base64; флот соперника не раскрывается
+static QByteArray createSessionSnapshot(GameSession *session, PlayerId player) {
+    DatabaseManager *db = DatabaseManager::getInstance();
+    PlayerId opponent = session->getOpponent(player);
+    GameBoard *own = session->getBoard(player);
+    GameBoard *enemy = session->getBoard(opponent);
+
+    QByteArray boards;
+    boards += BoardBlob::encodeMask(own->getShots()); // Выстрелы соперника по нашему полю
+    boards += BoardBlob::encodeMask(own->getSunkCells());
+    boards += BoardBlob::encodeMask(enemy->getShots()); // Наши выстрелы
+    boards += BoardBlob::encodeMask(enemy->getShots() & enemy->getShips()); // Наши попадания
+    boards += BoardBlob::encodeMask(enemy->getSunkCells());
+
+    QJsonObject snapshotMsg;
+    snapshotMsg["type"] = "session_snapshot";
+    snapshotMsg["status"] = "success";
+    snapshotMsg["game_id"] = session->getGameId();
+    snapshotMsg["opponent"] = db->playerName(opponent);
+    snapshotMsg["phase"] = session->allReady() ? "battle" : "placement";
+    snapshotMsg["ready"] = session->isReady(player);
+    if (session->allReady()) {
+        snapshotMsg["current_turn"] = db->playerName(session->getCurrentTurn());
+    }
+    snapshotMsg["fleet"] = QString::fromLatin1(BoardBlob::encodeFleet(own->getPlacements()).toBase64());
+    snapshotMsg["boards"] = QString::fromLatin1(boards.toBase64());
+    snapshotMsg["sunk"] = session->getSunkShips(player);
+    snapshotMsg["lost"] = session->getSunkShips(opponent);
+    return createJsonMessage(snapshotMsg);
+}
 
-    server->sendMessageToUser(opponent, QJsonDocument(opponentResponse).toJson(QJsonDocument::Compact) + "\r\n");
+QByteArray handleResume(const Request &request, MyTcpServer *server) {
+    // Токен уже проверен воркером соединения, игрок привязан к новому соединению
+    PlayerId player = request.playerId;
+    if (player == NoPlayer) {
+        return createJsonResponse("resume", "error", "Invalid resume token");
+    }
+
+    QJsonObject responseObj;
+    responseObj["type"] = "resume";
+    responseObj["status"] = "success";
+    responseObj["message"] = "Session resumed";
+    responseObj["nickname"] = request.nickname;
+    responseObj["resume_token"] = server->issueResumeToken(player);
+    QByteArray response = createJsonMessage(responseObj);
+
+    GameSession *session = server->getSessionByPlayer(player);
+    if (!session) {
+        return response;
+    }
+    server->endGrace(session, player);
+    response += createSessionSnapshot(session, player);
+
+    QJsonObject statusMsg;
+    statusMsg["type"] = "opponent_status";
+    statusMsg["status"] = "reconnected";
+    statusMsg["message"] = "Opponent reconnected";
+    server->sendMessageToUser(session->getOpponent(player), createJsonMessage(statusMsg));
+    LOG_DEBUG("Player %1 resumed game %2", request.nickname, session->getGameId());
+    return response;
+}
 
-    return QJsonDocument(response).toJson(QJsonDocument::Compact) + "\r\n";
+QByteArray handleStats(MyTcpServer *server) {
+    DatabaseManager *db = DatabaseManager::getInstance();
+    QJsonObject responseObj;
+    responseObj["type"] = "stats";
+    responseObj["status"] = "success";
+    responseObj["sessions"] = server->getSessionCount();
+    responseObj["workers"] = server->getWorkerCount();
+    responseObj["timers"] = server->getTimerCount();
+    // Сколько сообщений ушло и за сколько записей в сокеты; что сделано с сообщениями медленным клиентам
+    OutboundStats outbound = server->getOutboundStats();
+    responseObj["messages_sent"] = outbound.messagesSent;
+    responseObj["socket_writes"] = outbound.socketWrites;
+    responseObj["dropped_messages"] = outbound.dropped;
+    responseObj["coalesced_messages"] = outbound.coalesced;
+    responseObj["slow_disconnects"] = outbound.slowDisconnects;
+    responseObj["db_connections"] = db->getConnectionCount();
+    responseObj["players"] = db->getPlayerCount();
+    // Очередь подбора: сколько ждут сейчас, сколько пар составлено и гистограммы (границы корзин 1, 2, 4, ... мс / игроков)
+    Matchmaker &matchmaker = server->getMatchmaker();
+    responseObj["queue_depth"] = matchmaker.depth();
+    responseObj["matches_made"] = matchmaker.getMatchesMade();
+    QJsonArray waits;
+    for (qint64 count : matchmaker.waitHistogram()) {
+        waits.append(count);
+    }
+    responseObj["queue_wait_ms_histogram"] = waits;
+    QJsonArray depths;
+    for (qint64 count : matchmaker.depthHistogram()) {
+        depths.append(count);
+    }
+    responseObj["queue_depth_histogram"] = depths;
+    responseObj["pending_writes"] = db->pendingWrites();
+    // Сколько раз запрос взят из кэша и сколько раз он компилировался
+    responseObj["statement_hits"] = db->getStatementHits();
+    responseObj["statement_compiles"] = db->getStatementCompiles();
+    // Зависания циклов событий по тому, что в них выполнялось, и лаг циклов (границы корзин 1, 2, 4, ... мс)
+    LoopWatchdog &watchdog = LoopWatchdog::getInstance();
+    responseObj["event_loop_stalls"] = watchdog.getStallCount();
+    QJsonObject stallsByActivity;
+    const QHash<QByteArray, qint64> stalls = watchdog.stallsByActivity();
+    for (auto it = stalls.cbegin(); it != stalls.cend(); ++it) {
+        stallsByActivity[QString::fromUtf8(it.key())] = it.value();
+    }
+    responseObj["event_loop_stalls_by_activity"] = stallsByActivity;
+    QJsonArray lags;
+    for (qint64 count : watchdog.lagHistogram()) {
+        lags.append(count);
+    }
+    responseObj["event_loop_lag_ms_histogram"] = lags;
+    return createJsonMessage(responseObj);
 }
@@ -3,18 +3,30 @@
 
 #include <QByteArray>
 #include <QString>
+#include "PlayerRegistry.h"
 
-// Функция обработки запросов
-QByteArray parse(const QString &input, class MyTcpServer *server);
+struct Request;
+class QJsonObject;
+
+// Функция обработки запросов. После успешных register и login в authenticated записывается
+// ID вошедшего игрока: только тогда соединение можно привязать к нему
+QByteArray parse(const Request &request, class MyTcpServer *server, PlayerId *authenticated = nullptr);
 
 // Функции работы с БД и игрой
-bool parseRegisterData(const QString &data, QString &nickname, QString &email, QString &password);
-bool parseLoginData(const QString &data, QString &nickname, QString &password);
-QByteArray handleRegister(const QString &data);
-QByteArray slotLogin(const QString &data);
-QByteArray handleStartGame(const QString &data, MyTcpServer *server);
-QByteArray handlePlaceShip(const QString &data, MyTcpServer *server);
-QByteArray handleMakeMove(const QString &data, MyTcpServer *server);
+QByteArray handleRegister(const Request &request, PlayerId *authenticated);
+QByteArray slotLogin(const Request &request, MyTcpServer *server, PlayerId *authenticated);
+QByteArray handleStartGame(const Request &request, MyTcpServer *server);
+QByteArray handlePlaceShip(const Request &request, MyTcpServer *server);
+QByteArray handlePlaceFleet(const Request &request, MyTcpServer *server);
+QByteArray handleReadyToBattle(const Request &request, MyTcpServer *server);
+QByteArray handleMakeMove(const Request &request, MyTcpServer *server);
+QByteArray handleStats(MyTcpServer *server);
+QByteArray handleResume(const Request &request, MyTcpServer *server);
+// Создаёт игру для пары из очереди и рассылает game_ready; возвращает ID игры или -1
+int startMatchedGame(PlayerId first, PlayerId second, MyTcpServer *server);
+// Истёк срок хода в игре gameId; вызывается из колеса таймеров воркера сессии
+void handleTurnTimeout(int gameId, MyTcpServer *server);
 QByteArray createJsonResponse(const QString &type, const QString &status, const QString &message);
+QByteArray createJsonMessage(const QJsonObject &jsonObj);
 
 #endif // FUNC2SERV_H
@@ -1,9 +1,150 @@
 #include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QThread>
 #include "mytcpserver.h"
+#include "DatabaseManager.h"
+#include "MetricsServer.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include "LoopWatchdog.h"
+#include "ShutdownSignals.h"
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
-    MyTcpServer myserv;
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption batchSizeOption("db-batch-size", "Max writes per background DB transaction.", "count", "256");
+    QCommandLineOption batchDelayOption("db-batch-delay", "Max delay (ms) before a background DB batch is committed.", "ms", "20");
+    QCommandLineOption workersOption("workers", "Number of worker threads serving connections and games.", "count",
+                                     QString::number(QThread::idealThreadCount()));
+    QCommandLineOption storageOption("db-storage", "How fleets and shots are stored: rows (Ship/Move tables) or blob (PlayerBoard).",
+                                     "layout", "rows");
+    QCommandLineOption databaseOption("database", "SQLite database file, or a URI such as file:seabattle?mode=memory&cache=shared.",
+                                      "path", "server_db.sqlite");
+    parser.addOption(databaseOption);
+    parser.addOption(batchSizeOption);
+    parser.addOption(batchDelayOption);
+    parser.addOption(workersOption);
+    QCommandLineOption highWatermarkOption("send-high-watermark", "Unsent bytes per connection at which it is treated as slow.",
+                                           "bytes", "1048576");
+    QCommandLineOption lowWatermarkOption("send-low-watermark", "Unsent bytes per connection at which a slow connection recovers.",
+                                          "bytes", "262144");
+    QCommandLineOption slowPolicyOption("slow-consumer-policy",
+                                        "What to do with messages to a slow connection, per class (essential, state, best_effort): "
+                                        "disconnect, coalesce or drop.",
+                                        "policies", "essential=disconnect,state=coalesce,best_effort=drop");
+    QCommandLineOption matchBandOption("match-rating-band",
+                                       "Rating band width for matchmaking; 0 pairs players strictly in arrival order.", "points", "0");
+    QCommandLineOption matchWidenOption("match-widen-rate", "How much the allowed rating gap grows per second of waiting.",
+                                        "points", "50");
+    QCommandLineOption idleTimeoutOption("idle-timeout", "Seconds without data from a client outside the queue and games before its connection is closed; 0 disables.",
+                                         "seconds", "600");
+    QCommandLineOption turnTimeoutOption("turn-timeout", "Seconds a player has for each shot; 0 disables.", "seconds", "120");
+    QCommandLineOption resumeGraceOption("resume-grace", "Seconds a game waits for a disconnected player to resume; 0 ends it at once.",
+                                         "seconds", "30");
+    QCommandLineOption metricsPortOption("metrics-port", "Local port for the Prometheus /metrics endpoint; 0 disables it.",
+                                         "port", "33334");
+    QCommandLineOption logLevelOption("log-level", "Minimum log level: trace, debug, info, warning, error or off.", "level", "info");
+    QCommandLineOption traceRateOption("trace-sample-rate",
+                                       "Fraction of requests recorded as Chrome trace events (0..1); 0 disables tracing.", "rate", "0");
+    QCommandLineOption traceFileOption("trace-file", "File the collected trace is written to on shutdown (Ctrl+C or SIGTERM); also served at /trace.", "path");
+    QCommandLineOption stallThresholdOption("stall-threshold",
+                                            "Milliseconds an event loop may stay blocked before it is reported as stalled; 0 disables.",
+                                            "ms", "200");
+    QCommandLineOption turnActionOption("turn-timeout-action", "What happens when a turn times out: forfeit or pass.",
+                                        "action", "forfeit");
+    parser.addOption(storageOption);
+    parser.addOption(highWatermarkOption);
+    parser.addOption(lowWatermarkOption);
+    parser.addOption(slowPolicyOption);
+    parser.addOption(matchBandOption);
+    parser.addOption(matchWidenOption);
+    parser.addOption(idleTimeoutOption);
+    parser.addOption(turnTimeoutOption);
+    parser.addOption(turnActionOption);
+    parser.addOption(resumeGraceOption);
+    parser.addOption(metricsPortOption);
+    parser.addOption(logLevelOption);
+    parser.addOption(traceRateOption);
+    parser.addOption(traceFileOption);
+    parser.addOption(stallThresholdOption);
+    parser.process(a);
+
+    Logger::Level logLevel;
+    if (!Logger::parseLevel(parser.value(logLevelOption), logLevel)) {
+        LOG_ERROR("Invalid --log-level value: %1", parser.value(logLevelOption));
+        return 1;
+    }
+    Logger::setLevel(logLevel);
+
+    OutboundLimits limits;
+    limits.highWatermark = qMax<qint64>(1, parser.value(highWatermarkOption).toLongLong());
+    limits.lowWatermark = qBound<qint64>(0, parser.value(lowWatermarkOption).toLongLong(), limits.highWatermark);
+    if (!limits.parsePolicies(parser.value(slowPolicyOption))) {
+        LOG_ERROR("Invalid --slow-consumer-policy value: %1", parser.value(slowPolicyOption));
+        return 1;
+    }
+    QString turnAction = parser.value(turnActionOption);
+    if (turnAction != "forfeit" && turnAction != "pass") {
+        LOG_ERROR("Invalid --turn-timeout-action value: %1", turnAction);
+        return 1;
+    }
+
+    // Дальше журнал пишется отдельным потоком; сообщения Qt и оставшиеся qDebug() идут туда же
+    Logger &logger = Logger::getInstance();
+    logger.installMessageHandler();
+    logger.startDraining();
+
+    // Сторож следит за циклами воркеров и главного потока (приём соединений, /metrics)
+    LoopWatchdog &watchdog = LoopWatchdog::getInstance();
+    watchdog.setStallThreshold(parser.value(stallThresholdOption).toLongLong());
+    watchdog.watchCurrentThread(&a, "main");
+    watchdog.startWatching();
+    // Снимается первым: остановка сервера и запись хвоста очереди БД законно блокируют главный поток
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, [&watchdog]() {
+        watchdog.unwatchCurrentThread();
+        watchdog.stop();
+    });
+
+    DatabaseManager::setDatabaseName(parser.value(databaseOption));
+    DatabaseManager *db = DatabaseManager::getInstance();
+    db->configurePersistence(parser.value(batchSizeOption).toInt(), parser.value(batchDelayOption).toInt());
+    db->setBlobStorage(parser.value(storageOption) == "blob");
+    Tracer::getInstance().setSampleRate(parser.value(traceRateOption).toDouble());
+
+    MyTcpServer myserv(parser.value(workersOption).toInt());
+    myserv.setOutboundLimits(limits);
+    Matchmaker::Config matchConfig;
+    matchConfig.bandWidth = parser.value(matchBandOption).toInt();
+    matchConfig.widenPerSecond = parser.value(matchWidenOption).toInt();
+    myserv.configureMatchmaking(matchConfig);
+    myserv.setTimeouts(parser.value(idleTimeoutOption).toLongLong() * 1000, parser.value(turnTimeoutOption).toLongLong() * 1000,
+                       turnAction == "pass" ? MyTcpServer::PassOnTimeout : MyTcpServer::ForfeitOnTimeout);
+    myserv.setResumeGrace(parser.value(resumeGraceOption).toLongLong() * 1000);
+
+    // Порядок остановки: воркеры (больше никаких ходов и записей), затем хвост очереди записи в БД,
+    // трассировка и журнал. aboutToQuit приходит, когда Ctrl+C или SIGTERM вызывают quit() через ShutdownSignals
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, &myserv, &MyTcpServer::stop, Qt::DirectConnection);
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, [db]() { db->shutdown(); });
+    // Трассировка пишется после остановки воркеров, чтобы в файл попали события последних ходов
+    QString traceFile = parser.value(traceFileOption);
+    if (!traceFile.isEmpty()) {
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, [traceFile]() {
+            if (!Tracer::getInstance().writeFile(traceFile, true)) {
+                LOG_ERROR("Failed to write trace to %1", traceFile);
+            }
+        });
+    }
+    // Журнал останавливается последним; записи после остановки пишутся сразу
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, &logger, &Logger::stop, Qt::DirectConnection);
+    ShutdownSignals::install();
+
+    MetricsServer metrics;
+    quint16 metricsPort = quint16(parser.value(metricsPortOption).toUInt());
+    if (metricsPort != 0) {
+        metrics.start(metricsPort);
+    }
     return a.exec();
 }
@@ -1,349 +1,430 @@
 #include "mytcpserver.h"
-#include "func2serv.h"
 #include "DatabaseManager.h"
-#include <QDebug>
-#include <QJsonDocument>
+#include "func2serv.h"
+#include "GameSession.h"
+#include "ServerWorker.h"
+#include "Request.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include "LoopWatchdog.h"
 #include <QJsonObject>
+#include <QRandomGenerator>
+
+namespace {
+
+struct ServerMetrics
+{
+    // Время от разбора запроса до готового ответа, включая ожидание в очереди воркера сессии
+    Metrics::Histogram *latency[Request::TypeCount];
+
+    ServerMetrics()
+    {
+        for (int type = 0; type < Request::TypeCount; ++type) {
+            latency[type] = Metrics::getInstance().histogram(
+                "seabattle_request_duration_seconds", "Time from decoding a request to its response being queued.",
+                QString("type=\"%1\"").arg(Request::typeLabel(Request::Type(type))));
+        }
+    }
+};
 
-MyTcpServer::MyTcpServer(QObject *parent) : QObject(parent), currentGameId(-1)
+const ServerMetrics &metrics()
 {
-    mTcpServer = new QTcpServer(this);
-    connect(mTcpServer, &QTcpServer::newConnection, this, &MyTcpServer::slotNewConnection);
+    static const ServerMetrics instance;
+    return instance;
+}
+
+} // namespace
 
-    if (!mTcpServer->listen(QHostAddress::Any, 33333)) {
-        qDebug() << "Server is NOT started!";
+MyTcpServer::MyTcpServer(int workerCount, QObject *parent) : QTcpServer(parent)
+{
+    workerCount = qMax(1, workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        ServerWorker *worker = new ServerWorker(i, this);
+        worker->start();
+        mWorkers.append(worker);
+    }
+    connect(&mMatchTimer, &QTimer::timeout, this, &MyTcpServer::sweepMatchmaking);
+
+    // Значения, которые сервер и так хранит, снимаются в момент запроса метрик
+    Metrics &registry = Metrics::getInstance();
+    registry.gauge("seabattle_sessions", "Active game sessions.", [this]() { return double(getSessionCount()); });
+    registry.gauge("seabattle_matchmaking_queue_depth", "Players waiting for an opponent.",
+                   [this]() { return double(mMatchmaker.depth()); });
+    registry.gauge("seabattle_timers", "Pending turn, grace and idle timers.", [this]() { return double(getTimerCount()); });
+
+    if (!listen(QHostAddress::Any, 33333)) {
+        LOG_ERROR("Server is NOT started!");
     } else {
-        qDebug() << "Server is started!";
+        LOG_INFO("Server is started with %1 workers!", workerCount);
     }
 }
 
 MyTcpServer::~MyTcpServer()
 {
-    mTcpServer->close();
+    stop();
+    qDeleteAll(mWorkers);
+    qDeleteAll(mSessions);
 }
 
-void MyTcpServer::slotNewConnection()
+void MyTcpServer::stop()
 {
-    QTcpSocket *clientSocket = mTcpServer->nextPendingConnection();
-    if (clientSocket) {
-        if (getPlayerCount() >= 2) {
-            QByteArray response = createJsonResponse("error", "error", "Server is full");
-            clientSocket->write(response);
-            clientSocket->flush();
-            clientSocket->disconnectFromHost();
-            return;
-        }
+    close();
+    mMatchTimer.stop();
+    for (ServerWorker *worker : std::as_const(mWorkers)) {
+        worker->stop();
+    }
+}
 
-        connect(clientSocket, &QTcpSocket::readyRead, this, &MyTcpServer::slotServerRead);
-        connect(clientSocket, &QTcpSocket::disconnected, this, &MyTcpServer::slotClientDisconnected);
-        qDebug() << "New client connected from" << clientSocket->peerAddress().toString();
+void MyTcpServer::incomingConnection(qintptr socketDescriptor)
+{
+    // Сокет создаёт сам воркер, чтобы он жил в его потоке
+    ServerWorker *worker = mWorkers.at(mNextWorker);
+    mNextWorker = (mNextWorker + 1) % mWorkers.size();
+    worker->addConnection(socketDescriptor);
+}
+
+ServerWorker *MyTcpServer::requestOwner(const Request &request) const
+{
+    if (request.type == Request::Register || request.type == Request::Login ||
+        request.type == Request::StartGame || request.type == Request::Stats) {
+        return nullptr;
     }
+    QMutexLocker locker(&mutex);
+    GameSession *session = mPlayerSessions.value(request.playerId, nullptr);
+    return session ? getSessionWorker(session->getGameId()) : nullptr;
 }
 
-void MyTcpServer::slotServerRead()
+void MyTcpServer::dispatchRequest(const Request &request, ServerWorker *origin, quint64 connectionId)
 {
-    QTcpSocket *clientSocket = qobject_cast<QTcpSocket*>(sender());
-    if (!clientSocket) {
-        qDebug() << "Invalid client socket in slotServerRead";
+    // Запросы к сессии выполняет её воркер (владелец проверяется заново уже в его потоке),
+    // остальные - воркер соединения: у каждого потока своё соединение с БД
+    ServerWorker *owner = requestOwner(request);
+    if (owner && owner->thread() != QThread::currentThread()) {
+        qint64 queuedNs = request.traceId != 0 ? Metrics::nowNs() : 0;
+        QMetaObject::invokeMethod(owner, [this, request, origin, connectionId, queuedNs]() {
+            if (request.traceId != 0) {
+                Tracer::getInstance().record("queue_wait", request.traceId, queuedNs, Metrics::nowNs());
+            }
+            dispatchRequest(request, origin, connectionId);
+        }, Qt::QueuedConnection);
         return;
     }
 
-    QByteArray requestData = clientSocket->readAll();
-    QString request = QString::fromUtf8(requestData).trimmed();
-
-    qDebug() << "Received raw request:" << requestData.toHex();
-    qDebug() << "Received input (parsed):" << request;
+    Tracer::Context trace(request.traceId);
+    LoopWatchdog::Activity activity(Request::typeLabel(request.type));
     QByteArray response;
+    PlayerId authenticated = NoPlayer;
+    {
+        TRACE_SPAN("handler");
+        response = parse(request, this, &authenticated);
+    }
+    metrics().latency[request.type]->observeNs(Metrics::nowNs() - request.receivedNs);
+    // Вход выполняется в потоке соединения (см. requestOwner), поэтому привязка успевает до ответа клиенту
+    if (authenticated != NoPlayer) {
+        origin->bindPlayer(connectionId, authenticated, request.nickname);
+    }
+    LOG_TRACE("Processed request type: %1, response: %2", request.typeName, response);
+    {
+        TRACE_SPAN("deliver");
+        // Статистику медленному клиенту достаточно прислать последнюю
+        origin->deliver(connectionId, response,
+                        request.type == Request::Stats ? OutboundLimits::LatestState : OutboundLimits::Essential);
+    }
+    // Участок всего запроса: от конца разбора до постановки ответа в очередь соединения
+    if (request.traceId != 0) {
+        Tracer::getInstance().record(Request::typeLabel(request.type), request.traceId, request.receivedNs, Metrics::nowNs());
+    }
+}
 
-    QJsonDocument doc = QJsonDocument::fromJson(request.toUtf8());
-    if (doc.isObject()) {
-        QJsonObject jsonObj = doc.object();
-        QString type = jsonObj["type"].toString();
-        QString nickname = jsonObj["nickname"].toString();
-
-        if (type == "register" || type == "login") {
-            if (!nickname.isEmpty()) {
-                registerClient(nickname, clientSocket);
-                response = parse(request, this);
-                qDebug() << "Clients registered:" << mClients.keys();
-            } else {
-                response = createJsonResponse("error", "error", "Nickname is empty");
-            }
-        } else if (type == "ready_to_battle") {
-            if (!nickname.isEmpty() && players.contains(nickname)) {
-                QMutexLocker locker(&mutex);
-                qDebug() << "Processing ready_to_battle for" << nickname << "- currentGameId:" << currentGameId << "- Socket state:" << clientSocket->state();
-                readyPlayers.insert(nickname);
-                qDebug() << "Player" << nickname << "is ready. Ready players:" << readyPlayers;
-                response = createJsonResponse("ready_to_battle", "success", "Ready status received");
-                if (readyPlayers.size() == 2 && currentGameId != -1) {
-                    qDebug() << "Both players ready, starting game with gameId:" << currentGameId;
-                    DatabaseManager *db = DatabaseManager::getInstance();
-                    QString player1 = players[0];
-                    db->updateTurn(currentGameId, player1);
-                    QJsonObject startMsg;
-                    startMsg["type"] = "game_start";
-                    startMsg["status"] = "success";
-                    startMsg["message"] = "Game started";
-                    startMsg["current_turn"] = player1;
-                    QByteArray startResponse = QJsonDocument(startMsg).toJson(QJsonDocument::Compact) + "\r\n";
-                    qDebug() << "Prepared game_start message:" << startResponse;
-                    for (const QString &player : mClients.keys()) {
-                        QTcpSocket *targetSocket = mClients[player];
-                        qDebug() << "Attempting to send to" << player << "- Socket state:" << targetSocket->state();
-                        if (targetSocket->state() == QAbstractSocket::ConnectedState) {
-                            bool success = targetSocket->write(startResponse);
-                            targetSocket->flush();
-                            if (success) {
-                                qDebug() << "Successfully sent game_start to" << player;
-                            } else {
-                                qDebug() << "Failed to send game_start to" << player << "- Error:" << targetSocket->errorString();
-                            }
-                        } else {
-                            qDebug() << "Cannot send to" << player << "- Socket not connected, state:" << targetSocket->state();
-                        }
-                    }
-                }
-            } else {
-                response = createJsonResponse("error", "error", "Player not registered");
-            }
-        } else if (type == "make_move") {
-            int gameId = jsonObj["game_id"].toInt();
-            int x = jsonObj["x"].toInt();
-            int y = jsonObj["y"].toInt();
-            qDebug() << "Processing make_move for" << nickname << "in game" << gameId << "at (" << x << "," << y << ")";
-
-            DatabaseManager *db = DatabaseManager::getInstance();
-            QString currentTurn = db->getCurrentTurn(gameId);
-            qDebug() << "Current turn for game" << gameId << "is" << currentTurn;
-            if (currentTurn != nickname) {
-                response = createJsonResponse("error", "error", "Not your turn");
-                qDebug() << "Move rejected: not" << nickname << "'s turn, current turn is" << currentTurn;
-            } else {
-                QString result = db->checkMove(gameId, nickname, x, y);
-                qDebug() << "Move result for" << nickname << ":" << result;
-
-                if (result == "error") {
-                    response = createJsonResponse("error", "error", "Failed to process move");
-                    qDebug() << "Move processing failed for" << nickname;
-                } else if (result == "already_shot") {
-                    response = createJsonResponse("error", "error", "Cell already shot");
-                    qDebug() << "Move rejected: cell (" << x << "," << y << ") already shot by" << nickname;
-                } else {
-                    QJsonObject moveResponse;
-                    moveResponse["type"] = "make_move";
-                    moveResponse["status"] = result;
-                    moveResponse["message"] = "Move processed";
-                    moveResponse["x"] = x;
-                    moveResponse["y"] = y;
-
-                    QJsonObject opponentResponse;
-                    opponentResponse["type"] = "move_result";
-                    opponentResponse["status"] = result;
-                    opponentResponse["x"] = x;
-                    opponentResponse["y"] = y;
-                    opponentResponse["message"] = "Opponent made a move";
-
-                    // Обновляем счётчик потопленных кораблей
-                    //QMutexLocker locker(&mutex);
-                    if (result == "sunk") {
-                        sunkShips[nickname] = sunkShips.value(nickname, 0) + 1;
-                        qDebug() << nickname << "has sunk" << sunkShips[nickname] << "ships";
-                    }
-                    if (sunkShips[nickname] >= 10) {
-                        QJsonObject gameOverMsg;
-                        gameOverMsg["type"] = "game_over";
-                        gameOverMsg["status"] = "success";
-                        gameOverMsg["message"] = QString("%1 победил! Игра окончена.").arg(nickname);
-                        gameOverMsg["winner"] = nickname;
-                        QByteArray gameOverResponse = QJsonDocument(gameOverMsg).toJson(QJsonDocument::Compact) + "\r\n";
-
-                        // Отправляем сообщение game_over обоим игрокам
-                        QString opponent = getOpponent(nickname);
-                        if (!opponent.isEmpty()) {
-                            sendMessageToUser(nickname, gameOverResponse);
-                            sendMessageToUser(opponent, gameOverResponse);
-                            qDebug() << "Game over: " << nickname << " has sunk 10 ships. Sent game_over to both players.";
-                        } else {
-                            qDebug() << "Opponent not found for " << nickname << ", sending game_over only to " << nickname;
-                            sendMessageToUser(nickname, gameOverResponse);
-                        }
-
-                        // Сбрасываем игру
-                        resetGame();
-                        response = gameOverResponse;
-                    }
-
-                    // Обновляем current_turn только один раз
-                    QString opponent = getOpponent(nickname);
-                    if (!opponent.isEmpty()) {
-                        if (result != "hit" && result != "sunk") {
-                            db->updateTurn(gameId, opponent);
-                            qDebug() << "Turn updated to" << opponent << "for game" << gameId;
-                        }
-                        moveResponse["current_turn"] = (result != "hit" && result != "sunk") ? opponent : currentTurn;
-                        opponentResponse["current_turn"] = (result != "hit" && result != "sunk") ? opponent : currentTurn;
-                    } else {
-                        qDebug() << "Opponent not found for" << nickname;
-                        moveResponse["current_turn"] = currentTurn;
-                        opponentResponse["current_turn"] = currentTurn;
-                    }
-
-                    // Отправляем ответы
-                    response = QJsonDocument(moveResponse).toJson(QJsonDocument::Compact) + "\r\n";
-                    qDebug() << "Prepared response for" << nickname << ":" << response;
-
-                    if (!opponent.isEmpty()) {
-                        QByteArray opponentMessage = QJsonDocument(opponentResponse).toJson(QJsonDocument::Compact) + "\r\n";
-                        qDebug() << "Sending move_result to" << opponent << ":" << opponentMessage;
-                        sendMessageToUser(opponent, opponentMessage);
-                    } else {
-                        qDebug() << "Opponent not found for" << nickname << "in game" << gameId;
-                    }
-                }
-            }
+void MyTcpServer::sendMessageToUser(PlayerId player, const QByteArray &message)
+{
+    sendMessageToUser(player, message, QByteArray());
+}
+
+void MyTcpServer::sendMessageToUser(PlayerId player, const QByteArray &jsonMessage, const QByteArray &binaryMessage)
+{
+    TRACE_SPAN("send_message_to_user");
+    ClientRef client;
+    {
+        QMutexLocker locker(&mutex);
+        client = mClients.value(player);
+    }
+    if (!client.worker) {
+        LOG_DEBUG("Player %1 not found or not connected", player);
+        return;
+    }
+    client.worker->deliver(client.connectionId, client.binary && !binaryMessage.isEmpty() ? binaryMessage : jsonMessage);
+}
+
+void MyTcpServer::registerClient(PlayerId player, ServerWorker *worker, quint64 connectionId, bool binary)
+{
+    QMutexLocker locker(&mutex);
+    mClients.insert(player, ClientRef{worker, connectionId, binary});
+    LOG_DEBUG("Registered client: player %1 on worker %2", player, worker->getIndex());
+}
+
+void MyTcpServer::unregisterClient(PlayerId player, ServerWorker *worker, quint64 connectionId)
+{
+    PlayerId opponent = NoPlayer;
+    int gameId = -1;
+    {
+        QMutexLocker locker(&mutex);
+        // Игрок мог уже войти через другое соединение - тогда его не трогаем
+        ClientRef client = mClients.value(player);
+        if (client.worker != worker || client.connectionId != connectionId) {
+            return;
+        }
+        mClients.remove(player);
+        mMatchmaker.leave(player);
+        // ID игры и игроки сессии не меняются, их можно читать из любого потока
+        GameSession *session = mPlayerSessions.value(player, nullptr);
+        if (session) {
+            gameId = session->getGameId();
+            opponent = session->getOpponent(player);
+        }
+    }
+
+    if (gameId == -1) {
+        return;
+    }
+    qint64 graceMs = mResumeGraceMs.load(std::memory_order_relaxed);
+    if (graceMs > 0) {
+        // Игра ждёт переподключения; соперник узнаёт, сколько ждать
+        QJsonObject statusMsg;
+        statusMsg["type"] = "opponent_status";
+        statusMsg["status"] = "disconnected";
+        statusMsg["message"] = "Opponent disconnected, waiting for reconnect";
+        statusMsg["grace_seconds"] = int((graceMs + 999) / 1000);
+        sendMessageToUser(opponent, createJsonMessage(statusMsg));
+    }
+    // Сессию трогает только её воркер: в этот момент он может обрабатывать ход
+    QMetaObject::invokeMethod(getSessionWorker(gameId), [this, gameId, player, graceMs]() {
+        if (graceMs > 0) {
+            beginGrace(gameId, player);
         } else {
-            response = parse(request, this);
-            qDebug() << "Processed other request type:" << type << ", response:" << response;
+            expireGrace(gameId, player);
         }
-    } else {
-        qDebug() << "Failed to parse JSON for request:" << request;
-        response = createJsonResponse("error", "error", "Invalid JSON format");
+    }, Qt::QueuedConnection);
+}
+
+bool MyTcpServer::isConnected(PlayerId player) const
+{
+    QMutexLocker locker(&mutex);
+    return mClients.contains(player);
+}
+
+QString MyTcpServer::issueResumeToken(PlayerId player)
+{
+    quint64 words[2];
+    QRandomGenerator::system()->fillRange(words);
+    QString token = QString::fromLatin1(QByteArray(reinterpret_cast<const char*>(words), sizeof(words)).toHex());
+
+    QMutexLocker locker(&mutex);
+    mResumeTokens.remove(mPlayerTokens.value(player));
+    mPlayerTokens.insert(player, token);
+    mResumeTokens.insert(token, player);
+    return token;
+}
+
+PlayerId MyTcpServer::redeemResumeToken(const QString &token)
+{
+    QMutexLocker locker(&mutex);
+    PlayerId player = mResumeTokens.take(token);
+    if (player != NoPlayer) {
+        mPlayerTokens.remove(player);
     }
+    return player;
+}
+
+void MyTcpServer::beginGrace(int gameId, PlayerId player)
+{
+    GameSession *session = getSession(gameId);
+    // Игрок мог вернуться раньше, чем очередь дошла до этого вызова
+    if (!session || isConnected(player) || session->getGraceTimer(player) != 0) {
+        return;
+    }
+    qint64 graceMs = mResumeGraceMs.load(std::memory_order_relaxed);
+    session->setGraceTimer(player, getSessionWorker(gameId)->timers().schedule(graceMs, [this, gameId, player]() {
+        expireGrace(gameId, player);
+    }));
+    LOG_DEBUG("Game %1 waits %2 ms for player %3 to reconnect", gameId, graceMs, player);
+}
+
+void MyTcpServer::expireGrace(int gameId, PlayerId player)
+{
+    GameSession *session = getSession(gameId);
+    if (!session) {
+        return;
+    }
+    session->setGraceTimer(player, 0);
+    if (isConnected(player)) {
+        return;
+    }
+    // Игрок не вернулся: победа засчитывается сопернику тем же game_over, что и при истечении хода
+    PlayerId opponent = session->getOpponent(player);
+    DatabaseManager *db = DatabaseManager::getInstance();
+    QString playerName = db->playerName(player);
+    QString opponentName = db->playerName(opponent);
+    QJsonObject gameOverMsg;
+    gameOverMsg["type"] = "game_over";
+    gameOverMsg["status"] = "success";
+    gameOverMsg["message"] = QString("%1 не вернулся в игру. %2 победил! Игра окончена.").arg(playerName, opponentName);
+    gameOverMsg["winner"] = opponentName;
+    gameOverMsg["reason"] = "opponent_disconnected";
+    sendMessageToUser(opponent, createJsonMessage(gameOverMsg));
+    LOG_DEBUG("Game over in game %1: %2 did not reconnect in time", gameId, playerName);
+    endSession(session);
+}
 
-    if (clientSocket->state() == QAbstractSocket::ConnectedState) {
-        qDebug() << "Sending response to" << getNicknameBySocket(clientSocket) << ". Response:" << response;
-        clientSocket->write(response);
-        clientSocket->flush();
+void MyTcpServer::endGrace(GameSession *session, PlayerId player)
+{
+    getSessionWorker(session->getGameId())->timers().cancel(session->getGraceTimer(player));
+    session->setGraceTimer(player, 0);
+}
+
+void MyTcpServer::configureMatchmaking(const Matchmaker::Config &config)
+{
+    mMatchmaker.configure(config);
+    // Без рейтинга пары составляются сразу при постановке в очередь, обход не нужен
+    if (config.bandWidth > 0) {
+        mMatchTimer.start(1000);
     } else {
-        qDebug() << "Cannot send response to" << getNicknameBySocket(clientSocket) << ", socket state:" << clientSocket->state();
+        mMatchTimer.stop();
     }
 }
 
-void MyTcpServer::slotClientDisconnected()
+void MyTcpServer::sweepMatchmaking()
 {
-    QTcpSocket *clientSocket = qobject_cast<QTcpSocket*>(sender());
-    if (clientSocket) {
-        QString nickname = getNicknameBySocket(clientSocket);
-        if (!nickname.isEmpty()) {
-            QMutexLocker locker(&mutex);
-            readyPlayers.remove(nickname);
-            sunkShips.remove(nickname); // Удаляем счётчик при отключении
-            unregisterClient(clientSocket);
-            qDebug() << "Client" << nickname << "disconnected! Socket state:" << clientSocket->state();
+    const QVector<Matchmaker::Match> matches = mMatchmaker.sweep();
+    for (const Matchmaker::Match &match : matches) {
+        if (startMatchedGame(match.first, match.second, this) == -1) {
+            mMatchmaker.requeue(match.second, match.secondRating);
+            mMatchmaker.requeue(match.first, match.firstRating);
         }
-        clientSocket->deleteLater();
     }
 }
 
-void MyTcpServer::sendMessageToUser(const QString &nickname, const QByteArray &message)
+bool MyTcpServer::isInGame(PlayerId player) const
 {
     QMutexLocker locker(&mutex);
-    if (mClients.contains(nickname)) {
-        QTcpSocket *socket = mClients[nickname];
-        if (socket && socket->state() == QAbstractSocket::ConnectedState && socket->isValid()) {
-            qint64 bytesWritten = socket->write(message);
-            if (bytesWritten == -1) {
-                qDebug() << "Failed to write to socket for" << nickname << "- Error:" << socket->errorString();
-            } else {
-                // Не используем flush, чтобы избежать блокировки
-                qDebug() << "Message queued for" << nickname << ":" << message;
-            }
-        } else {
-            qDebug() << "Socket for" << nickname << "is invalid or not connected. State:" << (socket ? socket->state() : -1);
-        }
-    } else {
-        qDebug() << "User" << nickname << "not found or not connected. Current clients:" << mClients.keys();
-    }
+    return mPlayerSessions.contains(player);
+}
+
+PlayerId MyTcpServer::getOpponent(PlayerId player) const
+{
+    QMutexLocker locker(&mutex);
+    GameSession *session = mPlayerSessions.value(player, nullptr);
+    return session ? session->getOpponent(player) : NoPlayer;
 }
 
-void MyTcpServer::registerClient(const QString &nickname, QTcpSocket *socket)
+GameSession *MyTcpServer::createSession(int gameId, PlayerId player1, PlayerId player2)
 {
     QMutexLocker locker(&mutex);
-    mClients.insert(nickname, socket);
-    mSocketToNickname.insert(socket, nickname);
-    sunkShips.insert(nickname, 0); // Инициализируем счётчик потопленных кораблей
-    qDebug() << "Registered client:" << nickname << "Socket state:" << socket->state();
+    GameSession *session = new GameSession(gameId, player1, player2);
+    mSessions.insert(gameId, session);
+    mPlayerSessions.insert(player1, session);
+    mPlayerSessions.insert(player2, session);
+    LOG_DEBUG("Session created for game %1 between %2 and %3 on worker %4 - active sessions: %5",
+              gameId, player1, player2, getSessionWorker(gameId)->getIndex(), mSessions.size());
+    return session;
 }
 
-void MyTcpServer::unregisterClient(QTcpSocket *socket)
+void MyTcpServer::endSession(GameSession *session)
 {
     QMutexLocker locker(&mutex);
-    QString nickname = mSocketToNickname.value(socket, "");
-    if (!nickname.isEmpty()) {
-        mClients.remove(nickname);
-        mSocketToNickname.remove(socket);
-        players.removeAll(nickname);
-        readyPlayers.remove(nickname);
-        sunkShips.remove(nickname); // Удаляем счётчик при отключении
-        QString opponent = getOpponentInternal(nickname);
-        if (!opponent.isEmpty()) {
-            sendMessageToUser(opponent, createJsonResponse("gameover", "opponent_disconnected", "Opponent disconnected"));
-            resetGame();
+    if (!session || mSessions.value(session->getGameId(), nullptr) != session) {
+        return;
+    }
+    mSessions.remove(session->getGameId());
+    TimerWheel &timers = getSessionWorker(session->getGameId())->timers();
+    timers.cancel(session->getTurnTimer());
+    for (int index = 0; index < 2; ++index) {
+        timers.cancel(session->getGraceTimer(session->getPlayer(index)));
+    }
+    for (int index = 0; index < 2; ++index) {
+        PlayerId player = session->getPlayer(index);
+        if (mPlayerSessions.value(player, nullptr) == session) {
+            mPlayerSessions.remove(player);
         }
     }
+    LOG_DEBUG("Session for game %1 ended - active sessions: %2", session->getGameId(), mSessions.size());
+    delete session;
 }
 
-QString MyTcpServer::getNicknameBySocket(QTcpSocket *socket)
+GameSession *MyTcpServer::getSession(int gameId) const
 {
     QMutexLocker locker(&mutex);
-    return mSocketToNickname.value(socket, "");
+    return mSessions.value(gameId, nullptr);
 }
 
-void MyTcpServer::addPlayerToGame(const QString &nickname)
+GameSession *MyTcpServer::getSessionByPlayer(PlayerId player) const
 {
     QMutexLocker locker(&mutex);
-    if (!players.contains(nickname)) {
-        players.append(nickname);
-        sunkShips.insert(nickname, 0); // Инициализируем счётчик при добавлении игрока
-        qDebug() << "Added player to game:" << nickname;
+    GameSession *session = mPlayerSessions.value(player, nullptr);
+    // Сессия могла появиться, пока запрос шёл в чужом потоке: её состояние трогает только владелец
+    if (session && getSessionWorker(session->getGameId())->thread() != QThread::currentThread()) {
+        LOG_DEBUG("Session of player %1 belongs to another worker", player);
+        return nullptr;
     }
+    return session;
 }
 
-QString MyTcpServer::getOpponent(const QString &nickname) const
+ServerWorker *MyTcpServer::getSessionWorker(int gameId) const
 {
-    return const_cast<MyTcpServer*>(this)->getOpponentInternal(nickname);
+    // Список воркеров не меняется после запуска, блокировка не нужна
+    return mWorkers.at(qAbs(gameId) % mWorkers.size());
 }
 
-QString MyTcpServer::getOpponentInternal(const QString &nickname)
+int MyTcpServer::getSessionCount() const
 {
     QMutexLocker locker(&mutex);
-    for (const QString &player : players) {
-        if (player != nickname) {
-            return player;
-        }
-    }
-    return "";
+    return mSessions.size();
 }
 
-int MyTcpServer::getPlayerCount() const
+OutboundStats MyTcpServer::getOutboundStats() const
 {
-    return const_cast<MyTcpServer*>(this)->getPlayerCountInternal();
+    OutboundStats stats;
+    for (ServerWorker *worker : mWorkers) {
+        stats += worker->getOutboundStats();
+    }
+    return stats;
 }
 
-int MyTcpServer::getPlayerCountInternal()
+void MyTcpServer::setOutboundLimits(const OutboundLimits &limits)
 {
-    QMutexLocker locker(&mutex);
-    return players.size();
+    for (ServerWorker *worker : std::as_const(mWorkers)) {
+        worker->setOutboundLimits(limits);
+    }
 }
 
-void MyTcpServer::resetGame()
+void MyTcpServer::setTimeouts(qint64 idleTimeoutMs, qint64 turnTimeoutMs, TurnTimeoutAction action)
 {
-    QMutexLocker locker(&mutex);
-    players.clear();
-    readyPlayers.clear();
-    sunkShips.clear(); // Очищаем счётчики потопленных кораблей
-    currentGameId = -1;
-    qDebug() << "Game reset.";
+    mTurnTimeoutMs.store(qMax<qint64>(0, turnTimeoutMs), std::memory_order_relaxed);
+    mTurnAction.store(action, std::memory_order_relaxed);
+    for (ServerWorker *worker : std::as_const(mWorkers)) {
+        worker->setIdleTimeout(idleTimeoutMs);
+    }
 }
 
-int MyTcpServer::getGameId() const
+void MyTcpServer::restartTurnClock(GameSession *session)
 {
-    return currentGameId;
+    // Один таймер на сессию в колесе её воркера: срабатывает в том же потоке, что и ходы
+    int gameId = session->getGameId();
+    TimerWheel &timers = getSessionWorker(gameId)->timers();
+    timers.cancel(session->getTurnTimer());
+    session->setTurnTimer(0);
+    qint64 timeoutMs = mTurnTimeoutMs.load(std::memory_order_relaxed);
+    if (timeoutMs > 0) {
+        session->setTurnTimer(timers.schedule(timeoutMs, [this, gameId]() { handleTurnTimeout(gameId, this); }));
+    }
 }
 
-int MyTcpServer::getSunkShips(const QString &nickname) const
+int MyTcpServer::getTimerCount() const
 {
-    QMutexLocker locker(&mutex);
-    return sunkShips.value(nickname, 0);
+    int count = 0;
+    for (ServerWorker *worker : mWorkers) {
+        count += worker->getTimerCount();
+    }
+    return count;
 }
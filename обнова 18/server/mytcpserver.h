@@ -3,50 +3,108 @@
 
 #include <QObject>
 #include <QTcpServer>
-#include <QTcpSocket>
+#include <QThread>
 #include <QHash>
 #include <QMutex>
 #include <QVector>
-#include <QSet>
+#include <QTimer>
+#include <atomic>
+#include "PlayerRegistry.h"
+#include "OutboundLimits.h"
+#include "Matchmaker.h"
 
-class MyTcpServer : public QObject
+class GameSession;
+class ServerWorker;
+struct Request;
+
+// Принимает соединения и раздаёт их рабочим потокам, хранит общий справочник игроков и сессий.
+// Каждая сессия закреплена за одним воркером, поэтому игровая логика выполняется без блокировок;
+// запросы без сессии (регистрация, вход, поиск игры) выполняются воркером соединения.
+class MyTcpServer : public QTcpServer
 {
     Q_OBJECT
 
 public:
-    explicit MyTcpServer(QObject *parent = nullptr);
+    // Что делать, если игрок не походил вовремя
+    enum TurnTimeoutAction {
+        ForfeitOnTimeout, // Поражение опоздавшего
+        PassOnTimeout // Ход переходит сопернику
+    };
+
+    explicit MyTcpServer(int workerCount = QThread::idealThreadCount(), QObject *parent = nullptr);
     ~MyTcpServer();
 
-    // Методы для управления клиентами
-    void sendMessageToUser(const QString &nickname, const QByteArray &message);
-    void registerClient(const QString &nickname, QTcpSocket *socket);
-    void unregisterClient(QTcpSocket *socket);
-    QString getNicknameBySocket(QTcpSocket *socket);
+    // Перестаёт принимать соединения и останавливает воркеры: после этого ходы и таймеры
+    // больше не порождают записей в БД. Вызывается до остановки записи в БД; повторный вызов ничего не делает
+    void stop();
+
+    // Методы для управления клиентами (можно вызывать из любого потока)
+    void sendMessageToUser(PlayerId player, const QByteArray &message);
+    // Сообщение в двух видах: двоичный уходит игрокам, перешедшим на двоичный протокол
+    void sendMessageToUser(PlayerId player, const QByteArray &jsonMessage, const QByteArray &binaryMessage);
+    void registerClient(PlayerId player, ServerWorker *worker, quint64 connectionId, bool binary = false);
+    void unregisterClient(PlayerId player, ServerWorker *worker, quint64 connectionId);
+    bool isConnected(PlayerId player) const;
+    // Токены возобновления: выдаются при входе, одноразовые, у игрока действует только последний
+    QString issueResumeToken(PlayerId player);
+    PlayerId redeemResumeToken(const QString &token); // NoPlayer, если токен неизвестен
+    // Выполняет запрос в потоке, которому принадлежит состояние игрока, и отправляет ответ в соединение
+    void dispatchRequest(const Request &request, ServerWorker *origin, quint64 connectionId);
 
     // Методы для игровой логики
-    void addPlayerToGame(const QString &nickname);
-    QString getOpponent(const QString &nickname) const;
-    QString getOpponentInternal(const QString &nickname);
-    int getPlayerCount() const;
-    int getPlayerCountInternal();
-    void resetGame();
-    int getGameId() const;
-    int currentGameId; // ID текущей игры
-    int getSunkShips(const QString &nickname) const; // Получить количество потопленных кораблей
+    Matchmaker &getMatchmaker() { return mMatchmaker; } // Очередь start_game, потокобезопасна
+    void configureMatchmaking(const Matchmaker::Config &config); // С рейтингом включает периодический подбор пар
+    bool isInGame(PlayerId player) const;
+    PlayerId getOpponent(PlayerId player) const;
+    GameSession *createSession(int gameId, PlayerId player1, PlayerId player2);
+    void endSession(GameSession *session); // Только из потока воркера, которому принадлежит сессия
+    GameSession *getSession(int gameId) const;
+    GameSession *getSessionByPlayer(PlayerId player) const; // Только сессии воркера текущего потока
+    ServerWorker *getSessionWorker(int gameId) const;
+    int getSessionCount() const;
+    int getWorkerCount() const { return mWorkers.size(); }
+    OutboundStats getOutboundStats() const; // Сумма по воркерам
+    void setOutboundLimits(const OutboundLimits &limits); // Водяные знаки и политики для всех соединений
+
+    // Сроки: простой соединения и время на ход (0 - без ограничения)
+    void setTimeouts(qint64 idleTimeoutMs, qint64 turnTimeoutMs, TurnTimeoutAction action);
+    TurnTimeoutAction getTurnTimeoutAction() const { return TurnTimeoutAction(mTurnAction.load(std::memory_order_relaxed)); }
+    void restartTurnClock(GameSession *session); // Только из потока воркера сессии
+    // Сколько сессия ждёт переподключившегося игрока (0 - сразу засчитывается поражение)
+    void setResumeGrace(qint64 graceMs) { mResumeGraceMs.store(qMax<qint64>(0, graceMs), std::memory_order_relaxed); }
+    void endGrace(GameSession *session, PlayerId player); // Игрок вернулся; только из потока воркера сессии
+    int getTimerCount() const; // Таймеры во всех колёсах воркеров
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
 
 private:
-    QTcpServer *mTcpServer;
-    QHash<QString, QTcpSocket*> mClients; // Никнейм -> Сокет
-    QHash<QTcpSocket*, QString> mSocketToNickname; // Сокет -> Никнейм (для обратного поиска)
-    QStringList players; // Список игроков в игре
-    mutable QMutex mutex; // Для защиты доступа к общим данным (mutable для const методов)
-    QSet<QString> readyPlayers; // Множество игроков, готовых к бою
-    QHash<QString, int> sunkShips; // Счётчик потопленных кораблей для каждого игрока
-
-public slots:
-    void slotNewConnection();
-    void slotServerRead();
-    void slotClientDisconnected();
+    // Где находится соединение игрока
+    struct ClientRef
+    {
+        ServerWorker *worker = nullptr;
+        quint64 connectionId = 0;
+        bool binary = false; // Соединение согласовало двоичный протокол
+    };
+
+    ServerWorker *requestOwner(const Request &request) const; // nullptr - можно выполнить в текущем потоке
+    void sweepMatchmaking();
+    void beginGrace(int gameId, PlayerId player);
+    void expireGrace(int gameId, PlayerId player);
+
+    QVector<ServerWorker*> mWorkers;
+    int mNextWorker = 0; // Соединения раздаются воркерам по кругу
+    QHash<PlayerId, ClientRef> mClients; // Игрок -> Соединение
+    mutable QMutex mutex; // Защищает только справочник ниже, состояние сессий принадлежит воркерам
+    QHash<int, GameSession*> mSessions; // ID игры -> Сессия
+    QHash<PlayerId, GameSession*> mPlayerSessions; // Игрок -> Сессия, в которой он играет
+    QHash<QString, PlayerId> mResumeTokens; // Токен -> Игрок
+    QHash<PlayerId, QString> mPlayerTokens; // Игрок -> Его действующий токен
+    Matchmaker mMatchmaker; // Игроки, ожидающие соперника
+    QTimer mMatchTimer;
+    std::atomic<qint64> mTurnTimeoutMs{0};
+    std::atomic<int> mTurnAction{ForfeitOnTimeout};
+    std::atomic<qint64> mResumeGraceMs{0};
 };
 
 #endif // MYTCPSERVER_H
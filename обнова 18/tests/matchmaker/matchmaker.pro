@@ -0,0 +1,16 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_matchmaker
+
+INCLUDEPATH += $$PWD/../../server
+
+SOURCES += \
+    ../../server/Matchmaker.cpp \
+    tst_matchmaker.cpp
+
+HEADERS += \
+    ../../server/Matchmaker.h
@@ -0,0 +1,212 @@
+#include <QtTest>
+#include "Matchmaker.h"
+
+// Очередь получает время от теста, поэтому расширение полос проверяется без ожидания
+class TestMatchmaker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void pairsInJoinOrder();
+    void rejectsDuplicateJoin();
+    void firstIsLongestWaiter();
+    void pairsOnlyWithinBand();
+    void bandWidensOverTime();
+    void spreadLimitsSearch();
+    void sweepIgnoresUnratedQueue();
+    void leaveRemovesPlayer();
+    void requeuePutsPlayerFirst();
+    void requeueIgnoresQueuedPlayer();
+
+private:
+    // Полосы по 100 очков, +50 к допустимой разнице за секунду ожидания, по 4 полосы в каждую сторону
+    void configureRating(Matchmaker &matchmaker);
+
+    qint64 nowMs = 0;
+    Matchmaker::Clock clock = [this]() { return nowMs; };
+};
+
+void TestMatchmaker::init()
+{
+    nowMs = 0;
+}
+
+void TestMatchmaker::configureRating(Matchmaker &matchmaker)
+{
+    Matchmaker::Config config;
+    config.bandWidth = 100;
+    config.widenPerSecond = 50;
+    config.maxBandSpread = 4;
+    matchmaker.configure(config);
+}
+
+void TestMatchmaker::pairsInJoinOrder()
+{
+    Matchmaker matchmaker(clock);
+    Matchmaker::Match match;
+
+    QCOMPARE(matchmaker.join(1, 0, match), Matchmaker::Queued);
+    QCOMPARE(matchmaker.join(2, 0, match), Matchmaker::Matched);
+    QCOMPARE(match.first, PlayerId(1));
+    QCOMPARE(match.second, PlayerId(2));
+
+    QCOMPARE(matchmaker.join(3, 0, match), Matchmaker::Queued);
+    QCOMPARE(matchmaker.join(4, 0, match), Matchmaker::Matched);
+    QCOMPARE(match.first, PlayerId(3));
+    QCOMPARE(match.second, PlayerId(4));
+
+    QCOMPARE(matchmaker.depth(), 0);
+    QCOMPARE(matchmaker.getMatchesMade(), qint64(2));
+}
+
+void TestMatchmaker::rejectsDuplicateJoin()
+{
+    Matchmaker matchmaker(clock);
+    Matchmaker::Match match;
+
+    QCOMPARE(matchmaker.join(1, 0, match), Matchmaker::Queued);
+    QCOMPARE(matchmaker.join(1, 0, match), Matchmaker::AlreadyQueued);
+    QCOMPARE(matchmaker.join(NoPlayer, 0, match), Matchmaker::AlreadyQueued);
+    QCOMPARE(matchmaker.depth(), 1);
+}
+
+void TestMatchmaker::firstIsLongestWaiter()
+{
+    Matchmaker matchmaker(clock);
+    configureRating(matchmaker);
+    Matchmaker::Match match;
+
+    QCOMPARE(matchmaker.join(1, 1000, match), Matchmaker::Queued);
+    nowMs = 1500;
+    QCOMPARE(matchmaker.join(2, 1020, match), Matchmaker::Matched);
+    QCOMPARE(match.first, PlayerId(1));
+    QCOMPARE(match.second, PlayerId(2));
+    QCOMPARE(match.firstRating, 1000);
+    QCOMPARE(match.secondRating, 1020);
+    QCOMPARE(match.waitedMs, qint64(1500));
+}
+
+void TestMatchmaker::pairsOnlyWithinBand()
+{
+    Matchmaker matchmaker(clock);
+    configureRating(matchmaker);
+    Matchmaker::Match match;
+
+    QCOMPARE(matchmaker.join(1, 1000, match), Matchmaker::Queued);
+    QCOMPARE(matchmaker.join(2, 1250, match), Matchmaker::Queued); // Разница 250 больше ширины полосы
+    QCOMPARE(matchmaker.join(3, 1050, match), Matchmaker::Matched);
+    QCOMPARE(match.first, PlayerId(1));
+    QCOMPARE(match.second, PlayerId(3));
+    QCOMPARE(matchmaker.depth(), 1);
+}
+
+void TestMatchmaker::bandWidensOverTime()
+{
+    Matchmaker matchmaker(clock);
+    configureRating(matchmaker);
+    Matchmaker::Match match;
+
+    QCOMPARE(matchmaker.join(1, 1000, match), Matchmaker::Queued);
+    nowMs = 1;
+    QCOMPARE(matchmaker.join(2, 1250, match), Matchmaker::Queued);
+
+    // Разница растёт только за полные секунды: через 2,999 с допустимо 200 очков
+    nowMs = 2999;
+    QVERIFY(matchmaker.sweep().isEmpty());
+    QCOMPARE(matchmaker.depth(), 2);
+
+    nowMs = 3000;
+    const QVector<Matchmaker::Match> matches = matchmaker.sweep();
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].first, PlayerId(1));
+    QCOMPARE(matches[0].second, PlayerId(2));
+    QCOMPARE(matches[0].waitedMs, qint64(3000));
+    QCOMPARE(matchmaker.depth(), 0);
+}
+
+void TestMatchmaker::spreadLimitsSearch()
+{
+    Matchmaker matchmaker(clock);
+    configureRating(matchmaker);
+    Matchmaker::Match match;
+
+    // Полоса 16 на 6 полос дальше полосы 10: соперники не видят друг друга при любом ожидании
+    QCOMPARE(matchmaker.join(1, 1000, match), Matchmaker::Queued);
+    QCOMPARE(matchmaker.join(2, 1600, match), Matchmaker::Queued);
+    nowMs = 3600 * 1000;
+    QVERIFY(matchmaker.sweep().isEmpty());
+    QCOMPARE(matchmaker.depth(), 2);
+}
+
+void TestMatchmaker::sweepIgnoresUnratedQueue()
+{
+    Matchmaker matchmaker(clock);
+    Matchmaker::Match match;
+
+    QCOMPARE(matchmaker.join(1, 0, match), Matchmaker::Queued);
+    nowMs = 60 * 1000;
+    QVERIFY(matchmaker.sweep().isEmpty());
+    QCOMPARE(matchmaker.depth(), 1);
+}
+
+void TestMatchmaker::leaveRemovesPlayer()
+{
+    Matchmaker matchmaker(clock);
+    Matchmaker::Match match;
+
+    QCOMPARE(matchmaker.join(1, 0, match), Matchmaker::Queued);
+    QVERIFY(matchmaker.isQueued(1));
+    QVERIFY(matchmaker.leave(1));
+    QVERIFY(!matchmaker.leave(1));
+    QVERIFY(!matchmaker.isQueued(1));
+    QCOMPARE(matchmaker.depth(), 0);
+
+    // Ушедший игрок не достаётся следующему
+    QCOMPARE(matchmaker.join(2, 0, match), Matchmaker::Queued);
+    QCOMPARE(matchmaker.join(3, 0, match), Matchmaker::Matched);
+    QCOMPARE(match.first, PlayerId(2));
+    QCOMPARE(match.second, PlayerId(3));
+}
+
+void TestMatchmaker::requeuePutsPlayerFirst()
+{
+    Matchmaker matchmaker(clock);
+    Matchmaker::Match match;
+
+    // Игра для пары не создалась: соперник возвращается в очередь раньше уже ждущих
+    QCOMPARE(matchmaker.join(1, 0, match), Matchmaker::Queued);
+    matchmaker.requeue(5, 0);
+    QCOMPARE(matchmaker.depth(), 2);
+    QVERIFY(matchmaker.isQueued(5));
+
+    QCOMPARE(matchmaker.join(2, 0, match), Matchmaker::Matched);
+    QCOMPARE(match.first, PlayerId(5));
+    QCOMPARE(match.second, PlayerId(2));
+
+    QCOMPARE(matchmaker.join(3, 0, match), Matchmaker::Matched);
+    QCOMPARE(match.first, PlayerId(1));
+    QCOMPARE(match.second, PlayerId(3));
+    QCOMPARE(matchmaker.depth(), 0);
+}
+
+void TestMatchmaker::requeueIgnoresQueuedPlayer()
+{
+    Matchmaker matchmaker(clock);
+    Matchmaker::Match match;
+
+    QCOMPARE(matchmaker.join(1, 0, match), Matchmaker::Queued);
+    matchmaker.requeue(1, 0);
+    matchmaker.requeue(NoPlayer, 0);
+    QCOMPARE(matchmaker.depth(), 1);
+
+    // Единственная запись игрока осталась прежней: выход из очереди убирает его полностью
+    QVERIFY(matchmaker.leave(1));
+    QCOMPARE(matchmaker.depth(), 0);
+    QCOMPARE(matchmaker.join(2, 0, match), Matchmaker::Queued);
+}
+
+QTEST_APPLESS_MAIN(TestMatchmaker)
+
+#include "tst_matchmaker.moc"
@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+# Модульные тесты на Qt Test: qmake tests.pro && make check
+SUBDIRS += \
+    matchmaker \
+    timer_wheel
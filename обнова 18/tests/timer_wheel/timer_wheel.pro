@@ -0,0 +1,16 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_timer_wheel
+
+INCLUDEPATH += $$PWD/../../server
+
+SOURCES += \
+    ../../server/TimerWheel.cpp \
+    tst_timer_wheel.cpp
+
+HEADERS += \
+    ../../server/TimerWheel.h
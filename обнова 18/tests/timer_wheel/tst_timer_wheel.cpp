@@ -0,0 +1,194 @@
+#include <QtTest>
+#include "TimerWheel.h"
+
+// Колесо с тиком 1 мс: сроки в тестах задаются прямо в тиках
+class TestTimerWheel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void firesOnTime_data();
+    void firesOnTime();
+    void roundsUpToTick();
+    void keepsRemainderBetweenAdvances();
+    void firesInScheduleOrder();
+    void clampsFarDeadline();
+    void cancelBeforeExpiry();
+    void cancelAfterCascade();
+    void cancelFromCallback();
+    void callbackCannotCancelItself();
+    void scheduleFromCallback();
+};
+
+void TestTimerWheel::firesOnTime_data()
+{
+    QTest::addColumn<qint64>("start"); // Сколько тиков прошло до постановки таймера
+    QTest::addColumn<qint64>("delay");
+
+    QTest::newRow("next tick") << qint64(0) << qint64(1);
+    QTest::newRow("last tick of level 0") << qint64(0) << qint64(63);
+    QTest::newRow("first tick of level 1") << qint64(0) << qint64(64);
+    QTest::newRow("level 1") << qint64(0) << qint64(65);
+    QTest::newRow("last tick of level 1") << qint64(0) << qint64(4095);
+    QTest::newRow("first tick of level 2") << qint64(0) << qint64(4096);
+    QTest::newRow("level 2") << qint64(0) << qint64(4097);
+    QTest::newRow("first tick of level 3") << qint64(0) << qint64(262144);
+    QTest::newRow("crosses a level 0 turn") << qint64(63) << qint64(1);
+    QTest::newRow("level 1 from the middle of a slot") << qint64(10) << qint64(64);
+    QTest::newRow("crosses a level 1 turn") << qint64(4000) << qint64(96);
+    QTest::newRow("lands in the current level 1 slot") << qint64(70) << qint64(4090);
+    QTest::newRow("crosses a level 2 turn") << qint64(262100) << qint64(100);
+}
+
+void TestTimerWheel::firesOnTime()
+{
+    QFETCH(qint64, start);
+    QFETCH(qint64, delay);
+
+    TimerWheel wheel(1);
+    wheel.advance(start);
+    int fired = 0;
+    wheel.schedule(delay, [&fired]() { ++fired; });
+
+    QCOMPARE(wheel.advance(delay - 1), 0);
+    QCOMPARE(fired, 0);
+    QCOMPARE(wheel.advance(1), 1);
+    QCOMPARE(fired, 1);
+    QCOMPARE(wheel.now(), start + delay);
+    QCOMPARE(wheel.size(), 0);
+}
+
+void TestTimerWheel::roundsUpToTick()
+{
+    TimerWheel wheel(100);
+    int fired = 0;
+    wheel.schedule(150, [&fired]() { ++fired; });
+    wheel.schedule(0, [&fired]() { fired += 10; }); // Не раньше следующего тика
+
+    QCOMPARE(wheel.advance(100), 1);
+    QCOMPARE(fired, 10);
+    QCOMPARE(wheel.advance(99), 0);
+    QCOMPARE(wheel.advance(1), 1);
+    QCOMPARE(fired, 11);
+}
+
+void TestTimerWheel::keepsRemainderBetweenAdvances()
+{
+    TimerWheel wheel(100);
+    int fired = 0;
+    wheel.schedule(100, [&fired]() { ++fired; });
+
+    QCOMPARE(wheel.advance(60), 0);
+    QCOMPARE(wheel.advance(-5), 0); // Время назад не идёт
+    QCOMPARE(wheel.advance(40), 1);
+    QCOMPARE(wheel.now(), qint64(100));
+}
+
+void TestTimerWheel::firesInScheduleOrder()
+{
+    TimerWheel wheel(1);
+    QVector<int> order;
+    // Срок на уровне 1: порядок должен пережить перенос ячейки вниз
+    for (int timer = 0; timer < 3; ++timer) {
+        wheel.schedule(100, [&order, timer]() { order.append(timer); });
+    }
+
+    QCOMPARE(wheel.advance(100), 3);
+    QCOMPARE(order, QVector<int>({0, 1, 2}));
+}
+
+void TestTimerWheel::clampsFarDeadline()
+{
+    TimerWheel wheel(1);
+    const qint64 maxTicks = (qint64(1) << (TimerWheel::SlotBits * TimerWheel::Levels)) - 1;
+    int fired = 0;
+    wheel.schedule(maxTicks * 4, [&fired]() { ++fired; });
+
+    QCOMPARE(wheel.advance(maxTicks - 1), 0);
+    QCOMPARE(wheel.advance(1), 1);
+    QCOMPARE(fired, 1);
+}
+
+void TestTimerWheel::cancelBeforeExpiry()
+{
+    TimerWheel wheel(1);
+    int fired = 0;
+    TimerWheel::TimerId id = wheel.schedule(10, [&fired]() { ++fired; });
+    QCOMPARE(wheel.size(), 1);
+
+    QVERIFY(wheel.cancel(id));
+    QVERIFY(!wheel.cancel(id));
+    QCOMPARE(wheel.size(), 0);
+    QCOMPARE(wheel.advance(20), 0);
+    QCOMPARE(fired, 0);
+}
+
+void TestTimerWheel::cancelAfterCascade()
+{
+    TimerWheel wheel(1);
+    int fired = 0;
+    TimerWheel::TimerId id = wheel.schedule(100, [&fired]() { ++fired; });
+
+    // На 64-м тике таймер переносится с уровня 1 на уровень 0; отмена должна найти его на новом месте
+    QCOMPARE(wheel.advance(64), 0);
+    QVERIFY(wheel.cancel(id));
+    QCOMPARE(wheel.advance(100), 0);
+    QCOMPARE(fired, 0);
+}
+
+void TestTimerWheel::cancelFromCallback()
+{
+    TimerWheel wheel(1);
+    QVector<int> fired;
+    bool cancelledSameSlot = false;
+    bool cancelledLater = false;
+    TimerWheel::TimerId sameSlot = 0;
+    TimerWheel::TimerId later = 0;
+
+    wheel.schedule(10, [&]() {
+        fired.append(0);
+        cancelledSameSlot = wheel.cancel(sameSlot);
+        cancelledLater = wheel.cancel(later);
+    });
+    sameSlot = wheel.schedule(10, [&fired]() { fired.append(1); });
+    later = wheel.schedule(200, [&fired]() { fired.append(2); });
+
+    QCOMPARE(wheel.advance(10), 1);
+    QVERIFY(cancelledSameSlot);
+    QVERIFY(cancelledLater);
+    QCOMPARE(wheel.size(), 0);
+    QCOMPARE(wheel.advance(300), 0);
+    QCOMPARE(fired, QVector<int>({0}));
+}
+
+void TestTimerWheel::callbackCannotCancelItself()
+{
+    TimerWheel wheel(1);
+    TimerWheel::TimerId id = 0;
+    bool cancelled = true;
+    id = wheel.schedule(5, [&]() { cancelled = wheel.cancel(id); });
+
+    QCOMPARE(wheel.advance(5), 1);
+    QVERIFY(!cancelled); // Сработавший таймер уже снят с колеса
+}
+
+void TestTimerWheel::scheduleFromCallback()
+{
+    TimerWheel wheel(1);
+    QVector<qint64> firedAt;
+    std::function<void()> repeat = [&]() {
+        firedAt.append(wheel.now());
+        if (firedAt.size() < 3) {
+            wheel.schedule(70, repeat);
+        }
+    };
+    wheel.schedule(70, repeat);
+
+    QCOMPARE(wheel.advance(1000), 3);
+    QCOMPARE(firedAt, QVector<qint64>({70, 140, 210}));
+    QCOMPARE(wheel.size(), 0);
+}
+
+QTEST_APPLESS_MAIN(TestTimerWheel)
+
+#include "tst_timer_wheel.moc"